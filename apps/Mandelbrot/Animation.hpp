@@ -0,0 +1,409 @@
+#pragma once
+
+#include "Mandelbrot.hpp"
+
+#include <ColorSpace.hpp>
+#include <Expect.hpp>
+#include <Histogram.hpp>
+#include <PNG.hpp>
+#include <PPM.hpp>
+#include <Tensor.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Keyframe
+{
+    size_t frame;
+    double centerReal, centerImag;
+    double zoom;
+    size_t maxIterations;
+};
+
+// Reads one keyframe per line as "frame centerReal centerImag zoom maxIterations", '#' starts a comment.
+inline auto LoadKeyframes(std::string const& filename) -> std::vector<Keyframe>
+{
+    std::ifstream infile(filename);
+    Expect(static_cast<bool>(infile), "error: unable to open keyframe file " + filename);
+
+    std::vector<Keyframe> keyframes;
+    std::string line;
+    while (std::getline(infile, line))
+    {
+        line = line.substr(0, line.find('#'));
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+        {
+            continue;
+        }
+
+        std::istringstream fields(line);
+        Keyframe keyframe;
+        fields >> keyframe.frame >> keyframe.centerReal >> keyframe.centerImag >> keyframe.zoom >> keyframe.maxIterations;
+        Expect(!fields.fail() && keyframe.zoom > 0.0, "error: malformed keyframe: " + line);
+
+        keyframes.push_back(keyframe);
+    }
+
+    Expect(!keyframes.empty(), "error: no keyframes in " + filename);
+    std::sort(keyframes.begin(), keyframes.end(), [](Keyframe const& a, Keyframe const& b)
+    {
+        return a.frame < b.frame;
+    });
+
+    return keyframes;
+}
+
+// Zoom is interpolated geometrically and the centre moves in proportion to the shrinking view,
+// so a zoom into a point keeps that point fixed on screen.
+inline auto InterpolateKeyframes(std::vector<Keyframe> const& keyframes, size_t frame) -> Keyframe
+{
+    if (frame <= keyframes.front().frame)
+    {
+        return {frame, keyframes.front().centerReal, keyframes.front().centerImag, keyframes.front().zoom, keyframes.front().maxIterations};
+    }
+    if (frame >= keyframes.back().frame)
+    {
+        return {frame, keyframes.back().centerReal, keyframes.back().centerImag, keyframes.back().zoom, keyframes.back().maxIterations};
+    }
+
+    auto after = [](size_t f, Keyframe const& k)
+    {
+        return f < k.frame;
+    };
+
+    auto next       = std::upper_bound(keyframes.begin(), keyframes.end(), frame, after);
+    auto const& end = *next;
+    auto const& beg = *(next - 1);
+
+    double t    = static_cast<double>(frame - beg.frame) / static_cast<double>(end.frame - beg.frame);
+    double zoom = beg.zoom * std::pow(end.zoom / beg.zoom, t);
+
+    double w = t;
+    if (std::abs(end.zoom - beg.zoom) > 1e-12 * beg.zoom)
+    {
+        w = (1.0 / beg.zoom - 1.0 / zoom) / (1.0 / beg.zoom - 1.0 / end.zoom);
+    }
+
+    double iterations = beg.maxIterations + t * (static_cast<double>(end.maxIterations) - static_cast<double>(beg.maxIterations));
+
+    return {
+        frame,
+        beg.centerReal + w * (end.centerReal - beg.centerReal),
+        beg.centerImag + w * (end.centerImag - beg.centerImag),
+        zoom,
+        static_cast<size_t>(std::llround(iterations)),
+    };
+}
+
+enum class FrameFormat
+{
+    Png,
+    Ppm,
+    Raw,
+    Y4m, // YUV4MPEG2 stream of BT.709 limited-range 4:2:0 frames, readable by video encoders
+};
+
+// Tone adjustment applied to each colorized frame before it is encoded.
+enum class FrameLevels
+{
+    None,
+    Auto,     // AutoLevels, stretch each channel between its 0.5% quantiles
+    Equalize, // EqualizeHistogram per channel
+};
+
+struct BatchOptions
+{
+    size_t height = 1080;
+    size_t width  = 1920;
+
+    Colormap colormap  = Colormap::Plasma;
+    FrameFormat format = FrameFormat::Png;
+    FrameLevels levels = FrameLevels::None;
+
+    // Numbered files are written as <output>_<frame>.<ext>, raw and y4m frames are appended to <output> in order.
+    std::string output = "frame";
+
+    size_t frame_rate = 30; // frames per second recorded in a y4m header
+
+    size_t renderers = 2; // frames rendered concurrently on the shared dispatch pool
+    size_t encoders  = 2; // encoder threads, raw streams always use one so frames stay ordered
+    size_t buffers   = 4; // frame buffers cycled between render and encode
+};
+
+struct BatchStats
+{
+    size_t frames = 0;
+
+    double seconds          = 0.0; // wall time for the whole sequence
+    double render_seconds   = 0.0; // summed over renderer threads
+    double colorize_seconds = 0.0;
+    double encode_seconds   = 0.0; // summed over encoder threads
+    double stall_seconds    = 0.0; // renderers waiting for a free buffer
+
+    auto FramesPerSecond() const
+    {
+        return seconds > 0.0 ? frames / seconds : 0.0;
+    }
+
+    // One stage's summed seconds spread over the frames, 0 when there were none.
+    auto PerFrame(double stage_seconds) const
+    {
+        return frames > 0 ? stage_seconds / frames : 0.0;
+    }
+};
+
+inline auto NumberedFramePath(std::string const& prefix, size_t frame, FrameFormat format) -> std::string
+{
+    std::ostringstream path;
+    path << prefix << "_" << std::setw(5) << std::setfill('0') << frame << (format == FrameFormat::Png ? ".png" : ".ppm");
+    return path.str();
+}
+
+// Renders every frame from the first to the last keyframe. Renderer threads fill frame buffers
+// through the shared dispatch pool while encoder threads drain finished frames, so encoding one
+// frame overlaps rendering the next and no buffer is allocated after start-up.
+inline auto RenderZoomSequence(std::vector<Keyframe> const& keyframes, BatchOptions const& options) -> BatchStats
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct FrameBuffer
+    {
+        Tensor<float, 2> intensity;
+        Tensor<uint8_t, 3> rgb;
+        size_t frame = 0;
+    };
+
+    auto seconds_since = [](Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    };
+
+    size_t first_frame = keyframes.front().frame;
+    size_t last_frame  = keyframes.back().frame;
+
+    bool ordered     = options.format == FrameFormat::Raw || options.format == FrameFormat::Y4m;
+    size_t renderers = std::max<size_t>(options.renderers, 1);
+    size_t encoders  = ordered ? 1 : std::max<size_t>(options.encoders, 1);
+    size_t buffers   = std::max(options.buffers, renderers + 1);
+
+    std::vector<std::unique_ptr<FrameBuffer>> storage;
+    std::vector<FrameBuffer*> free_buffers;
+    for (size_t i = 0; i < buffers; ++i)
+    {
+        storage.push_back(std::make_unique<FrameBuffer>(FrameBuffer{
+            Tensor<float, 2>({options.height, options.width}),
+            Tensor<uint8_t, 3>({options.height, options.width, 3}),
+        }));
+        free_buffers.push_back(storage.back().get());
+    }
+
+    std::ofstream stream;
+    if (ordered)
+    {
+        stream.open(options.output, std::ios::binary);
+        Expect(static_cast<bool>(stream), "error: unable to open " + options.output + " for writing");
+    }
+
+    // ordered streams have a single encoder, which converts every frame into the same planes
+    bool y4m = options.format == FrameFormat::Y4m;
+    YCbCr420 yuv(y4m ? options.height : 0, y4m ? options.width : 0);
+    if (y4m)
+    {
+        stream << "YUV4MPEG2 W" << options.width << " H" << options.height << " F" << options.frame_rate << ":1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n";
+    }
+
+    std::mutex mutex;
+    std::condition_variable buffer_freed;
+    std::condition_variable frame_ready;
+    std::map<size_t, FrameBuffer*> ready;
+    size_t next_frame = first_frame; // next frame index handed to a renderer
+    size_t next_write = first_frame; // next frame an ordered writer may take
+    size_t rendering  = renderers;
+    std::exception_ptr error;
+    BatchStats stats;
+
+    // the first failure stops handing out frames and is rethrown once every thread has joined
+    auto fail = [&](std::exception_ptr exception)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!error)
+            {
+                error = exception;
+            }
+            next_frame = last_frame + 1;
+        }
+        buffer_freed.notify_all();
+    };
+
+    auto start = Clock::now();
+
+    auto render = [&]()
+    {
+        while (true)
+        {
+            FrameBuffer* buffer = nullptr;
+            {
+                // take a buffer before a frame index, so the oldest in-flight frame always holds a buffer
+                auto wait_start = Clock::now();
+                std::unique_lock<std::mutex> lock(mutex);
+                buffer_freed.wait(lock, [&]
+                {
+                    return !free_buffers.empty() || next_frame > last_frame;
+                });
+                stats.stall_seconds += seconds_since(wait_start);
+
+                if (next_frame > last_frame)
+                {
+                    break;
+                }
+
+                buffer = free_buffers.back();
+                free_buffers.pop_back();
+                buffer->frame = next_frame++;
+            }
+            buffer_freed.notify_all();
+
+            try
+            {
+                auto keyframe = InterpolateKeyframes(keyframes, buffer->frame);
+                auto view     = MandelbrotView::FromCenter(keyframe.centerReal, keyframe.centerImag, keyframe.zoom, keyframe.maxIterations, options.height, options.width);
+
+                auto render_start = Clock::now();
+                GenerateMandelbrot(buffer->intensity, view);
+                double render_time = seconds_since(render_start);
+
+                auto colorize_start = Clock::now();
+                ColorizeMandelbrot(buffer->intensity, buffer->rgb, options.colormap);
+                if (options.levels != FrameLevels::None)
+                {
+                    auto histogram = Histogram(buffer->rgb);
+                    auto luts      = options.levels == FrameLevels::Auto ? AutoLevelsLut(histogram) : EqualizationLut(histogram);
+                    ApplyLut(buffer->rgb, luts, buffer->rgb);
+                }
+                double colorize_time = seconds_since(colorize_start);
+
+                std::unique_lock<std::mutex> lock(mutex);
+                stats.render_seconds += render_time;
+                stats.colorize_seconds += colorize_time;
+                ready.emplace(buffer->frame, buffer);
+            }
+            catch (...)
+            {
+                fail(std::current_exception());
+                break;
+            }
+            frame_ready.notify_all();
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            --rendering;
+        }
+        frame_ready.notify_all();
+    };
+
+    auto encode = [&]()
+    {
+        while (true)
+        {
+            FrameBuffer* buffer = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                auto available = [&]
+                {
+                    return !ready.empty() && (!ordered || ready.begin()->first == next_write);
+                };
+
+                frame_ready.wait(lock, [&]
+                {
+                    return available() || rendering == 0;
+                });
+
+                if (!available())
+                {
+                    break;
+                }
+
+                buffer = ready.begin()->second;
+                ready.erase(ready.begin());
+                ++next_write;
+            }
+
+            auto encode_start = Clock::now();
+            try
+            {
+                switch (options.format)
+                {
+                case FrameFormat::Png:
+                    EncodePng(NumberedFramePath(options.output, buffer->frame, options.format), buffer->rgb);
+                    break;
+                case FrameFormat::Ppm:
+                    EncodePpm(NumberedFramePath(options.output, buffer->frame, options.format), buffer->rgb);
+                    break;
+                case FrameFormat::Raw:
+                    stream.write(reinterpret_cast<const char*>(buffer->rgb.Data()), buffer->rgb.Size() * sizeof(uint8_t));
+                    Expect(static_cast<bool>(stream), "error: failed writing to " + options.output);
+                    break;
+                case FrameFormat::Y4m:
+                    RgbToYCbCr420(buffer->rgb, yuv);
+                    stream << "FRAME\n";
+                    for (auto const* plane : {&yuv.y, &yuv.cb, &yuv.cr})
+                    {
+                        stream.write(reinterpret_cast<const char*>(plane->Data()), plane->Size() * sizeof(uint8_t));
+                    }
+                    Expect(static_cast<bool>(stream), "error: failed writing to " + options.output);
+                    break;
+                }
+            }
+            catch (...)
+            {
+                fail(std::current_exception());
+            }
+            double encode_time = seconds_since(encode_start);
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                stats.encode_seconds += encode_time;
+                ++stats.frames;
+                free_buffers.push_back(buffer);
+            }
+            buffer_freed.notify_all();
+            frame_ready.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < renderers; ++i)
+    {
+        threads.emplace_back(render);
+    }
+    for (size_t i = 0; i < encoders; ++i)
+    {
+        threads.emplace_back(encode);
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+
+    stats.seconds = seconds_since(start);
+    return stats;
+}
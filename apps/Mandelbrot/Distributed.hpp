@@ -0,0 +1,475 @@
+#pragma once
+
+#include "Mandelbrot.hpp"
+
+#include <Expect.hpp>
+#include <Storage.hpp>
+#include <Tensor.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <iomanip>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Renders one image with several worker processes. A coordinator hands out tiles over a socket to
+// each worker, the workers colour their tiles straight into a framebuffer file they all map shared,
+// and the coordinator encodes the file once every tile is reported done. A worker that disconnects,
+// crashes or overruns the tile timeout is lost, and its unfinished tiles go to the others.
+//
+// The protocol is newline-terminated text, so it can later run over TCP between hosts:
+//   coordinator -> worker  JOB <height> <width> <realMin> <realMax> <imagMin> <imagMax> <maxIterations> <colormap> <path>
+//                          TILE <id> <y_start> <y_stop> <x_start> <x_stop>
+//                          QUIT
+//   worker -> coordinator  DONE <id>
+
+#if defined(MATRIX_MAPPED_STORAGE)
+#include <csignal>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#define MATRIX_DISTRIBUTED_RENDER
+
+// Messages over a connected stream socket, read into a buffer until a whole line has arrived.
+class MessageChannel
+{
+private:
+
+    int fd_ = -1;
+    std::string buffer_;
+
+public:
+
+    explicit MessageChannel(int fd)
+        : fd_(fd)
+    {}
+
+    auto Fd() const -> int
+    {
+        return fd_;
+    }
+
+    // False once the peer has gone, without raising SIGPIPE.
+    auto Send(std::string const& message) -> bool
+    {
+        std::string line = message + "\n";
+        for (size_t sent = 0; sent < line.size();)
+        {
+            ssize_t count = send(fd_, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+            if (count < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (count <= 0)
+            {
+                return false;
+            }
+            sent += static_cast<size_t>(count);
+        }
+        return true;
+    }
+
+    // One read of whatever has arrived, false at the end of the stream or on an error.
+    auto Receive() -> bool
+    {
+        char chunk[4096];
+        ssize_t count;
+        do
+        {
+            count = read(fd_, chunk, sizeof(chunk));
+        } while (count < 0 && errno == EINTR);
+
+        if (count <= 0)
+        {
+            return false;
+        }
+        buffer_.append(chunk, static_cast<size_t>(count));
+        return true;
+    }
+
+    // Next complete message already received, without its newline.
+    auto Next() -> std::optional<std::string>
+    {
+        size_t end = buffer_.find('\n');
+        if (end == std::string::npos)
+        {
+            return std::nullopt;
+        }
+        std::string message = buffer_.substr(0, end);
+        buffer_.erase(0, end + 1);
+        return message;
+    }
+
+    // Blocks for the next message, nullopt at the end of the stream.
+    auto Wait() -> std::optional<std::string>
+    {
+        while (true)
+        {
+            if (auto message = Next())
+            {
+                return message;
+            }
+            if (!Receive())
+            {
+                return std::nullopt;
+            }
+        }
+    }
+};
+
+struct RenderWorker
+{
+    int fd    = -1; // coordinator's end of the socket
+    pid_t pid = -1; // reaped by the coordinator, -1 for a worker it did not start
+};
+
+struct DistributedOptions
+{
+    size_t workers = 4;   // processes started by RenderDistributed
+    size_t tile    = 256; // tile edge in pixels
+    size_t depth   = 2;   // tiles queued on each worker, so it never idles waiting for the next
+
+    double tile_timeout = 0.0; // seconds a worker may spend on one tile before it is killed as hung, 0 waits forever
+};
+
+struct DistributedStats
+{
+    size_t tiles        = 0;
+    size_t reassigned   = 0; // tiles taken back from lost workers
+    size_t lost_workers = 0;
+
+    double seconds = 0.0;
+
+    auto TilesPerSecond() const
+    {
+        return seconds > 0.0 ? tiles / seconds : 0.0;
+    }
+};
+
+struct DistributedRender
+{
+    Tensor<uint8_t, 3> image; // the mapped framebuffer file
+    DistributedStats stats;
+};
+
+// Worker side of the protocol, returns at QUIT or when the coordinator disconnects. Tiles are
+// rendered on the calling thread: a forked worker must not use the parent's dispatch pool, whose
+// threads do not exist in the child, and the processes are the parallelism anyway.
+inline auto ServeRenderWorker(int fd) -> void
+{
+    MessageChannel channel(fd);
+    std::optional<Tensor<uint8_t, 3>> framebuffer;
+    MandelbrotView view;
+    Colormap colormap = Colormap::Plasma;
+
+    while (auto message = channel.Wait())
+    {
+        std::istringstream fields(*message);
+        std::string kind;
+        fields >> kind;
+
+        if (kind == "JOB")
+        {
+            size_t height = 0, width = 0;
+            int map       = 0;
+            std::string path;
+            fields >> height >> width >> view.realMin >> view.realMax >> view.imagMin >> view.imagMax >> view.maxIterations >> map;
+            std::getline(fields >> std::ws, path);
+            Expect(!fields.fail() && !path.empty(), "error: malformed job message: " + *message);
+
+            colormap    = static_cast<Colormap>(map);
+            framebuffer = Tensor<uint8_t, 3>::Mapped(path, {height, width, 3}, MapMode::Open);
+        }
+        else if (kind == "TILE")
+        {
+            size_t id = 0, y_start = 0, y_stop = 0, x_start = 0, x_stop = 0;
+            fields >> id >> y_start >> y_stop >> x_start >> x_stop;
+            Expect(!fields.fail() && framebuffer.has_value(), "error: malformed tile message: " + *message);
+
+            auto& rgb     = *framebuffer;
+            size_t height = rgb.Shape()[0];
+            size_t width  = rgb.Shape()[1];
+            Expect(y_start <= y_stop && y_stop <= height && x_start <= x_stop && x_stop <= width, "error: tile outside the framebuffer");
+
+            for (size_t y = y_start; y < y_stop; ++y)
+            {
+                for (size_t x = x_start; x < x_stop; ++x)
+                {
+                    StoreColor(rgb, y, x, IntensityToColor(MandelbrotAt(view, height, width, y, x), colormap));
+                }
+            }
+            if (!channel.Send("DONE " + std::to_string(id)))
+            {
+                return;
+            }
+        }
+        else if (kind == "QUIT")
+        {
+            return;
+        }
+    }
+}
+
+// Forks count local workers, each connected to the coordinator by a socket pair.
+inline auto SpawnRenderWorkers(size_t count) -> std::vector<RenderWorker>
+{
+    std::vector<RenderWorker> workers;
+    for (size_t i = 0; i < count; ++i)
+    {
+        int ends[2];
+        Expect(socketpair(AF_UNIX, SOCK_STREAM, 0, ends) == 0, "error: unable to create a worker socket");
+
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            // drop the copies of earlier workers' sockets, they must see the coordinator close them
+            close(ends[0]);
+            for (auto const& worker : workers)
+            {
+                close(worker.fd);
+            }
+            int status = 0;
+            try
+            {
+                ServeRenderWorker(ends[1]);
+            }
+            catch (...)
+            {
+                status = 1;
+            }
+            _exit(status);
+        }
+
+        close(ends[1]);
+        if (pid < 0)
+        {
+            close(ends[0]);
+            Expect(false, "error: unable to start a render worker");
+        }
+        workers.push_back({ends[0], pid});
+    }
+    return workers;
+}
+
+// Coordinates the given workers to render a height x width image of view into the file at path,
+// which every worker must be able to open. Workers are closed, and reaped when they have a pid, by
+// the time this returns. Throws when every worker is lost with tiles still left.
+inline auto RenderDistributed(std::string const& path, size_t height, size_t width, Colormap colormap, MandelbrotView const& view, std::vector<RenderWorker> const& workers, DistributedOptions const& options = {}) -> DistributedRender
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Connection
+    {
+        MessageChannel channel;
+        pid_t pid  = -1;
+        bool alive = true;
+        std::deque<size_t> assigned; // tile ids in the order sent, which is the order they are rendered
+        Clock::time_point started;   // when the worker could begin the oldest of them
+    };
+
+    struct Tile
+    {
+        size_t y_start, y_stop, x_start, x_stop;
+    };
+
+    auto start = Clock::now();
+    DistributedRender render{Tensor<uint8_t, 3>::Mapped(path, {height, width, 3}), {}};
+    auto& stats = render.stats;
+
+    size_t tile = std::max<size_t>(options.tile, 1);
+    std::vector<Tile> tiles;
+    for (size_t y = 0; y < height; y += tile)
+    {
+        for (size_t x = 0; x < width; x += tile)
+        {
+            tiles.push_back({y, std::min(y + tile, height), x, std::min(x + tile, width)});
+        }
+    }
+
+    std::deque<size_t> pending;
+    for (size_t id = 0; id < tiles.size(); ++id)
+    {
+        pending.push_back(id);
+    }
+    std::vector<bool> done(tiles.size(), false);
+    size_t remaining = tiles.size();
+
+    std::vector<Connection> connections;
+    for (auto const& worker : workers)
+    {
+        connections.push_back({MessageChannel(worker.fd), worker.pid, true, {}, {}});
+    }
+
+    // a lost worker is killed, so a hung one cannot write over its tiles later, and its unfinished
+    // tiles go back to the front of the queue, they are the oldest outstanding
+    auto lose = [&](Connection& connection)
+    {
+        connection.alive = false;
+        close(connection.channel.Fd());
+        if (connection.pid > 0)
+        {
+            kill(connection.pid, SIGKILL);
+        }
+        for (auto it = connection.assigned.rbegin(); it != connection.assigned.rend(); ++it)
+        {
+            if (!done[*it])
+            {
+                pending.push_front(*it);
+                ++stats.reassigned;
+            }
+        }
+        connection.assigned.clear();
+        ++stats.lost_workers;
+    };
+
+    auto fill = [&](Connection& connection)
+    {
+        while (connection.alive && connection.assigned.size() < std::max<size_t>(options.depth, 1) && !pending.empty())
+        {
+            size_t id = pending.front();
+            pending.pop_front();
+            if (connection.assigned.empty())
+            {
+                connection.started = Clock::now();
+            }
+            connection.assigned.push_back(id);
+
+            Tile const& t = tiles[id];
+            if (!connection.channel.Send("TILE " + std::to_string(id) + " " + std::to_string(t.y_start) + " " + std::to_string(t.y_stop) + " " + std::to_string(t.x_start) + " " + std::to_string(t.x_stop)))
+            {
+                lose(connection);
+            }
+        }
+    };
+
+    std::ostringstream job;
+    job << std::setprecision(17) << "JOB " << height << " " << width << " " << view.realMin << " " << view.realMax << " "
+        << view.imagMin << " " << view.imagMax << " " << view.maxIterations << " " << static_cast<int>(colormap) << " " << path;
+    for (auto& connection : connections)
+    {
+        if (!connection.channel.Send(job.str()))
+        {
+            lose(connection);
+        }
+    }
+
+    std::exception_ptr error;
+    try
+    {
+        while (remaining > 0)
+        {
+            for (auto& connection : connections)
+            {
+                fill(connection);
+            }
+
+            std::vector<pollfd> polls;
+            std::vector<Connection*> polled;
+            for (auto& connection : connections)
+            {
+                if (connection.alive)
+                {
+                    polls.push_back({connection.channel.Fd(), POLLIN, 0});
+                    polled.push_back(&connection);
+                }
+            }
+            Expect(!polls.empty(), "error: every render worker was lost with " + std::to_string(remaining) + " tiles left");
+
+            // with a timeout, wake up often enough to notice a hung worker
+            int wait_ms = options.tile_timeout > 0.0 ? std::clamp(static_cast<int>(options.tile_timeout * 250.0), 1, 100) : -1;
+            if (poll(polls.data(), polls.size(), wait_ms) < 0 && errno != EINTR)
+            {
+                Expect(false, "error: polling render workers failed");
+            }
+
+            for (size_t i = 0; i < polls.size(); ++i)
+            {
+                Connection& connection = *polled[i];
+                if (polls[i].revents == 0)
+                {
+                    continue;
+                }
+                if (!connection.channel.Receive())
+                {
+                    lose(connection);
+                    continue;
+                }
+                while (auto message = connection.channel.Next())
+                {
+                    std::istringstream fields(*message);
+                    std::string kind;
+                    size_t id = 0;
+                    fields >> kind >> id;
+                    auto assigned = std::find(connection.assigned.begin(), connection.assigned.end(), id);
+                    if (kind != "DONE" || fields.fail() || assigned == connection.assigned.end())
+                    {
+                        continue;
+                    }
+
+                    // the tiles queued behind this one were waiting, not running, until now
+                    if (assigned == connection.assigned.begin())
+                    {
+                        connection.started = Clock::now();
+                    }
+                    connection.assigned.erase(assigned);
+                    if (!done[id])
+                    {
+                        done[id] = true;
+                        --remaining;
+                        ++stats.tiles;
+                    }
+                }
+            }
+
+            // only the oldest outstanding tile is being rendered, so only it is timed
+            if (options.tile_timeout > 0.0)
+            {
+                auto now = Clock::now();
+                for (auto& connection : connections)
+                {
+                    if (connection.alive && !connection.assigned.empty() && std::chrono::duration<double>(now - connection.started).count() > options.tile_timeout)
+                    {
+                        lose(connection);
+                    }
+                }
+            }
+        }
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+
+    for (auto& connection : connections)
+    {
+        if (connection.alive)
+        {
+            connection.channel.Send("QUIT");
+            close(connection.channel.Fd());
+        }
+        if (connection.pid > 0)
+        {
+            waitpid(connection.pid, nullptr, 0);
+        }
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+
+    stats.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return render;
+}
+
+// Starts options.workers local worker processes for the render.
+inline auto RenderDistributed(std::string const& path, size_t height, size_t width, Colormap colormap, MandelbrotView const& view = {}, DistributedOptions const& options = {}) -> DistributedRender
+{
+    return RenderDistributed(path, height, width, colormap, view, SpawnRenderWorkers(std::max<size_t>(options.workers, 1)), options);
+}
+#endif
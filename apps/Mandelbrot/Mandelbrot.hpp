@@ -1,76 +1,347 @@
 #pragma once
 
 #include <Dispatcher.hpp>
+#include <TaskGraph.hpp>
 #include <Tensor.hpp>
 
 #include "ColorMap.hpp"
 
 #include <complex>
+#include <cstdint>
+#include <string>
+#include <vector>
 
-auto GenerateMandelbrot(size_t height, size_t width) -> Tensor<float, 2>
+struct MandelbrotView
 {
+    double realMin = -2.5, realMax = 1.0;
+    double imagMin = -1.0, imagMax = 1.0;
+
     size_t maxIterations = 200;
 
-    Tensor<float, 2> intensity({height, width}, 0.0f);
+    // View of the given zoom around a centre point, zoom 1 spans the same real range as the default view.
+    static auto FromCenter(double centerReal, double centerImag, double zoom, size_t maxIterations, size_t height, size_t width) -> MandelbrotView
+    {
+        double halfReal = 1.75 / zoom;
+        double halfImag = halfReal * static_cast<double>(height) / static_cast<double>(width);
+
+        return {centerReal - halfReal, centerReal + halfReal, centerImag - halfImag, centerImag + halfImag, maxIterations};
+    }
+};
+
+// Smooth escape-time intensity in [0, 1] for the point c = real + imag * i, 0 for points inside the set.
+inline auto MandelbrotIntensity(double real, double imag, size_t maxIterations) -> float
+{
+    std::complex<double> c(real, imag);
+    std::complex<double> z(0.0, 0.0);
+
+    size_t iteration = 0;
+    while (std::abs(z) < 2.0 && iteration < maxIterations)
+    {
+        z = z * z + c;
+        ++iteration;
+    }
+
+    if (iteration < maxIterations)
+    {
+        double absz = std::abs(z);
+        if (absz == 0.0)
+        {
+            absz = 1e-10;
+        }
+
+        double mu = iteration - std::log(std::log(absz)) / std::log(2.0);
+
+        return mu / static_cast<double>(maxIterations);
+    }
+
+    return 0.0;
+}
+
+// Intensity of pixel (y, x) in a height x width render of view.
+inline auto MandelbrotAt(MandelbrotView const& view, size_t height, size_t width, size_t y, size_t x) -> float
+{
+    double real = view.realMin + (static_cast<double>(x) / (width - 1)) * (view.realMax - view.realMin);
+    double imag = view.imagMin + (static_cast<double>(y) / (height - 1)) * (view.imagMax - view.imagMin);
+
+    return MandelbrotIntensity(real, imag, view.maxIterations);
+}
 
-    const double realMin = -2.5, realMax = 1.0;
-    const double imagMin = -1.0, imagMax = 1.0;
+// Intensities fit comfortably in a Float16 or BFloat16 field when memory matters more than precision.
+template <Real T>
+auto GenerateMandelbrot(Tensor<T, 2>& intensity, MandelbrotView const& view = {}) -> void
+{
+    auto [height, width] = intensity.Shape();
 
+    TraceRegion region("GenerateMandelbrot");
     Dispatch2d(height, width, [&](size_t y, size_t x)
     {
-        double real = realMin + (static_cast<double>(x) / (width - 1)) * (realMax - realMin);
-        double imag = imagMin + (static_cast<double>(y) / (height - 1)) * (imagMax - imagMin);
+        intensity(y, x) = static_cast<T>(MandelbrotAt(view, height, width, y, x));
+    });
+}
 
-        std::complex<double> c(real, imag);
-        std::complex<double> z(0.0, 0.0);
+template <Real T = float>
+auto GenerateMandelbrot(size_t height, size_t width, MandelbrotView const& view = {}) -> Tensor<T, 2>
+{
+    Tensor<T, 2> intensity({height, width});
+    GenerateMandelbrot(intensity, view);
+    return intensity;
+}
 
-        size_t iteration = 0;
-        while (std::abs(z) < 2.0 && iteration < maxIterations)
+inline auto IntensityToColor(double t, Colormap colormap) -> Color
+{
+    const double gamma = 1.0;
+
+    t = std::pow(t, gamma);
+    t = std::clamp(t, 0.0, 1.0);
+
+    return getColorFromColormap(colormap, t);
+}
+
+inline auto StoreColor(Tensor<uint8_t, 3>& rgb, size_t y, size_t x, Color const& col) -> void
+{
+    rgb(y, x, 0) = static_cast<unsigned char>(std::clamp(col.r * 255.0, 0.0, 255.0));
+    rgb(y, x, 1) = static_cast<unsigned char>(std::clamp(col.g * 255.0, 0.0, 255.0));
+    rgb(y, x, 2) = static_cast<unsigned char>(std::clamp(col.b * 255.0, 0.0, 255.0));
+}
+
+template <Real T>
+auto ColorizeMandelbrot(Tensor<T, 2> const& intensity, Tensor<uint8_t, 3>& rgb, Colormap colormap) -> void
+{
+    auto [height, width] = intensity.Shape();
+    Expect(rgb.Shape() == std::array<size_t, 3>{height, width, 3}, "output tensor must be height x width x 3");
+
+    TraceRegion region("ColorizeMandelbrot");
+    Dispatch2d(height, width, [&](size_t y, size_t x)
+    {
+        StoreColor(rgb, y, x, IntensityToColor(intensity(y, x), colormap));
+    });
+}
+
+template <Real T>
+auto ColorizeMandelbrot(Tensor<T, 2> const& intensity, Colormap colormap) -> Tensor<uint8_t, 3>
+{
+    auto [height, width] = intensity.Shape();
+    Tensor<uint8_t, 3> rgb({height, width, 3}, 0);
+    ColorizeMandelbrot(intensity, rgb, colormap);
+    return rgb;
+}
+
+struct MandelbrotTasks
+{
+    TileGrid grid;
+    std::vector<TaskGraph::TaskId> render;   // per tile of grid
+    std::vector<TaskGraph::TaskId> colorize; // per tile of grid, each after the render of its tile
+};
+
+// Declares render and colorize per tile, so colouring a tile starts as soon as that tile is rendered
+// instead of after a full-frame barrier. Further stages can depend on the returned tasks. The view
+// is copied into the tasks, the tensors must outlive the run.
+template <Real T>
+auto AddMandelbrotTasks(TaskGraph& graph, Tensor<T, 2>& intensity, Tensor<uint8_t, 3>& rgb, Colormap colormap, MandelbrotView const& view = {}) -> MandelbrotTasks
+{
+    auto [height, width] = intensity.Shape();
+    Expect(rgb.Shape() == std::array<size_t, 3>{height, width, 3}, "output tensor must be height x width x 3");
+
+    MandelbrotTasks tasks;
+    tasks.grid = {height, width};
+
+    for (size_t tile = 0; tile < tasks.grid.Count(); ++tile)
+    {
+        auto bounds = tasks.grid.TileBounds(tile);
+
+        auto render = graph.Add("GenerateMandelbrot", [&intensity, view, bounds, height, width]()
         {
-            z = z * z + c;
-            ++iteration;
-        }
+            for (size_t y = bounds.y_start; y < bounds.y_stop; ++y)
+            {
+                for (size_t x = bounds.x_start; x < bounds.x_stop; ++x)
+                {
+                    intensity(y, x) = static_cast<T>(MandelbrotAt(view, height, width, y, x));
+                }
+            }
+        });
 
-        if (iteration < maxIterations)
+        auto colorize = graph.Add("ColorizeMandelbrot", [&intensity, &rgb, bounds, colormap]()
         {
-            double absz = std::abs(z);
-            if (absz == 0.0)
+            for (size_t y = bounds.y_start; y < bounds.y_stop; ++y)
             {
-                absz = 1e-10;
+                for (size_t x = bounds.x_start; x < bounds.x_stop; ++x)
+                {
+                    StoreColor(rgb, y, x, IntensityToColor(intensity(y, x), colormap));
+                }
             }
+        }, {render});
 
-            double mu = iteration - std::log(std::log(absz)) / std::log(2.0);
+        tasks.render.push_back(render);
+        tasks.colorize.push_back(colorize);
+    }
 
-            intensity(y, x) = mu / static_cast<double>(maxIterations);
+    return tasks;
+}
+
+// T is the storage type of the intermediate intensity field, Float16 halves it at no visible cost.
+template <Real T = float>
+auto GenerateMandelbrotImage(size_t height, size_t width, Colormap colormap) -> Tensor<uint8_t, 3>
+{
+    Tensor<T, 2> intensity({height, width});
+    Tensor<uint8_t, 3> rgb({height, width, 3});
+
+    MandelbrotView view;
+    TaskGraph graph;
+    AddMandelbrotTasks(graph, intensity, rgb, colormap, view);
+    graph.Run();
+
+    return rgb;
+}
+
+// Renders straight into a file-backed image for posters larger than RAM, e.g. 65536 x 65536. Intensity
+// and colour are computed together per pixel, so no intensity field is stored at all.
+inline auto GenerateMandelbrotPoster(std::string const& filename, size_t height, size_t width, Colormap colormap, MandelbrotView const& view = {}) -> Tensor<uint8_t, 3>
+{
+    auto rgb = Tensor<uint8_t, 3>::Mapped(filename, {height, width, 3});
+
+    TraceRegion region("GenerateMandelbrotPoster");
+    DispatchStreaming(height, width, [&](size_t y, size_t x)
+    {
+        StoreColor(rgb, y, x, IntensityToColor(MandelbrotAt(view, height, width, y, x), colormap));
+    }, rgb);
+
+    return rgb;
+}
+
+struct AntialiasOptions
+{
+    size_t samples  = 4;     // sub-samples per axis for each edge pixel
+    float threshold = 0.02f; // neighbour intensity difference that marks a pixel as an edge
+    bool jitter     = true;  // stratified random offsets instead of a regular grid
+};
+
+// Deterministic [0, 1) offset so jittered renders are reproducible.
+inline auto SampleJitter(uint64_t pixel, uint64_t sample) -> double
+{
+    uint64_t h = pixel * 0x9E3779B97F4A7C15ull + sample;
+    h          = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+    h          = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+    h          = h ^ (h >> 31);
+    return static_cast<double>(h >> 11) * 0x1.0p-53;
+}
+
+// Renders at the target resolution, then supersamples only the pixels whose 8-neighbourhood
+// differs by more than the threshold. Edge pixels are gathered into a flat list so the
+// supersampling pass is split into equal-sized batches regardless of where the edges cluster.
+auto GenerateMandelbrotImageAdaptive(size_t height, size_t width, Colormap colormap, AntialiasOptions const& options = {}, MandelbrotView const& view = {}) -> Tensor<uint8_t, 3>
+{
+    Tensor<float, 2> intensity({height, width});
+    Tensor<uint8_t, 3> rgb({height, width, 3});
+
+    TaskGraph graph;
+    auto tasks = AddMandelbrotTasks(graph, intensity, rgb, colormap, view);
+
+    if (options.samples <= 1)
+    {
+        graph.Run();
+        return rgb;
+    }
+
+    Tensor<uint8_t, 2> edge({height, width}, 0);
+
+    auto detect = [&](size_t y, size_t x)
+    {
+        float center = intensity(y, x);
+
+        size_t y_start = y > 0 ? y - 1 : y;
+        size_t y_stop  = std::min(y + 1, height - 1);
+        size_t x_start = x > 0 ? x - 1 : x;
+        size_t x_stop  = std::min(x + 1, width - 1);
+
+        for (size_t ny = y_start; ny <= y_stop; ++ny)
+        {
+            for (size_t nx = x_start; nx <= x_stop; ++nx)
+            {
+                if (std::abs(intensity(ny, nx) - center) > options.threshold)
+                {
+                    edge(y, x) = 1;
+                    return;
+                }
+            }
         }
-        else
+    };
+
+    // edge detection reads a one-pixel halo, so each tile waits for its neighbours' renders only
+    TileGrid const& grid = tasks.grid;
+    for (size_t tile = 0; tile < grid.Count(); ++tile)
+    {
+        size_t row    = tile / grid.Columns();
+        size_t column = tile % grid.Columns();
+
+        std::vector<TaskGraph::TaskId> neighbours;
+        for (size_t r = row > 0 ? row - 1 : row; r <= std::min(row + 1, grid.Rows() - 1); ++r)
         {
-            intensity(y, x) = 0.0;
+            for (size_t c = column > 0 ? column - 1 : column; c <= std::min(column + 1, grid.Columns() - 1); ++c)
+            {
+                neighbours.push_back(tasks.render[grid.Index(r, c)]);
+            }
         }
-    });
 
-    return intensity;
-}
+        auto bounds = grid.TileBounds(tile);
+        graph.Add("DetectEdges", [&detect, bounds]()
+        {
+            for (size_t y = bounds.y_start; y < bounds.y_stop; ++y)
+            {
+                for (size_t x = bounds.x_start; x < bounds.x_stop; ++x)
+                {
+                    detect(y, x);
+                }
+            }
+        }, neighbours);
+    }
 
-auto GenerateMandelbrotImage(size_t height, size_t width, Colormap colormap) -> Tensor<uint8_t, 3>
-{
-    auto intensity = GenerateMandelbrot(height, width);
-    Tensor<uint8_t, 3> rgb({height, width, 3}, 0);
+    graph.Run();
 
-    const double gamma = 1.0;
+    std::vector<size_t> edges;
+    for (size_t i = 0; i < edge.Size(); ++i)
+    {
+        if (edge.Data()[i])
+        {
+            edges.push_back(i);
+        }
+    }
 
-    Dispatch2d(height, width, [&](size_t y, size_t x)
+    double pixelReal = (view.realMax - view.realMin) / (width - 1);
+    double pixelImag = (view.imagMax - view.imagMin) / (height - 1);
+    size_t samples   = options.samples;
+
+    TraceRegion supersample_region("Supersample");
+    Dispatch1d(edges.size(), [&](size_t i)
     {
-        double t = intensity(y, x);
+        size_t y = edges[i] / width;
+        size_t x = edges[i] % width;
+
+        Color sum = {0.0, 0.0, 0.0};
 
-        t = std::pow(t, gamma);
-        t = std::clamp(t, 0.0, 1.0);
+        for (size_t sy = 0; sy < samples; ++sy)
+        {
+            for (size_t sx = 0; sx < samples; ++sx)
+            {
+                size_t sample = sy * samples + sx;
+
+                double offset_y = options.jitter ? SampleJitter(edges[i], 2 * sample) : 0.5;
+                double offset_x = options.jitter ? SampleJitter(edges[i], 2 * sample + 1) : 0.5;
+
+                double dy = (sy + offset_y) / samples - 0.5;
+                double dx = (sx + offset_x) / samples - 0.5;
 
-        Color col = getColorFromColormap(colormap, t);
+                double real = view.realMin + (x + dx) * pixelReal;
+                double imag = view.imagMin + (y + dy) * pixelImag;
+
+                Color col = IntensityToColor(MandelbrotIntensity(real, imag, view.maxIterations), colormap);
+                sum.r += col.r;
+                sum.g += col.g;
+                sum.b += col.b;
+            }
+        }
 
-        rgb(y, x, 0) = static_cast<unsigned char>(std::clamp(col.r * 255.0, 0.0, 255.0));
-        rgb(y, x, 1) = static_cast<unsigned char>(std::clamp(col.g * 255.0, 0.0, 255.0));
-        rgb(y, x, 2) = static_cast<unsigned char>(std::clamp(col.b * 255.0, 0.0, 255.0));
+        double count = static_cast<double>(samples * samples);
+        StoreColor(rgb, y, x, {sum.r / count, sum.g / count, sum.b / count});
     });
 
     return rgb;
@@ -0,0 +1,341 @@
+#pragma once
+
+#include "Mandelbrot.hpp"
+
+#include <Dispatcher.hpp>
+#include <Expect.hpp>
+#include <Tensor.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <compare>
+#include <complex>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// Interactive rendering on a fixed pixel lattice per zoom level: pixel (y, x) of level L is the point
+// (x + iy) * step / 2^L wherever the view is centred, so frames panned by any whole number of pixels
+// share their pixels. Those are cached tile by tile with each pixel's orbit, escaped or not.
+
+struct ProgressiveView
+{
+    double centerReal = -0.75, centerImag = 0.0;
+
+    int level            = 0; // zoom 2^level, each level halves the pixel step
+    size_t maxIterations = 200;
+};
+
+struct ProgressiveOptions
+{
+    size_t tile           = 128;          // lattice pixels per side of a cached tile
+    size_t capacity       = 256;          // tiles kept, the least recently used dropped first
+    size_t preview_stride = 8;            // pixel step of the first pass, halved each pass down to 1
+    double step           = 3.5 / 1024.0; // complex units per pixel at level 0
+};
+
+struct ProgressiveStats
+{
+    size_t passes = 0;
+
+    size_t tile_hits   = 0; // tiles of the frame found in the cache
+    size_t tile_misses = 0;
+
+    size_t pixels_reused   = 0; // escaped below the budget or already iterated to it
+    size_t pixels_resumed  = 0; // orbits continued from a lower budget
+    size_t pixels_computed = 0; // orbits started from zero
+
+    double first_preview_seconds = 0.0; // until the coarsest pass was ready
+    double seconds               = 0.0;
+
+    auto HitRate() const
+    {
+        size_t lookups = tile_hits + tile_misses;
+        return lookups > 0 ? static_cast<double>(tile_hits) / lookups : 0.0;
+    }
+};
+
+// One pixel's orbit, kept so a raised iteration budget continues where the last one stopped.
+struct OrbitState
+{
+    std::complex<double> z = 0.0;
+    double smooth          = 0.0; // escape count with its fractional part, once escaped
+    uint32_t iterations    = 0;
+    bool escaped           = false;
+};
+
+// Iterates orbit up to budget with the steps and escape test of MandelbrotIntensity, so a resumed
+// orbit ends exactly where one run from zero would.
+inline auto AdvanceOrbit(OrbitState& orbit, std::complex<double> c, size_t budget) -> void
+{
+    if (orbit.escaped || orbit.iterations >= budget)
+    {
+        return;
+    }
+
+    std::complex<double> z = orbit.z;
+    size_t iteration       = orbit.iterations;
+    while (std::abs(z) < 2.0 && iteration < budget)
+    {
+        z = z * z + c;
+        ++iteration;
+    }
+
+    orbit.z          = z;
+    orbit.iterations = static_cast<uint32_t>(iteration);
+    if (std::abs(z) >= 2.0)
+    {
+        orbit.escaped = true;
+        orbit.smooth  = iteration - std::log(std::log(std::abs(z))) / std::log(2.0);
+    }
+}
+
+// MandelbrotIntensity of the orbit's point under budget, which may be below the budget it was run to.
+inline auto OrbitIntensity(OrbitState const& orbit, size_t budget) -> float
+{
+    return orbit.escaped && orbit.iterations < budget ? static_cast<float>(orbit.smooth / static_cast<double>(budget)) : 0.0f;
+}
+
+inline auto FloorDivide(int64_t value, int64_t divisor) -> int64_t
+{
+    return value / divisor - (value % divisor < 0 ? 1 : 0);
+}
+
+struct TileKey
+{
+    int level;
+    int64_t y, x; // tile indices on the level's lattice
+
+    auto operator<=>(TileKey const&) const = default;
+};
+
+// Orbits of tile x tile lattice pixels by position, the least recently used tiles dropped beyond
+// capacity. Tiles used by the current frame are never dropped, so a frame larger than the capacity
+// keeps all of its tiles until the next one begins.
+class TileCache
+{
+private:
+
+    struct Entry
+    {
+        std::vector<OrbitState> orbits;
+        uint64_t last_used = 0;
+    };
+
+    std::map<TileKey, Entry> tiles_;
+    size_t tile_;
+    size_t capacity_;
+    uint64_t frame_ = 0;
+
+public:
+
+    TileCache(size_t tile, size_t capacity)
+        : tile_(tile)
+        , capacity_(capacity)
+    {
+        Expect(tile > 0, "error: cached tiles need a size");
+    }
+
+    auto BeginFrame() -> void
+    {
+        ++frame_;
+    }
+
+    // Orbits of the tile at key, row-major, created unstarted on a miss. They stay put until the
+    // tile is dropped.
+    auto Acquire(TileKey const& key, bool& hit) -> OrbitState*
+    {
+        auto [entry, inserted] = tiles_.try_emplace(key);
+        if (inserted)
+        {
+            entry->second.orbits.resize(tile_ * tile_);
+        }
+        entry->second.last_used = frame_;
+        hit                     = !inserted;
+        return entry->second.orbits.data();
+    }
+
+    auto Trim() -> void
+    {
+        if (tiles_.size() <= capacity_)
+        {
+            return;
+        }
+
+        std::vector<std::map<TileKey, Entry>::iterator> unused;
+        for (auto entry = tiles_.begin(); entry != tiles_.end(); ++entry)
+        {
+            if (entry->second.last_used < frame_)
+            {
+                unused.push_back(entry);
+            }
+        }
+        std::sort(unused.begin(), unused.end(), [](auto a, auto b)
+        {
+            return a->second.last_used < b->second.last_used;
+        });
+
+        for (size_t i = 0; i < unused.size() && tiles_.size() > capacity_; ++i)
+        {
+            tiles_.erase(unused[i]);
+        }
+    }
+
+    auto Size() const -> size_t
+    {
+        return tiles_.size();
+    }
+
+    auto Clear() -> void
+    {
+        tiles_.clear();
+    }
+};
+
+// Renders views coarse to fine over a tile cache. Each pass computes the pixels on a grid of stride
+// pixels and fills stride x stride blocks with them, halving stride down to 1; every computed pixel
+// is final, so later passes and later frames only add to it. One render at a time per renderer.
+class ProgressiveRenderer
+{
+private:
+
+    ProgressiveOptions options_;
+    TileCache cache_;
+
+public:
+
+    explicit ProgressiveRenderer(ProgressiveOptions const& options = {})
+        : options_(options)
+        , cache_(options.tile, options.capacity)
+    {}
+
+    // Calls on_pass(stride, intensity) after each pass, on the calling thread.
+    template <typename OnPass>
+    auto Render(ProgressiveView const& view, Tensor<float, 2>& intensity, OnPass&& on_pass) -> ProgressiveStats
+    {
+        using Clock = std::chrono::steady_clock;
+
+        auto start = Clock::now();
+        auto seconds_since = [](Clock::time_point since)
+        {
+            return std::chrono::duration<double>(Clock::now() - since).count();
+        };
+
+        auto [height, width] = intensity.Shape();
+        Expect(height > 0 && width > 0, "error: a progressive render needs a non-empty frame");
+
+        int64_t tile    = static_cast<int64_t>(options_.tile);
+        double step     = std::ldexp(options_.step, -view.level);
+        size_t budget   = view.maxIterations;
+        int64_t frame_x = std::llround(view.centerReal / step) - static_cast<int64_t>(width / 2);
+        int64_t frame_y = std::llround(view.centerImag / step) - static_cast<int64_t>(height / 2);
+
+        // every tile under the frame is looked up here, the passes only touch orbits inside them
+        int64_t first_x = FloorDivide(frame_x, tile);
+        int64_t first_y = FloorDivide(frame_y, tile);
+        size_t columns  = static_cast<size_t>(FloorDivide(frame_x + static_cast<int64_t>(width) - 1, tile) - first_x + 1);
+        size_t rows     = static_cast<size_t>(FloorDivide(frame_y + static_cast<int64_t>(height) - 1, tile) - first_y + 1);
+
+        ProgressiveStats stats;
+        std::vector<OrbitState*> tiles(rows * columns);
+        cache_.BeginFrame();
+        for (size_t row = 0; row < rows; ++row)
+        {
+            for (size_t column = 0; column < columns; ++column)
+            {
+                bool hit                      = false;
+                tiles[row * columns + column] = cache_.Acquire({view.level, first_y + static_cast<int64_t>(row), first_x + static_cast<int64_t>(column)}, hit);
+                ++(hit ? stats.tile_hits : stats.tile_misses);
+            }
+        }
+        cache_.Trim();
+
+        auto orbit_at = [&](size_t y, size_t x) -> OrbitState&
+        {
+            int64_t lattice_y  = frame_y + static_cast<int64_t>(y);
+            int64_t lattice_x  = frame_x + static_cast<int64_t>(x);
+            int64_t tile_y     = FloorDivide(lattice_y, tile);
+            int64_t tile_x     = FloorDivide(lattice_x, tile);
+            OrbitState* orbits = tiles[static_cast<size_t>(tile_y - first_y) * columns + static_cast<size_t>(tile_x - first_x)];
+            return orbits[(lattice_y - tile_y * tile) * tile + (lattice_x - tile_x * tile)];
+        };
+
+        // power-of-two strides, so each pass's grid holds the previous one and every pixel is
+        // visited by exactly one pass, where it is also counted
+        std::array<std::atomic<size_t>, 3> counts = {0, 0, 0};
+        size_t stride   = std::bit_floor(std::max<size_t>(options_.preview_stride, 1));
+        size_t previous = 0;
+        for (; stride > 0; previous = stride, stride /= 2)
+        {
+            size_t grid_height = (height + stride - 1) / stride;
+            size_t grid_width  = (width + stride - 1) / stride;
+            size_t block       = std::max<size_t>(options_.tile / stride, 1);
+
+            DispatchBlocks(grid_height, grid_width, block, block, [&](size_t i_start, size_t i_stop, size_t j_start, size_t j_stop)
+            {
+                std::array<size_t, 3> local = {0, 0, 0};
+                for (size_t i = i_start; i < i_stop; ++i)
+                {
+                    for (size_t j = j_start; j < j_stop; ++j)
+                    {
+                        size_t y = i * stride;
+                        size_t x = j * stride;
+
+                        // pixels of the previous grid already fill their block at this stride
+                        if (previous > 0 && y % previous == 0 && x % previous == 0)
+                        {
+                            continue;
+                        }
+
+                        OrbitState& orbit = orbit_at(y, x);
+                        ++local[orbit.escaped || orbit.iterations >= budget ? 0 : orbit.iterations > 0 ? 1 : 2];
+
+                        std::complex<double> c(static_cast<double>(frame_x + static_cast<int64_t>(x)) * step, static_cast<double>(frame_y + static_cast<int64_t>(y)) * step);
+                        AdvanceOrbit(orbit, c, budget);
+
+                        float value = OrbitIntensity(orbit, budget);
+                        for (size_t v = y; v < std::min(y + stride, height); ++v)
+                        {
+                            for (size_t u = x; u < std::min(x + stride, width); ++u)
+                            {
+                                intensity(v, u) = value;
+                            }
+                        }
+                    }
+                }
+                for (size_t k = 0; k < 3; ++k)
+                {
+                    counts[k] += local[k];
+                }
+            });
+
+            if (stats.passes++ == 0)
+            {
+                stats.first_preview_seconds = seconds_since(start);
+            }
+            on_pass(stride, static_cast<Tensor<float, 2> const&>(intensity));
+        }
+
+        stats.pixels_reused   = counts[0];
+        stats.pixels_resumed  = counts[1];
+        stats.pixels_computed = counts[2];
+        stats.seconds         = seconds_since(start);
+        return stats;
+    }
+
+    auto Render(ProgressiveView const& view, Tensor<float, 2>& intensity) -> ProgressiveStats
+    {
+        return Render(view, intensity, [](size_t, Tensor<float, 2> const&)
+        {
+        });
+    }
+
+    auto Cache() -> TileCache&
+    {
+        return cache_;
+    }
+};
@@ -1,9 +1,13 @@
 #include "argparse/argparse.hpp"
 
+#include "Animation.hpp"
+#include "Distributed.hpp"
 #include "Mandelbrot.hpp"
+#include "Progressive.hpp"
 
 #include <PNG.hpp>
 #include <PPM.hpp>
+#include <TaskGraph.hpp>
 #include <Tensor.hpp>
 
 int main(int argc, char* argv[])
@@ -19,6 +23,86 @@ int main(int argc, char* argv[])
         .default_value(std::string("plasma"))
         .help("Which colormap to use: plasma, inferno, or magma");
 
+    // Adaptive antialiasing instead of rendering an oversized image
+    program.add_argument("--adaptive")
+        .default_value(false)
+        .implicit_value(true)
+        .help("Render at 4K and supersample only edge pixels instead of rendering at 4x resolution");
+
+    program.add_argument("--samples")
+        .default_value(4)
+        .scan<'i', int>()
+        .help("Sub-samples per axis for each edge pixel in adaptive mode");
+
+    program.add_argument("--threshold")
+        .default_value(0.02)
+        .scan<'g', double>()
+        .help("Neighbour intensity difference that marks a pixel as an edge in adaptive mode");
+
+    program.add_argument("--grid")
+        .default_value(false)
+        .implicit_value(true)
+        .help("Use a regular sub-sample grid instead of jittered sub-samples in adaptive mode");
+
+    program.add_argument("--trace")
+        .default_value(std::string(""))
+        .help("Write a Chrome trace-event JSON of every dispatched tile (needs a MATRIX_ENABLE_TRACING build)");
+
+    // Batch zoom animation, output becomes a frame prefix or a raw stream path
+    program.add_argument("--keyframes")
+        .default_value(std::string(""))
+        .help("Render a zoom sequence from a keyframe file of \"frame centerReal centerImag zoom iterations\" lines");
+
+    program.add_argument("--format")
+        .default_value(std::string("png"))
+        .help("Batch output: png or ppm numbered frames, raw for one rgb24 stream or y4m for one YUV 4:2:0 stream");
+
+    program.add_argument("--levels")
+        .default_value(std::string("none"))
+        .help("Batch tone adjustment per frame: none, auto (auto-levels) or equalize");
+
+    program.add_argument("--width")
+        .default_value(1920)
+        .scan<'i', int>()
+        .help("Frame width in batch and poster mode");
+
+    program.add_argument("--height")
+        .default_value(1080)
+        .scan<'i', int>()
+        .help("Frame height in batch and poster mode");
+
+    // Out-of-core render, the image lives in a memory-mapped file instead of RAM
+    program.add_argument("--poster")
+        .default_value(false)
+        .implicit_value(true)
+        .help("Render a --width x --height poster into a file-backed image at <output>.rgb, then encode the PPM from it");
+
+    program.add_argument("--workers")
+        .default_value(0)
+        .scan<'i', int>()
+        .help("Render the poster with this many worker processes writing into the shared <output>.rgb, 0 renders in-process");
+
+    program.add_argument("--tile-timeout")
+        .default_value(0.0)
+        .scan<'g', double>()
+        .help("Seconds a worker may spend on one tile before it is killed and its tiles reassigned, 0 waits forever");
+
+    // Interactive path: coarse-to-fine passes over a tile cache, then a pan and a deeper budget
+    program.add_argument("--progressive")
+        .default_value(false)
+        .implicit_value(true)
+        .help("Render a --width x --height frame progressively, pan it by a quarter and double its iterations, reporting preview latency and cache hits");
+
+    program.add_argument("--renderers")
+        .default_value(2)
+        .scan<'i', int>()
+        .help("Frames rendered concurrently in batch mode");
+
+    program.add_argument("--encoders")
+        .default_value(2)
+        .scan<'i', int>()
+        .help("Encoder threads in batch mode");
+
     try
     {
         program.parse_args(argc, argv);
@@ -54,16 +138,195 @@ int main(int argc, char* argv[])
         colormapChoice = Colormap::Plasma;
     }
 
+    std::string tracePath = program.get<std::string>("--trace");
+    if (!tracePath.empty() && !TracingEnabled)
+    {
+        std::cerr << "Tracing is not compiled in, reconfigure with -DMATRIX_ENABLE_TRACING=ON to use --trace.\n";
+    }
+
+    auto writeTrace = [&]()
+    {
+        if (tracePath.empty() || !TracingEnabled)
+        {
+            return;
+        }
+
+        auto summary = Tracer::Instance().Summary();
+        std::cout << summary.tasks << " tiles on " << summary.workers << " workers, "
+                  << 100.0 * summary.utilization << "% utilization, "
+                  << summary.queue_wait_seconds / std::max<size_t>(summary.tasks, 1) * 1e3 << " ms mean queue wait, "
+                  << summary.tail_seconds * 1e3 << " ms straggler tail, "
+                  << summary.steals << " stolen\n";
+
+        Tracer::Instance().WriteChromeTrace(tracePath);
+    };
+
+    std::string keyframesPath = program.get<std::string>("--keyframes");
+    if (!keyframesPath.empty())
+    {
+        std::string formatStr = program.get<std::string>("--format");
+        std::string levelsStr = program.get<std::string>("--levels");
+
+        BatchOptions options;
+        options.height    = static_cast<size_t>(std::max(program.get<int>("--height"), 2));
+        options.width     = static_cast<size_t>(std::max(program.get<int>("--width"), 2));
+        options.colormap  = colormapChoice;
+        options.format    = formatStr == "raw" ? FrameFormat::Raw : formatStr == "y4m" ? FrameFormat::Y4m : formatStr == "ppm" ? FrameFormat::Ppm : FrameFormat::Png;
+        options.levels    = levelsStr == "equalize" ? FrameLevels::Equalize : levelsStr == "auto" ? FrameLevels::Auto : FrameLevels::None;
+        options.output    = outputPath;
+        options.renderers = static_cast<size_t>(std::max(program.get<int>("--renderers"), 1));
+        options.encoders  = static_cast<size_t>(std::max(program.get<int>("--encoders"), 1));
+
+        auto stats = RenderZoomSequence(LoadKeyframes(keyframesPath), options);
+
+        std::cout << stats.frames << " frames in " << stats.seconds << " s (" << stats.FramesPerSecond() << " fps)\n";
+        std::cout << "  render   " << stats.PerFrame(stats.render_seconds) << " s/frame\n";
+        std::cout << "  colorize " << stats.PerFrame(stats.colorize_seconds) << " s/frame\n";
+        std::cout << "  encode   " << stats.PerFrame(stats.encode_seconds) << " s/frame\n";
+        std::cout << "  stalled  " << stats.stall_seconds << " s waiting for free frame buffers\n";
+
+        writeTrace();
+        return 0;
+    }
+
+    if (program.get<bool>("--progressive"))
+    {
+        size_t frameHeight = static_cast<size_t>(std::max(program.get<int>("--height"), 2));
+        size_t frameWidth  = static_cast<size_t>(std::max(program.get<int>("--width"), 2));
+
+        // level 0 spans the default view's 3.5 units across the frame
+        ProgressiveOptions options;
+        options.step = 3.5 / static_cast<double>(frameWidth);
+
+        ProgressiveRenderer renderer(options);
+        ProgressiveView view;
+        Tensor<float, 2> intensity({frameHeight, frameWidth});
+
+        auto report = [&](const char* name)
+        {
+            auto stats = renderer.Render(view, intensity);
+            std::cout << name << ": first preview after " << stats.first_preview_seconds * 1e3 << " ms, full frame after " << stats.seconds * 1e3 << " ms, "
+                      << 100.0 * stats.HitRate() << "% tile hits, " << stats.pixels_reused << " pixels reused, " << stats.pixels_resumed << " resumed, "
+                      << stats.pixels_computed << " computed\n";
+        };
+
+        report("initial");
+        view.centerReal += static_cast<double>(frameWidth / 4) * options.step;
+        report("panned ");
+        view.maxIterations *= 2;
+        report("deeper ");
+
+        EncodePpm(outputPath, ColorizeMandelbrot(intensity, colormapChoice));
+
+        writeTrace();
+        return 0;
+    }
+
+    if (program.get<bool>("--poster"))
+    {
+        size_t posterHeight = static_cast<size_t>(std::max(program.get<int>("--height"), 2));
+        size_t posterWidth  = static_cast<size_t>(std::max(program.get<int>("--width"), 2));
+
+        size_t workers = static_cast<size_t>(std::max(program.get<int>("--workers"), 0));
+#if defined(MATRIX_DISTRIBUTED_RENDER)
+        if (workers > 0)
+        {
+            DistributedOptions options;
+            options.workers      = workers;
+            options.tile_timeout = program.get<double>("--tile-timeout");
+
+            auto render = RenderDistributed(outputPath + ".rgb", posterHeight, posterWidth, colormapChoice, {}, options);
+            auto& stats = render.stats;
+            std::cout << stats.tiles << " tiles on " << workers << " workers in " << stats.seconds << " s (" << stats.TilesPerSecond() << " tiles/s), "
+                      << stats.lost_workers << " workers lost, " << stats.reassigned << " tiles reassigned\n";
+
+            render.image.Flush();
+            render.image.Advise(Access::Sequential);
+            EncodePpm(outputPath, render.image);
+
+            writeTrace();
+            return 0;
+        }
+#else
+        Expect(workers == 0, "error: worker processes need a POSIX system");
+#endif
+
+        auto rgb = GenerateMandelbrotPoster(outputPath + ".rgb", posterHeight, posterWidth, colormapChoice);
+        rgb.Flush();
+
+        // PNG encoding needs the whole image in memory, the PPM is written straight from the mapping
+        rgb.Advise(Access::Sequential);
+        EncodePpm(outputPath, rgb);
+
+        writeTrace();
+        return 0;
+    }
+
+    bool adaptive = program.get<bool>("--adaptive");
+
     // Render parameters
-    const size_t width  = 3840 * 4; // 4K resolution
-    const size_t height = 2160 * 4;
+    const size_t scale  = adaptive ? 1 : 4;
+    const size_t width  = 3840 * scale; // 4K resolution
+    const size_t height = 2160 * scale;
+
+    if (adaptive)
+    {
+        AntialiasOptions options;
+        options.samples   = static_cast<size_t>(std::max(program.get<int>("--samples"), 1));
+        options.threshold = static_cast<float>(program.get<double>("--threshold"));
+        options.jitter    = !program.get<bool>("--grid");
+        auto rgb          = GenerateMandelbrotImageAdaptive(height, width, colormapChoice, options);
+
+        // the two encoders only read the image, run them side by side
+        auto png = DispatchThreadPool().Submit([&]()
+        {
+            EncodePng(outputPath + ".png", rgb);
+        });
+        EncodePpm(outputPath, rgb);
+        png.get();
+
+        writeTrace();
+        return 0;
+    }
+
+    // the 15360x8640 intensity field is stored as half precision, 265 MB instead of 530 MB
+    Tensor<Float16, 2> intensity({height, width});
+    Tensor<uint8_t, 3> rgb({height, width, 3});
 
-    // Generate the fractal
-    auto rgb = GenerateMandelbrotImage(height, width, colormapChoice);
+    TaskGraph graph;
+    auto tasks = AddMandelbrotTasks(graph, intensity, rgb, colormapChoice);
+
+    // each band of tile rows goes to the PPM as soon as it is coloured, while later bands still render
+    PpmWriter ppm(outputPath, height, width);
+    TileGrid const& grid = tasks.grid;
+    std::vector<TaskGraph::TaskId> band;
+    for (size_t row = 0; row < grid.Rows(); ++row)
+    {
+        // bands are written in order, so each also waits for the previous write
+        std::vector<TaskGraph::TaskId> dependencies = band;
+        for (size_t column = 0; column < grid.Columns(); ++column)
+        {
+            dependencies.push_back(tasks.colorize[grid.Index(row, column)]);
+        }
+
+        size_t y_start = row * grid.tile;
+        size_t y_stop  = std::min(y_start + grid.tile, height);
+
+        auto write = graph.Add("EncodePpm", [&ppm, &rgb, y_start, y_stop]()
+        {
+            ppm.WriteRows(rgb, y_start, y_stop);
+        }, dependencies);
+        band = {write};
+    }
+
+    // PNG compression needs the whole image, it overlaps with the last PPM bands
+    graph.Add("EncodePng", [&]()
+    {
+        EncodePng(outputPath + ".png", rgb);
+    }, tasks.colorize);
 
-    // Write out the PPM
-    EncodePpm(outputPath, rgb);
-    EncodePng(outputPath + ".png", rgb);
+    graph.Run();
 
+    writeTrace();
     return 0;
 }
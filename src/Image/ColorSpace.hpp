@@ -0,0 +1,717 @@
+#pragma once
+
+#include <Dispatcher.hpp>
+#include <Expect.hpp>
+#include <Number.hpp>
+#include <StaticTensor.hpp>
+#include <Tensor.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MATRIX_COLOR_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MATRIX_COLOR_NEON
+#endif
+
+// Colour-space conversion of interleaved images, {height, width, 3} RGB unless stated otherwise.
+// 8-bit conversions run in Q13 fixed point, 16 pixels per step where SIMD is available. Float
+// images hold channels in [0, 1], the 8-bit levels divided by 255.
+
+enum class ColorStandard
+{
+    Bt601, // standard definition
+    Bt709, // high definition
+};
+
+enum class ColorRange
+{
+    Limited, // video levels, Y in [16, 235] and chroma in [16, 240]
+    Full,    // every channel in [0, 255], as in JPEG
+};
+
+// Three outputs as affine functions of three inputs, row i is out_i = m(i, 0..2) . in + m(i, 3).
+using ColorMatrix = StaticTensor<double, Extents<3, 4>>;
+
+inline auto LumaWeights(ColorStandard standard) -> std::array<double, 3>
+{
+    return standard == ColorStandard::Bt601 ? std::array<double, 3>{0.299, 0.587, 0.114} : std::array<double, 3>{0.2126, 0.7152, 0.0722};
+}
+
+inline auto RgbToYCbCrMatrix(ColorStandard standard, ColorRange range) -> ColorMatrix
+{
+    auto [kr, kg, kb] = LumaWeights(standard);
+
+    bool limited  = range == ColorRange::Limited;
+    double luma   = limited ? 219.0 / 255.0 : 1.0;
+    double chroma = limited ? 224.0 / 255.0 : 1.0;
+    double cb     = chroma / (2.0 * (1.0 - kb));
+    double cr     = chroma / (2.0 * (1.0 - kr));
+
+    return ColorMatrix({
+        {luma * kr, luma * kg, luma * kb, limited ? 16.0 : 0.0},
+        {-cb * kr, -cb * kg, cb * (1.0 - kb), 128.0},
+        {cr * (1.0 - kr), -cr * kg, -cr * kb, 128.0},
+    });
+}
+
+inline auto YCbCrToRgbMatrix(ColorStandard standard, ColorRange range) -> ColorMatrix
+{
+    auto [kr, kg, kb] = LumaWeights(standard);
+
+    bool limited  = range == ColorRange::Limited;
+    double luma   = limited ? 255.0 / 219.0 : 1.0;
+    double chroma = limited ? 255.0 / 224.0 : 1.0;
+    double offset = limited ? 16.0 : 0.0;
+
+    double r_cr = chroma * 2.0 * (1.0 - kr);
+    double b_cb = chroma * 2.0 * (1.0 - kb);
+    double g_cb = chroma * 2.0 * kb * (1.0 - kb) / kg;
+    double g_cr = chroma * 2.0 * kr * (1.0 - kr) / kg;
+
+    return ColorMatrix({
+        {luma, 0.0, r_cr, -luma * offset - r_cr * 128.0},
+        {luma, -g_cb, -g_cr, -luma * offset + (g_cb + g_cr) * 128.0},
+        {luma, b_cb, 0.0, -luma * offset - b_cb * 128.0},
+    });
+}
+
+// ----- fixed-point kernels -----
+
+// Weights are Q13, which keeps every coefficient above within int16 and sums of four 8-bit pixels
+// times a weight within int32.
+inline constexpr int ColorShift = 13;
+
+// One output channel of a ColorMatrix, (a * x + b * y + c * z + bias) >> Shift. The bias includes
+// rounding, Shift is ColorShift plus 2 when the inputs are sums of 2x2 pixels.
+struct FixedColorRow
+{
+    int16_t a, b, c;
+    int32_t bias;
+};
+
+inline auto ToFixedRow(ColorMatrix const& matrix, size_t row, int shift = ColorShift) -> FixedColorRow
+{
+    auto weight = [&](size_t column)
+    {
+        return static_cast<int16_t>(std::lround(matrix(row, column) * (1 << ColorShift)));
+    };
+    return {weight(0), weight(1), weight(2), static_cast<int32_t>(std::lround(matrix(row, 3) * (1 << shift))) + (1 << (shift - 1))};
+}
+
+template <int Shift>
+constexpr auto ApplyFixedRow(FixedColorRow const& row, int32_t x, int32_t y, int32_t z) -> uint8_t
+{
+    return static_cast<uint8_t>(std::clamp((row.a * x + row.b * y + row.c * z + row.bias) >> Shift, 0, 255));
+}
+
+#if defined(MATRIX_COLOR_SSE2)
+
+// 16 interleaved 3-channel pixels to and from one register per channel, SSE2 has no byte shuffle so
+// the channels are separated by repeated interleaving.
+inline auto LoadDeinterleave3(uint8_t const* data, __m128i& a, __m128i& b, __m128i& c) -> void
+{
+    __m128i t00 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data));
+    __m128i t01 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + 16));
+    __m128i t02 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + 32));
+
+    __m128i t10 = _mm_unpacklo_epi8(t00, _mm_unpackhi_epi64(t01, t01));
+    __m128i t11 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(t00, t00), t02);
+    __m128i t12 = _mm_unpacklo_epi8(t01, _mm_unpackhi_epi64(t02, t02));
+
+    __m128i t20 = _mm_unpacklo_epi8(t10, _mm_unpackhi_epi64(t11, t11));
+    __m128i t21 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(t10, t10), t12);
+    __m128i t22 = _mm_unpacklo_epi8(t11, _mm_unpackhi_epi64(t12, t12));
+
+    __m128i t30 = _mm_unpacklo_epi8(t20, _mm_unpackhi_epi64(t21, t21));
+    __m128i t31 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(t20, t20), t22);
+    __m128i t32 = _mm_unpacklo_epi8(t21, _mm_unpackhi_epi64(t22, t22));
+
+    a = _mm_unpacklo_epi8(t30, _mm_unpackhi_epi64(t31, t31));
+    b = _mm_unpacklo_epi8(_mm_unpackhi_epi64(t30, t30), t32);
+    c = _mm_unpacklo_epi8(t31, _mm_unpackhi_epi64(t32, t32));
+}
+
+inline auto StoreInterleave3(uint8_t* data, __m128i a, __m128i b, __m128i c) -> void
+{
+    // pixels as 32-bit abc0 words, then the padding bytes squeezed out
+    __m128i zero = _mm_setzero_si128();
+    __m128i ab0  = _mm_unpacklo_epi8(a, b);
+    __m128i ab1  = _mm_unpackhi_epi8(a, b);
+    __m128i c0   = _mm_unpacklo_epi8(c, zero);
+    __m128i c1   = _mm_unpackhi_epi8(c, zero);
+
+    __m128i p00 = _mm_unpacklo_epi16(ab0, c0);
+    __m128i p01 = _mm_unpackhi_epi16(ab0, c0);
+    __m128i p02 = _mm_unpacklo_epi16(ab1, c1);
+    __m128i p03 = _mm_unpackhi_epi16(ab1, c1);
+
+    __m128i p10 = _mm_unpacklo_epi32(p00, p01);
+    __m128i p11 = _mm_unpackhi_epi32(p00, p01);
+    __m128i p12 = _mm_unpacklo_epi32(p02, p03);
+    __m128i p13 = _mm_unpackhi_epi32(p02, p03);
+
+    __m128i p20 = _mm_unpacklo_epi64(p10, p11);
+    __m128i p21 = _mm_unpackhi_epi64(p10, p11);
+    __m128i p22 = _mm_unpacklo_epi64(p12, p13);
+    __m128i p23 = _mm_unpackhi_epi64(p12, p13);
+
+    p20 = _mm_slli_si128(p20, 1);
+    p22 = _mm_slli_si128(p22, 1);
+
+    __m128i p30 = _mm_slli_epi64(_mm_unpacklo_epi32(p20, p21), 8);
+    __m128i p31 = _mm_srli_epi64(_mm_unpackhi_epi32(p20, p21), 8);
+    __m128i p32 = _mm_slli_epi64(_mm_unpacklo_epi32(p22, p23), 8);
+    __m128i p33 = _mm_srli_epi64(_mm_unpackhi_epi32(p22, p23), 8);
+
+    __m128i p40 = _mm_unpacklo_epi64(p30, p31);
+    __m128i p41 = _mm_unpackhi_epi64(p30, p31);
+    __m128i p42 = _mm_unpacklo_epi64(p32, p33);
+    __m128i p43 = _mm_unpackhi_epi64(p32, p33);
+
+    __m128i v0 = _mm_or_si128(_mm_srli_si128(p40, 2), _mm_slli_si128(p41, 10));
+    __m128i v1 = _mm_or_si128(_mm_srli_si128(p41, 6), _mm_slli_si128(p42, 6));
+    __m128i v2 = _mm_or_si128(_mm_srli_si128(p42, 10), _mm_slli_si128(p43, 2));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(data), v0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(data + 16), v1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(data + 32), v2);
+}
+
+// Eight int16 lanes of x, y, z through one row, as eight int16 results. pmaddwd does two
+// multiply-adds per lane, so x and y go in as pairs and z is paired with zero.
+template <int Shift>
+inline auto ApplyFixedRowWords(FixedColorRow const& row, __m128i x, __m128i y, __m128i z) -> __m128i
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i xy_w = _mm_set1_epi32(static_cast<int32_t>((static_cast<uint32_t>(static_cast<uint16_t>(row.b)) << 16) | static_cast<uint16_t>(row.a)));
+    __m128i z_w  = _mm_set1_epi32(static_cast<uint16_t>(row.c));
+    __m128i bias = _mm_set1_epi32(row.bias);
+
+    __m128i low  = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(x, y), xy_w), _mm_madd_epi16(_mm_unpacklo_epi16(z, zero), z_w));
+    __m128i high = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(x, y), xy_w), _mm_madd_epi16(_mm_unpackhi_epi16(z, zero), z_w));
+    return _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(low, bias), Shift), _mm_srai_epi32(_mm_add_epi32(high, bias), Shift));
+}
+
+template <int Shift>
+inline auto ApplyFixedRowBytes(FixedColorRow const& row, __m128i x, __m128i y, __m128i z) -> __m128i
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i low  = ApplyFixedRowWords<Shift>(row, _mm_unpacklo_epi8(x, zero), _mm_unpacklo_epi8(y, zero), _mm_unpacklo_epi8(z, zero));
+    __m128i high = ApplyFixedRowWords<Shift>(row, _mm_unpackhi_epi8(x, zero), _mm_unpackhi_epi8(y, zero), _mm_unpackhi_epi8(z, zero));
+    return _mm_packus_epi16(low, high);
+}
+
+// Sums of each 2x2 block of 16 columns over two rows, eight int16 lanes.
+inline auto SumBlocks(__m128i top, __m128i bottom) -> __m128i
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i ones = _mm_set1_epi16(1);
+    __m128i low  = _mm_madd_epi16(_mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero)), ones);
+    __m128i high = _mm_madd_epi16(_mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero)), ones);
+    return _mm_packs_epi32(low, high);
+}
+
+#elif defined(MATRIX_COLOR_NEON)
+
+template <int Shift>
+inline auto ApplyFixedRowWords(FixedColorRow const& row, int16x8_t x, int16x8_t y, int16x8_t z) -> int16x8_t
+{
+    int32x4_t bias = vdupq_n_s32(row.bias);
+    int32x4_t low  = vmlal_n_s16(vmlal_n_s16(vmlal_n_s16(bias, vget_low_s16(x), row.a), vget_low_s16(y), row.b), vget_low_s16(z), row.c);
+    int32x4_t high = vmlal_n_s16(vmlal_n_s16(vmlal_n_s16(bias, vget_high_s16(x), row.a), vget_high_s16(y), row.b), vget_high_s16(z), row.c);
+    return vcombine_s16(vshrn_n_s32(low, Shift), vshrn_n_s32(high, Shift));
+}
+
+template <int Shift>
+inline auto ApplyFixedRowBytes(FixedColorRow const& row, uint8x16_t x, uint8x16_t y, uint8x16_t z) -> uint8x16_t
+{
+    auto widen_low = [](uint8x16_t v)
+    {
+        return vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(v)));
+    };
+    auto widen_high = [](uint8x16_t v)
+    {
+        return vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(v)));
+    };
+    int16x8_t low  = ApplyFixedRowWords<Shift>(row, widen_low(x), widen_low(y), widen_low(z));
+    int16x8_t high = ApplyFixedRowWords<Shift>(row, widen_high(x), widen_high(y), widen_high(z));
+    return vcombine_u8(vqmovun_s16(low), vqmovun_s16(high));
+}
+
+inline auto SumBlocks(uint8x16_t top, uint8x16_t bottom) -> int16x8_t
+{
+    return vreinterpretq_s16_u16(vpadalq_u8(vpaddlq_u8(top), bottom));
+}
+
+#endif
+
+// Interleaved 3-channel pixels through all three rows, e.g. RGB to YCbCr 4:4:4 and back.
+inline auto TransformPixels(uint8_t const* input, uint8_t* output, size_t pixels, std::array<FixedColorRow, 3> const& rows) -> void
+{
+    size_t p = 0;
+#if defined(MATRIX_COLOR_SSE2)
+    for (; p + 16 <= pixels; p += 16)
+    {
+        __m128i x, y, z;
+        LoadDeinterleave3(input + p * 3, x, y, z);
+        StoreInterleave3(output + p * 3, ApplyFixedRowBytes<ColorShift>(rows[0], x, y, z), ApplyFixedRowBytes<ColorShift>(rows[1], x, y, z), ApplyFixedRowBytes<ColorShift>(rows[2], x, y, z));
+    }
+#elif defined(MATRIX_COLOR_NEON)
+    for (; p + 16 <= pixels; p += 16)
+    {
+        uint8x16x3_t in = vld3q_u8(input + p * 3);
+        uint8x16x3_t out;
+        out.val[0] = ApplyFixedRowBytes<ColorShift>(rows[0], in.val[0], in.val[1], in.val[2]);
+        out.val[1] = ApplyFixedRowBytes<ColorShift>(rows[1], in.val[0], in.val[1], in.val[2]);
+        out.val[2] = ApplyFixedRowBytes<ColorShift>(rows[2], in.val[0], in.val[1], in.val[2]);
+        vst3q_u8(output + p * 3, out);
+    }
+#endif
+    for (; p < pixels; ++p)
+    {
+        uint8_t const* in = input + p * 3;
+        for (size_t c = 0; c < 3; ++c)
+        {
+            output[p * 3 + c] = ApplyFixedRow<ColorShift>(rows[c], in[0], in[1], in[2]);
+        }
+    }
+}
+
+// Float pixels through the matrix, its offsets brought from 8-bit levels to [0, 1]. Unclamped, so
+// out-of-gamut colours survive a round trip; the loop is left to the compiler to vectorize.
+inline auto TransformPixels(float const* input, float* output, size_t pixels, ColorMatrix const& matrix) -> void
+{
+    std::array<float, 12> m;
+    for (size_t row = 0; row < 3; ++row)
+    {
+        for (size_t column = 0; column < 4; ++column)
+        {
+            m[row * 4 + column] = static_cast<float>(column == 3 ? matrix(row, column) / 255.0 : matrix(row, column));
+        }
+    }
+
+    for (size_t p = 0; p < pixels; ++p)
+    {
+        float x = input[p * 3], y = input[p * 3 + 1], z = input[p * 3 + 2];
+
+        output[p * 3]     = m[0] * x + m[1] * y + m[2] * z + m[3];
+        output[p * 3 + 1] = m[4] * x + m[5] * y + m[6] * z + m[7];
+        output[p * 3 + 2] = m[8] * x + m[9] * y + m[10] * z + m[11];
+    }
+}
+
+// Interleaved 3-channel pixels through one row into a plane, e.g. RGB to luma.
+inline auto TransformToPlane(uint8_t const* input, uint8_t* output, size_t pixels, FixedColorRow const& row) -> void
+{
+    size_t p = 0;
+#if defined(MATRIX_COLOR_SSE2)
+    for (; p + 16 <= pixels; p += 16)
+    {
+        __m128i x, y, z;
+        LoadDeinterleave3(input + p * 3, x, y, z);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + p), ApplyFixedRowBytes<ColorShift>(row, x, y, z));
+    }
+#elif defined(MATRIX_COLOR_NEON)
+    for (; p + 16 <= pixels; p += 16)
+    {
+        uint8x16x3_t in = vld3q_u8(input + p * 3);
+        vst1q_u8(output + p, ApplyFixedRowBytes<ColorShift>(row, in.val[0], in.val[1], in.val[2]));
+    }
+#endif
+    for (; p < pixels; ++p)
+    {
+        uint8_t const* in = input + p * 3;
+        output[p]         = ApplyFixedRow<ColorShift>(row, in[0], in[1], in[2]);
+    }
+}
+
+// Chroma of each 2x2 block of two RGB rows, the rows carry pre-scaled biases for sums of four
+// pixels. An odd last column is paired with itself.
+inline auto SubsampleChroma(uint8_t const* top, uint8_t const* bottom, uint8_t* cb, uint8_t* cr, size_t width, FixedColorRow const& cb_row, FixedColorRow const& cr_row) -> void
+{
+    constexpr int Shift = ColorShift + 2;
+
+    size_t x = 0;
+#if defined(MATRIX_COLOR_SSE2)
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i r0, g0, b0, r1, g1, b1;
+        LoadDeinterleave3(top + x * 3, r0, g0, b0);
+        LoadDeinterleave3(bottom + x * 3, r1, g1, b1);
+
+        __m128i r = SumBlocks(r0, r1), g = SumBlocks(g0, g1), b = SumBlocks(b0, b1);
+        __m128i u = ApplyFixedRowWords<Shift>(cb_row, r, g, b);
+        __m128i v = ApplyFixedRowWords<Shift>(cr_row, r, g, b);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(cb + x / 2), _mm_packus_epi16(u, u));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(cr + x / 2), _mm_packus_epi16(v, v));
+    }
+#elif defined(MATRIX_COLOR_NEON)
+    for (; x + 16 <= width; x += 16)
+    {
+        uint8x16x3_t upper = vld3q_u8(top + x * 3);
+        uint8x16x3_t lower = vld3q_u8(bottom + x * 3);
+
+        int16x8_t r = SumBlocks(upper.val[0], lower.val[0]), g = SumBlocks(upper.val[1], lower.val[1]), b = SumBlocks(upper.val[2], lower.val[2]);
+        vst1_u8(cb + x / 2, vqmovun_s16(ApplyFixedRowWords<Shift>(cb_row, r, g, b)));
+        vst1_u8(cr + x / 2, vqmovun_s16(ApplyFixedRowWords<Shift>(cr_row, r, g, b)));
+    }
+#endif
+    for (; x < width; x += 2)
+    {
+        size_t next = std::min(x + 1, width - 1);
+        int32_t sums[3];
+        for (size_t c = 0; c < 3; ++c)
+        {
+            sums[c] = top[x * 3 + c] + top[next * 3 + c] + bottom[x * 3 + c] + bottom[next * 3 + c];
+        }
+        cb[x / 2] = ApplyFixedRow<Shift>(cb_row, sums[0], sums[1], sums[2]);
+        cr[x / 2] = ApplyFixedRow<Shift>(cr_row, sums[0], sums[1], sums[2]);
+    }
+}
+
+// One row of luma with half-width chroma to interleaved RGB, each chroma sample covering two pixels.
+inline auto UpsampleToRgb(uint8_t const* luma, uint8_t const* cb, uint8_t const* cr, uint8_t* rgb, size_t width, std::array<FixedColorRow, 3> const& rows) -> void
+{
+    size_t x = 0;
+#if defined(MATRIX_COLOR_SSE2)
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i y = _mm_loadu_si128(reinterpret_cast<__m128i const*>(luma + x));
+        __m128i u = _mm_loadl_epi64(reinterpret_cast<__m128i const*>(cb + x / 2));
+        __m128i v = _mm_loadl_epi64(reinterpret_cast<__m128i const*>(cr + x / 2));
+        u         = _mm_unpacklo_epi8(u, u);
+        v         = _mm_unpacklo_epi8(v, v);
+        StoreInterleave3(rgb + x * 3, ApplyFixedRowBytes<ColorShift>(rows[0], y, u, v), ApplyFixedRowBytes<ColorShift>(rows[1], y, u, v), ApplyFixedRowBytes<ColorShift>(rows[2], y, u, v));
+    }
+#elif defined(MATRIX_COLOR_NEON)
+    for (; x + 16 <= width; x += 16)
+    {
+        uint8x16_t y   = vld1q_u8(luma + x);
+        uint8x8x2_t du = vzip_u8(vld1_u8(cb + x / 2), vld1_u8(cb + x / 2));
+        uint8x8x2_t dv = vzip_u8(vld1_u8(cr + x / 2), vld1_u8(cr + x / 2));
+        uint8x16_t u   = vcombine_u8(du.val[0], du.val[1]);
+        uint8x16_t v   = vcombine_u8(dv.val[0], dv.val[1]);
+        uint8x16x3_t out;
+        out.val[0] = ApplyFixedRowBytes<ColorShift>(rows[0], y, u, v);
+        out.val[1] = ApplyFixedRowBytes<ColorShift>(rows[1], y, u, v);
+        out.val[2] = ApplyFixedRowBytes<ColorShift>(rows[2], y, u, v);
+        vst3q_u8(rgb + x * 3, out);
+    }
+#endif
+    for (; x < width; ++x)
+    {
+        for (size_t c = 0; c < 3; ++c)
+        {
+            rgb[x * 3 + c] = ApplyFixedRow<ColorShift>(rows[c], luma[x], cb[x / 2], cr[x / 2]);
+        }
+    }
+}
+
+inline auto ToFixedRows(ColorMatrix const& matrix) -> std::array<FixedColorRow, 3>
+{
+    return {ToFixedRow(matrix, 0), ToFixedRow(matrix, 1), ToFixedRow(matrix, 2)};
+}
+
+// ----- grayscale -----
+
+template <typename T>
+concept ColorElement = std::same_as<T, uint8_t> || std::same_as<T, float>;
+
+// Luma of each pixel with the standard's weights, on the full range of T.
+template <ColorElement T>
+auto RgbToGray(Tensor<T, 3> const& rgb, ColorStandard standard = ColorStandard::Bt709) -> Tensor<T, 2>
+{
+    auto [height, width, channels] = rgb.Shape();
+    Expect(channels == 3, "error: RGB image must have 3 channels");
+
+    Tensor<T, 2> gray({height, width});
+    T const* input = rgb.Data();
+    T* output      = gray.Data();
+    auto weights   = LumaWeights(standard);
+
+    ColorMatrix matrix({
+        {weights[0], weights[1], weights[2], 0.0},
+        {0.0, 0.0, 0.0, 0.0},
+        {0.0, 0.0, 0.0, 0.0},
+    });
+    FixedColorRow row = ToFixedRow(matrix, 0);
+
+    DispatchRange(height, 16, [&](size_t start, size_t stop)
+    {
+        if constexpr (std::same_as<T, uint8_t>)
+        {
+            TransformToPlane(input + start * width * 3, output + start * width, (stop - start) * width, row);
+        }
+        else
+        {
+            auto [kr, kg, kb] = weights;
+            for (size_t p = start * width; p < stop * width; ++p)
+            {
+                output[p] = static_cast<float>(kr * input[p * 3] + kg * input[p * 3 + 1] + kb * input[p * 3 + 2]);
+            }
+        }
+    });
+    return gray;
+}
+
+template <Number T>
+auto GrayToRgb(Tensor<T, 2> const& gray) -> Tensor<T, 3>
+{
+    auto [height, width] = gray.Shape();
+    Tensor<T, 3> rgb({height, width, 3});
+    T const* input = gray.Data();
+    T* output      = rgb.Data();
+
+    DispatchRange(height * width, 1 << 16, [&](size_t start, size_t stop)
+    {
+        for (size_t p = start; p < stop; ++p)
+        {
+            output[p * 3] = output[p * 3 + 1] = output[p * 3 + 2] = input[p];
+        }
+    });
+    return rgb;
+}
+
+// ----- YCbCr -----
+
+// Every pixel of a 3-channel image through matrix, in fixed point for 8-bit images.
+template <ColorElement T>
+auto TransformImage(Tensor<T, 3> const& input, ColorMatrix const& matrix) -> Tensor<T, 3>
+{
+    Tensor<T, 3> output(input.Shape());
+    size_t width = input.Shape()[1];
+
+    if constexpr (std::same_as<T, uint8_t>)
+    {
+        auto rows = ToFixedRows(matrix);
+        DispatchRange(input.Shape()[0], 16, [&](size_t start, size_t stop)
+        {
+            TransformPixels(input.Data() + start * width * 3, output.Data() + start * width * 3, (stop - start) * width, rows);
+        });
+    }
+    else
+    {
+        DispatchRange(input.Shape()[0], 16, [&](size_t start, size_t stop)
+        {
+            TransformPixels(input.Data() + start * width * 3, output.Data() + start * width * 3, (stop - start) * width, matrix);
+        });
+    }
+    return output;
+}
+
+// Interleaved YCbCr 4:4:4, channels in Y, Cb, Cr order.
+template <ColorElement T>
+auto RgbToYCbCr(Tensor<T, 3> const& rgb, ColorStandard standard = ColorStandard::Bt709, ColorRange range = ColorRange::Limited) -> Tensor<T, 3>
+{
+    Expect(rgb.Shape()[2] == 3, "error: RGB image must have 3 channels");
+    return TransformImage(rgb, RgbToYCbCrMatrix(standard, range));
+}
+
+template <ColorElement T>
+auto YCbCrToRgb(Tensor<T, 3> const& ycbcr, ColorStandard standard = ColorStandard::Bt709, ColorRange range = ColorRange::Limited) -> Tensor<T, 3>
+{
+    Expect(ycbcr.Shape()[2] == 3, "error: YCbCr image must have 3 channels");
+    return TransformImage(ycbcr, YCbCrToRgbMatrix(standard, range));
+}
+
+// Planar YCbCr 4:2:0, one chroma sample per 2x2 block sited at its centre. Odd extents round the
+// chroma planes up, so a last row or column shares its block with itself.
+struct YCbCr420
+{
+    Tensor<uint8_t, 2> y;
+    Tensor<uint8_t, 2> cb;
+    Tensor<uint8_t, 2> cr;
+
+    YCbCr420(size_t height, size_t width)
+        : y({height, width})
+        , cb({(height + 1) / 2, (width + 1) / 2})
+        , cr({(height + 1) / 2, (width + 1) / 2})
+    {}
+
+    auto Height() const -> size_t
+    {
+        return y.Shape()[0];
+    }
+
+    auto Width() const -> size_t
+    {
+        return y.Shape()[1];
+    }
+};
+
+// Luma of both rows of a block row and its subsampled chroma in one pass over the RGB rows.
+inline auto RgbToYCbCr420(Tensor<uint8_t, 3> const& rgb, YCbCr420& yuv, ColorStandard standard = ColorStandard::Bt709, ColorRange range = ColorRange::Limited) -> void
+{
+    auto [height, width, channels] = rgb.Shape();
+    Expect(channels == 3, "error: RGB image must have 3 channels");
+    Expect(yuv.Height() == height && yuv.Width() == width, "error: YCbCr 4:2:0 planes must match the image");
+
+    ColorMatrix matrix = RgbToYCbCrMatrix(standard, range);
+    FixedColorRow luma = ToFixedRow(matrix, 0);
+    FixedColorRow cb   = ToFixedRow(matrix, 1, ColorShift + 2);
+    FixedColorRow cr   = ToFixedRow(matrix, 2, ColorShift + 2);
+
+    size_t chroma_width = yuv.cb.Shape()[1];
+
+    DispatchRange(yuv.cb.Shape()[0], 8, [&](size_t start, size_t stop)
+    {
+        for (size_t block = start; block < stop; ++block)
+        {
+            size_t y0 = 2 * block;
+            size_t y1 = std::min(y0 + 1, height - 1);
+
+            uint8_t const* top    = rgb.Data() + y0 * width * 3;
+            uint8_t const* bottom = rgb.Data() + y1 * width * 3;
+
+            TransformToPlane(top, yuv.y.Data() + y0 * width, width, luma);
+            if (y1 != y0)
+            {
+                TransformToPlane(bottom, yuv.y.Data() + y1 * width, width, luma);
+            }
+            SubsampleChroma(top, bottom, yuv.cb.Data() + block * chroma_width, yuv.cr.Data() + block * chroma_width, width, cb, cr);
+        }
+    });
+}
+
+inline auto RgbToYCbCr420(Tensor<uint8_t, 3> const& rgb, ColorStandard standard = ColorStandard::Bt709, ColorRange range = ColorRange::Limited) -> YCbCr420
+{
+    YCbCr420 yuv(rgb.Shape()[0], rgb.Shape()[1]);
+    RgbToYCbCr420(rgb, yuv, standard, range);
+    return yuv;
+}
+
+// Chroma is upsampled by replication while each row is converted.
+inline auto YCbCr420ToRgb(YCbCr420 const& yuv, Tensor<uint8_t, 3>& rgb, ColorStandard standard = ColorStandard::Bt709, ColorRange range = ColorRange::Limited) -> void
+{
+    size_t height = yuv.Height();
+    size_t width  = yuv.Width();
+    Expect(rgb.Shape() == std::array<size_t, 3>{height, width, 3}, "error: RGB image must match the YCbCr 4:2:0 planes");
+
+    auto rows           = ToFixedRows(YCbCrToRgbMatrix(standard, range));
+    size_t chroma_width = yuv.cb.Shape()[1];
+
+    DispatchRange(height, 16, [&](size_t start, size_t stop)
+    {
+        for (size_t y = start; y < stop; ++y)
+        {
+            size_t offset = (y / 2) * chroma_width;
+            UpsampleToRgb(yuv.y.Data() + y * width, yuv.cb.Data() + offset, yuv.cr.Data() + offset, rgb.Data() + y * width * 3, width, rows);
+        }
+    });
+}
+
+inline auto YCbCr420ToRgb(YCbCr420 const& yuv, ColorStandard standard = ColorStandard::Bt709, ColorRange range = ColorRange::Limited) -> Tensor<uint8_t, 3>
+{
+    Tensor<uint8_t, 3> rgb({yuv.Height(), yuv.Width(), 3});
+    YCbCr420ToRgb(yuv, rgb, standard, range);
+    return rgb;
+}
+
+// ----- planar layout -----
+
+// {height, width, channels} to {channels, height, width}.
+template <Number T>
+auto ToPlanar(Tensor<T, 3> const& interleaved) -> Tensor<T, 3>
+{
+    auto [height, width, channels] = interleaved.Shape();
+    Tensor<T, 3> planar({channels, height, width});
+    size_t plane = height * width;
+
+    DispatchRange(plane, 1 << 14, [&](size_t start, size_t stop)
+    {
+        for (size_t c = 0; c < channels; ++c)
+        {
+            for (size_t p = start; p < stop; ++p)
+            {
+                planar.Data()[c * plane + p] = interleaved.Data()[p * channels + c];
+            }
+        }
+    });
+    return planar;
+}
+
+// {channels, height, width} to {height, width, channels}.
+template <Number T>
+auto ToInterleaved(Tensor<T, 3> const& planar) -> Tensor<T, 3>
+{
+    auto [channels, height, width] = planar.Shape();
+    Tensor<T, 3> interleaved({height, width, channels});
+    size_t plane = height * width;
+
+    DispatchRange(plane, 1 << 14, [&](size_t start, size_t stop)
+    {
+        for (size_t c = 0; c < channels; ++c)
+        {
+            for (size_t p = start; p < stop; ++p)
+            {
+                interleaved.Data()[p * channels + c] = planar.Data()[c * plane + p];
+            }
+        }
+    });
+    return interleaved;
+}
+
+// ----- HSV -----
+
+// Hue in degrees [0, 360), saturation and value in [0, 1], from RGB in [0, 1].
+inline auto RgbToHsv(Tensor<float, 3> const& rgb) -> Tensor<float, 3>
+{
+    Expect(rgb.Shape()[2] == 3, "error: RGB image must have 3 channels");
+    Tensor<float, 3> hsv(rgb.Shape());
+
+    DispatchRange(rgb.Size() / 3, 1 << 14, [&](size_t start, size_t stop)
+    {
+        for (size_t p = start; p < stop; ++p)
+        {
+            float r = rgb.Data()[p * 3], g = rgb.Data()[p * 3 + 1], b = rgb.Data()[p * 3 + 2];
+
+            float value  = std::max({r, g, b});
+            float spread = value - std::min({r, g, b});
+            float hue    = 0.0f;
+            if (spread > 0.0f)
+            {
+                hue = value == r ? (g - b) / spread : value == g ? 2.0f + (b - r) / spread : 4.0f + (r - g) / spread;
+                hue = hue < 0.0f ? hue * 60.0f + 360.0f : hue * 60.0f;
+            }
+
+            hsv.Data()[p * 3]     = hue;
+            hsv.Data()[p * 3 + 1] = value > 0.0f ? spread / value : 0.0f;
+            hsv.Data()[p * 3 + 2] = value;
+        }
+    });
+    return hsv;
+}
+
+inline auto HsvToRgb(Tensor<float, 3> const& hsv) -> Tensor<float, 3>
+{
+    Expect(hsv.Shape()[2] == 3, "error: HSV image must have 3 channels");
+    Tensor<float, 3> rgb(hsv.Shape());
+
+    DispatchRange(hsv.Size() / 3, 1 << 14, [&](size_t start, size_t stop)
+    {
+        for (size_t p = start; p < stop; ++p)
+        {
+            float hue = hsv.Data()[p * 3], saturation = hsv.Data()[p * 3 + 1], value = hsv.Data()[p * 3 + 2];
+
+            // distance of each channel's sector from the hue, the standard piecewise-linear form
+            auto channel = [&](float n)
+            {
+                float k = std::fmod(n + hue / 60.0f, 6.0f);
+                return value - value * saturation * std::clamp(std::min(k, 4.0f - k), 0.0f, 1.0f);
+            };
+
+            rgb.Data()[p * 3]     = channel(5.0f);
+            rgb.Data()[p * 3 + 1] = channel(3.0f);
+            rgb.Data()[p * 3 + 2] = channel(1.0f);
+        }
+    });
+    return rgb;
+}
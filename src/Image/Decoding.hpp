@@ -0,0 +1,87 @@
+#pragma once
+
+#include <Dispatcher.hpp>
+#include <Expect.hpp>
+#include <Tensor.hpp>
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+// Element types images decode into, 8 or 16 bits per channel.
+template <typename T>
+concept SampleElement = std::same_as<T, uint8_t> || std::same_as<T, uint16_t>;
+
+// Copies pixels of big-endian samples, one byte each for maxval < 256 and two bytes otherwise, as
+// PPM and 16-bit PNG store them, rescaled from [0, maxval] to the full range of T. Gray input is
+// replicated when the output has 3 channels. Plain copies and byte swaps take fast paths.
+template <SampleElement T>
+auto ConvertSamples(uint8_t const* in, size_t in_channels, uint32_t maxval, T* out, size_t out_channels, size_t pixels) -> void
+{
+    Expect(in_channels == out_channels || (in_channels == 1 && out_channels == 3), "error: cannot decode a colour image into one channel");
+    Expect(maxval > 0 && maxval <= 65535, "error: sample maximum must be in [1, 65535]");
+
+    constexpr uint32_t full = std::numeric_limits<T>::max();
+    bool wide               = maxval > 255;
+
+    // one-byte samples rescale through a table, two-byte ones take the division
+    std::array<T, 256> table{};
+    for (uint32_t v = 0; v < 256 && !wide; ++v)
+    {
+        table[v] = static_cast<T>((std::min(v, maxval) * full + maxval / 2) / maxval);
+    }
+
+    DispatchRange(pixels, 1 << 16, [&](size_t start, size_t stop)
+    {
+        size_t first = start * out_channels;
+        size_t count = (stop - start) * out_channels;
+
+        if (in_channels == out_channels && maxval == full && !wide)
+        {
+            std::memcpy(out + first, in + first, count);
+            return;
+        }
+        if (in_channels == out_channels && maxval == full)
+        {
+            for (size_t i = first; i < first + count; ++i)
+            {
+                out[i] = static_cast<T>(in[2 * i] << 8 | in[2 * i + 1]);
+            }
+            return;
+        }
+
+        for (size_t p = start; p < stop; ++p)
+        {
+            for (size_t c = 0; c < out_channels; ++c)
+            {
+                size_t i = p * in_channels + (in_channels == 1 ? 0 : c);
+                if (!wide)
+                {
+                    out[p * out_channels + c] = table[in[i]];
+                    continue;
+                }
+                uint32_t v = std::min<uint32_t>(in[2 * i] << 8 | in[2 * i + 1], maxval);
+
+                out[p * out_channels + c] = static_cast<T>((v * full + maxval / 2) / maxval);
+            }
+        }
+    });
+}
+
+// Whole file into bytes, resized to fit, so a buffer reused across files stops reallocating.
+inline auto ReadFileBytes(std::string const& filename, std::vector<uint8_t>& bytes) -> void
+{
+    std::ifstream infile(filename, std::ios::binary | std::ios::ate);
+    Expect(static_cast<bool>(infile), "error: unable to open " + filename + " for reading");
+
+    bytes.resize(static_cast<size_t>(infile.tellg()));
+    infile.seekg(0);
+    infile.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    Expect(static_cast<bool>(infile), "error: failed reading " + filename);
+}
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <Dispatcher.hpp>
+#include <Number.hpp>
+#include <Tensor.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// Neighbourhood filters whose cost per pixel does not depend on the radius. Images are 2D, or 3D with
+// interleaved channels last; every channel is filtered on its own.
+
+// Sums are kept in 64 bits, wide enough for a 16-bit image of 2^32 pixels.
+template <Number T>
+using Accumulator = std::conditional_t<Unsigned<T>, uint64_t, std::conditional_t<Signed<T>, int64_t, double>>;
+
+// A sum along one row of 8-bit elements fits 32 bits for any width below 2^23, which halves the
+// memory traffic of a separable filter's intermediate pass.
+template <Number T>
+using RowAccumulator = std::conditional_t<sizeof(T) == 1, std::conditional_t<Unsigned<T>, uint32_t, int32_t>, Accumulator<T>>;
+
+// Columns of interleaved elements handled by one task in a vertical pass. Each task walks its strip
+// down the whole image, so every row it touches is one contiguous run.
+inline constexpr size_t FilterStripWidth = 256;
+
+// Summed-area table with a zero first row and column, shape {height + 1, width + 1[, channels]}.
+// Element (y, x) holds the sum of the image over [0, y) x [0, x).
+template <Number T, size_t N>
+    requires(N == 2 || N == 3)
+auto IntegralImage(Tensor<T, N> const& image) -> Tensor<Accumulator<T>, N>
+{
+    using Sum = Accumulator<T>;
+
+    auto shape      = image.Shape();
+    size_t height   = shape[0];
+    size_t width    = shape[1];
+    size_t channels = N == 3 ? shape[2] : 1;
+
+    auto integral_shape = shape;
+    integral_shape[0]   = height + 1;
+    integral_shape[1]   = width + 1;
+    Tensor<Sum, N> integral(integral_shape);
+
+    T const* input = image.Data();
+    Sum* sums      = integral.Data();
+    size_t stride  = (width + 1) * channels;
+
+    std::fill_n(sums, stride, Sum(0));
+
+    // running sums along each row, in parallel by rows
+    DispatchRange(height, 16, [&](size_t start, size_t stop)
+    {
+        for (size_t y = start; y < stop; ++y)
+        {
+            T const* row = input + y * width * channels;
+            Sum* out     = sums + (y + 1) * stride;
+            std::fill_n(out, channels, Sum(0));
+            for (size_t i = 0; i < width * channels; ++i)
+            {
+                out[i + channels] = out[i] + static_cast<Sum>(row[i]);
+            }
+        }
+    });
+
+    // then down each column, in parallel by column strips
+    DispatchRange(stride, FilterStripWidth, [&](size_t start, size_t stop)
+    {
+        for (size_t y = 1; y <= height; ++y)
+        {
+            Sum const* above = sums + (y - 1) * stride;
+            Sum* row         = sums + y * stride;
+            for (size_t i = start; i < stop; ++i)
+            {
+                row[i] += above[i];
+            }
+        }
+    });
+
+    return integral;
+}
+
+// Sum of the image over [y_start, y_stop) x [x_start, x_stop) of one channel, four lookups.
+template <Number S, size_t N>
+    requires(N == 2 || N == 3)
+auto RegionSum(Tensor<S, N> const& integral, size_t y_start, size_t x_start, size_t y_stop, size_t x_stop, size_t channel = 0) -> S
+{
+    auto shape      = integral.Shape();
+    size_t channels = N == 3 ? shape[2] : 1;
+    size_t stride   = shape[1] * channels;
+    S const* sums   = integral.Data() + channel;
+
+    return sums[y_stop * stride + x_stop * channels] - sums[y_start * stride + x_stop * channels]
+         - sums[y_stop * stride + x_start * channels] + sums[y_start * stride + x_start * channels];
+}
+
+// Mean over the (2 * radius + 1)^2 window around each pixel. The window is cut off at the image border
+// and the mean taken over the pixels inside it. Two separable passes keep one running sum per column,
+// adding the element that enters the window and subtracting the one that leaves. Integer results
+// are rounded to nearest, halves up.
+template <Number T, size_t N>
+    requires(N == 2 || N == 3)
+auto BoxFilter(Tensor<T, N> const& image, size_t radius) -> Tensor<T, N>
+{
+    using Sum = Accumulator<T>;
+
+    auto shape      = image.Shape();
+    size_t height   = shape[0];
+    size_t width    = shape[1];
+    size_t channels = N == 3 ? shape[2] : 1;
+    size_t stride   = width * channels;
+
+    Tensor<T, N> result(shape);
+    if (image.Size() == 0)
+    {
+        return result;
+    }
+
+    using RowSum = RowAccumulator<T>;
+
+    // horizontal window sums, one row per step. Element i of a row is the element i - channels
+    // of the same channel plus the one entering the window minus the one leaving it, split into
+    // the ranges where either exists so the inner loops have no branches.
+    Tensor<RowSum, N> rows(shape);
+    T const* input   = image.Data();
+    RowSum* row_sums = rows.Data();
+
+    size_t reach    = std::min(radius, width - 1);
+    size_t entering = (reach + 1) * channels;   // offset of the element entering at x from x - 1
+    size_t leaving  = (radius + 1) * channels;  // offset of the element leaving at x
+    size_t no_leave = std::min(radius + 1, width) * channels;
+    size_t no_enter = (width - reach) * channels;
+
+    DispatchRange(height, 16, [&](size_t start, size_t stop)
+    {
+        for (size_t y = start; y < stop; ++y)
+        {
+            T const* in = input + y * stride;
+            RowSum* out = row_sums + y * stride;
+
+            std::fill_n(out, channels, RowSum(0));
+            for (size_t i = 0; i < entering; ++i)
+            {
+                out[i % channels] += static_cast<RowSum>(in[i]);
+            }
+
+            // the window is clipped on the left until x > radius and on the right from x >= width - reach
+            size_t i = channels;
+            for (; i < std::min(no_leave, no_enter); ++i)
+            {
+                out[i] = out[i - channels] + static_cast<RowSum>(in[i + entering - channels]);
+            }
+            for (; i < no_enter; ++i)
+            {
+                out[i] = out[i - channels] + static_cast<RowSum>(in[i + entering - channels]) - static_cast<RowSum>(in[i - leaving]);
+            }
+            for (; i < no_leave; ++i)
+            {
+                out[i] = out[i - channels];
+            }
+            for (; i < stride; ++i)
+            {
+                out[i] = out[i - channels] - static_cast<RowSum>(in[i - leaving]);
+            }
+        }
+    });
+
+    // vertical window sums over a strip of columns, divided by the clipped window area
+    T* output = result.Data();
+    DispatchRange(stride, FilterStripWidth, [&](size_t start, size_t stop)
+    {
+        auto clipped = [radius](size_t i, size_t extent)
+        {
+            return std::min(i + radius, extent - 1) - (i >= radius ? i - radius : 0) + 1;
+        };
+
+        std::vector<Sum> sums(stop - start, Sum(0));
+        std::vector<double> column_scale(stop - start);
+        for (size_t i = start; i < stop; ++i)
+        {
+            column_scale[i - start] = 1.0 / static_cast<double>(clipped(i / channels, width));
+        }
+
+        for (size_t y = 0; y <= std::min(radius, height - 1); ++y)
+        {
+            for (size_t i = start; i < stop; ++i)
+            {
+                sums[i - start] += row_sums[y * stride + i];
+            }
+        }
+
+        for (size_t y = 0; y < height; ++y)
+        {
+            double row_scale = 1.0 / static_cast<double>(clipped(y, height));
+            RowSum const* enter = y + radius + 1 < height ? row_sums + (y + radius + 1) * stride : nullptr;
+            RowSum const* leave = y >= radius ? row_sums + (y - radius) * stride : nullptr;
+
+            for (size_t i = start; i < stop; ++i)
+            {
+                Sum sum      = sums[i - start];
+                double scale = row_scale * column_scale[i - start];
+
+                if constexpr (Real<T>)
+                {
+                    output[y * stride + i] = static_cast<T>(sum * scale);
+                }
+                else
+                {
+                    // multiplying by the reciprocal instead of dividing; sum / count + 1/2 is a multiple
+                    // of 1 / (2 * count), the extra quarter step keeps rounding error off those edges
+                    output[y * stride + i] = static_cast<T>(std::floor(static_cast<double>(sum) * scale + (0.5 + 0.25 * scale)));
+                }
+
+                sums[i - start] += static_cast<Sum>(enter ? enter[i] : RowSum(0)) - static_cast<Sum>(leave ? leave[i] : RowSum(0));
+            }
+        }
+    });
+
+    return result;
+}
@@ -0,0 +1,409 @@
+#pragma once
+
+#include <Dispatcher.hpp>
+#include <Expect.hpp>
+#include <Number.hpp>
+#include <Tensor.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#if defined(__AVX512VBMI__) && defined(__AVX512BW__)
+#include <immintrin.h>
+#define MATRIX_LUT_AVX512VBMI
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define MATRIX_LUT_NEON
+#endif
+
+// Per-channel histograms of images, returned as {channels, bins} counts. The channels of a 3D tensor
+// are its last dimension, a 2D tensor is a single channel.
+
+// Pixels counted into one private uint32_t histogram before it is folded into 64-bit totals.
+inline constexpr size_t HistogramBlockSize = size_t(1) << 20;
+
+// Runs of equal values increment the same counter back to back, which serialises on the store.
+// Rotating consecutive pixels through a few copies of the histogram breaks that chain.
+inline constexpr size_t HistogramCopies = 4;
+
+template <Number T, size_t N>
+    requires(N == 2 || N == 3)
+auto ImageChannels(Tensor<T, N> const& image) -> size_t
+{
+    return N == 3 ? image.Shape()[N - 1] : 1;
+}
+
+// Each task counts its pixels into a private histogram and merges it once at the end, so workers
+// never share a counter. count(start, stop, counts) adds pixels [start, stop) to HistogramCopies
+// consecutive {channels, bins} histograms.
+template <typename Count>
+auto MergedHistogram(size_t pixels, size_t channels, size_t bins, Count&& count) -> Tensor<uint64_t, 2>
+{
+    Tensor<uint64_t, 2> histogram({channels, bins}, 0);
+    std::mutex merge;
+
+    size_t table = channels * bins;
+
+    DispatchRange(pixels, HistogramBlockSize, [&](size_t start, size_t stop)
+    {
+        std::vector<uint32_t> counts(HistogramCopies * table);
+        std::vector<uint64_t> totals(table, 0);
+
+        // a nested dispatch runs the whole range inline, keep each pass small enough for uint32_t
+        for (size_t block = start; block < stop; block += HistogramBlockSize)
+        {
+            std::fill(counts.begin(), counts.end(), 0);
+            count(block, std::min(block + HistogramBlockSize, stop), counts.data());
+
+            for (size_t copy = 0; copy < HistogramCopies; ++copy)
+            {
+                for (size_t i = 0; i < table; ++i)
+                {
+                    totals[i] += counts[copy * table + i];
+                }
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(merge);
+        for (size_t i = 0; i < table; ++i)
+        {
+            histogram.Data()[i] += totals[i];
+        }
+    });
+
+    return histogram;
+}
+
+// 256 bins, one per level.
+template <size_t N>
+    requires(N == 2 || N == 3)
+auto Histogram(Tensor<uint8_t, N> const& image) -> Tensor<uint64_t, 2>
+{
+    size_t channels = ImageChannels(image);
+    uint8_t const* data = image.Data();
+
+    return MergedHistogram(image.Size() / channels, channels, 256, [=](size_t start, size_t stop, uint32_t* counts)
+    {
+        size_t table = channels * 256;
+        size_t p     = start;
+        for (; p + HistogramCopies <= stop; p += HistogramCopies)
+        {
+            uint8_t const* pixel = data + p * channels;
+            for (size_t c = 0; c < channels; ++c)
+            {
+                ++counts[0 * table + c * 256 + pixel[c]];
+                ++counts[1 * table + c * 256 + pixel[channels + c]];
+                ++counts[2 * table + c * 256 + pixel[2 * channels + c]];
+                ++counts[3 * table + c * 256 + pixel[3 * channels + c]];
+            }
+        }
+        for (; p < stop; ++p)
+        {
+            for (size_t c = 0; c < channels; ++c)
+            {
+                ++counts[c * 256 + data[p * channels + c]];
+            }
+        }
+    });
+}
+
+// bins equal-width bins over [min, max]. Values outside the range land in the first or last bin,
+// NaNs are not counted.
+template <Real T, size_t N>
+    requires(N == 2 || N == 3)
+auto Histogram(Tensor<T, N> const& image, size_t bins, double min, double max) -> Tensor<uint64_t, 2>
+{
+    Expect(bins > 0 && max > min, "error: histogram needs at least one bin over a non-empty range");
+
+    size_t channels = ImageChannels(image);
+    T const* data   = image.Data();
+    float low       = static_cast<float>(min);
+    float scale     = static_cast<float>(bins / (max - min));
+    size_t last     = bins - 1;
+    float top       = static_cast<float>(last);
+
+    return MergedHistogram(image.Size() / channels, channels, bins, [=](size_t start, size_t stop, uint32_t* counts)
+    {
+        size_t table = channels * bins;
+        for (size_t p = start; p < stop; ++p)
+        {
+            uint32_t* copy = counts + (p % HistogramCopies) * table;
+            for (size_t c = 0; c < channels; ++c)
+            {
+                float position = (static_cast<float>(data[p * channels + c]) - low) * scale;
+                if (std::isnan(position))
+                {
+                    continue;
+                }
+                // clamped as a float, converting infinities or positions past size_t is undefined
+                size_t bin = position <= 0.0f ? 0 : position >= top ? last : static_cast<size_t>(position);
+                ++copy[c * bins + bin];
+            }
+        }
+    });
+}
+
+// ----- lookup tables, {channels, 256} with one row per channel -----
+
+inline auto IdentityLut(uint8_t* lut) -> void
+{
+    for (size_t v = 0; v < 256; ++v)
+    {
+        lut[v] = static_cast<uint8_t>(v);
+    }
+}
+
+// Maps each channel's cumulative distribution onto [0, 255], which spreads the most common levels
+// apart. The lowest level present maps to 0 and the highest to 255.
+inline auto EqualizationLut(Tensor<uint64_t, 2> const& histogram) -> Tensor<uint8_t, 2>
+{
+    auto [channels, bins] = histogram.Shape();
+    Expect(bins == 256, "error: equalization needs a 256-bin histogram");
+
+    Tensor<uint8_t, 2> luts({channels, 256});
+    for (size_t c = 0; c < channels; ++c)
+    {
+        uint64_t const* counts = histogram.Data() + c * 256;
+        uint8_t* lut           = luts.Data() + c * 256;
+
+        uint64_t total = 0;
+        for (size_t v = 0; v < 256; ++v)
+        {
+            total += counts[v];
+        }
+
+        size_t lowest = 0;
+        while (lowest < 256 && counts[lowest] == 0)
+        {
+            ++lowest;
+        }
+
+        // an empty or single-level channel has nothing to spread
+        uint64_t first = lowest < 256 ? counts[lowest] : 0;
+        if (total == first)
+        {
+            IdentityLut(lut);
+            continue;
+        }
+
+        double scale = 255.0 / static_cast<double>(total - first);
+        uint64_t cdf = 0;
+        for (size_t v = 0; v < 256; ++v)
+        {
+            cdf += counts[v];
+            lut[v] = cdf <= first ? 0 : static_cast<uint8_t>(std::lround((cdf - first) * scale));
+        }
+    }
+    return luts;
+}
+
+// Stretches each channel linearly so the levels between the clip and 1 - clip quantiles cover
+// [0, 255], saturating the clipped tails.
+inline auto AutoLevelsLut(Tensor<uint64_t, 2> const& histogram, double clip = 0.005) -> Tensor<uint8_t, 2>
+{
+    auto [channels, bins] = histogram.Shape();
+    Expect(bins == 256, "error: auto-levels needs a 256-bin histogram");
+    Expect(clip >= 0.0 && clip < 0.5, "error: auto-levels clip must be in [0, 0.5)");
+
+    Tensor<uint8_t, 2> luts({channels, 256});
+    for (size_t c = 0; c < channels; ++c)
+    {
+        uint64_t const* counts = histogram.Data() + c * 256;
+        uint8_t* lut           = luts.Data() + c * 256;
+
+        uint64_t total = 0;
+        for (size_t v = 0; v < 256; ++v)
+        {
+            total += counts[v];
+        }
+
+        // first levels whose cumulative count passes each clip threshold
+        double low_count  = clip * total;
+        double high_count = (1.0 - clip) * total;
+        size_t low = 256, high = 256;
+        uint64_t cdf = 0;
+        for (size_t v = 0; v < 256; ++v)
+        {
+            cdf += counts[v];
+            if (low == 256 && cdf > low_count)
+            {
+                low = v;
+            }
+            if (high == 256 && cdf >= high_count)
+            {
+                high = v;
+            }
+        }
+
+        if (low >= high || high == 256)
+        {
+            IdentityLut(lut);
+            continue;
+        }
+
+        double scale = 255.0 / static_cast<double>(high - low);
+        for (size_t v = 0; v < 256; ++v)
+        {
+            double level = (static_cast<double>(v) - static_cast<double>(low)) * scale;
+            lut[v]       = static_cast<uint8_t>(std::lround(std::clamp(level, 0.0, 255.0)));
+        }
+    }
+    return luts;
+}
+
+// ----- LUT application, vector body plus scalar tail -----
+
+// Maps pixels [0, pixels) of interleaved channels through luts, channel c through luts[c * 256, + 256).
+// input and output may be the same buffer.
+inline auto LookupBytes(uint8_t const* input, uint8_t* output, size_t pixels, size_t channels, uint8_t const* luts) -> void
+{
+    size_t p = 0;
+#if defined(MATRIX_LUT_AVX512VBMI)
+    // a 256-entry table is four registers, vpermi2b looks up the low 128 entries and the high 128
+    // entries, the index's top bit picks between them. With several channels every table is looked
+    // up and blended by lane masks; 64 * channels bytes hold whole pixels, so channels vectors repeat.
+    if (channels <= 4)
+    {
+        __m512i tables[4][4];
+        __mmask64 lanes[4][4] = {};
+        for (size_t c = 0; c < channels; ++c)
+        {
+            for (size_t t = 0; t < 4; ++t)
+            {
+                tables[c][t] = _mm512_loadu_si512(luts + c * 256 + t * 64);
+            }
+        }
+        for (size_t k = 0; k < channels; ++k)
+        {
+            for (size_t lane = 0; lane < 64; ++lane)
+            {
+                lanes[k][(k * 64 + lane) % channels] |= __mmask64(1) << lane;
+            }
+        }
+
+        auto lookup = [](__m512i index, __m512i const* table)
+        {
+            __m512i low  = _mm512_permutex2var_epi8(table[0], index, table[1]);
+            __m512i high = _mm512_permutex2var_epi8(table[2], index, table[3]);
+            return _mm512_mask_blend_epi8(_mm512_movepi8_mask(index), low, high);
+        };
+
+        size_t bytes = pixels * channels;
+        size_t group = 64 * channels;
+        size_t i     = 0;
+        for (; i + group <= bytes; i += group)
+        {
+            for (size_t k = 0; k < channels; ++k)
+            {
+                __m512i index  = _mm512_loadu_si512(input + i + k * 64);
+                __m512i result = lookup(index, tables[0]);
+                for (size_t c = 1; c < channels; ++c)
+                {
+                    result = _mm512_mask_blend_epi8(lanes[k][c], result, lookup(index, tables[c]));
+                }
+                _mm512_storeu_si512(output + i + k * 64, result);
+            }
+        }
+        p = i / channels;
+    }
+#elif defined(MATRIX_LUT_NEON)
+    // tbl looks up 64 entries at a time and yields 0 out of range, so the four quarters of a table
+    // are looked up with shifted indices and or-ed. vld3 splits rgb into one register per channel.
+    auto load_table = [](uint8_t const* lut, uint8x16x4_t* quarters)
+    {
+        for (size_t t = 0; t < 4; ++t)
+        {
+            quarters[t] = vld1q_u8_x4(lut + t * 64);
+        }
+    };
+
+    auto lookup = [](uint8x16_t index, uint8x16x4_t const* quarters)
+    {
+        uint8x16_t step   = vdupq_n_u8(64);
+        uint8x16_t result = vqtbl4q_u8(quarters[0], index);
+        for (size_t t = 1; t < 4; ++t)
+        {
+            index  = vsubq_u8(index, step);
+            result = vorrq_u8(result, vqtbl4q_u8(quarters[t], index));
+        }
+        return result;
+    };
+
+    if (channels == 1)
+    {
+        uint8x16x4_t quarters[4];
+        load_table(luts, quarters);
+        for (; p + 16 <= pixels; p += 16)
+        {
+            vst1q_u8(output + p, lookup(vld1q_u8(input + p), quarters));
+        }
+    }
+    else if (channels == 3)
+    {
+        uint8x16x4_t quarters[3][4];
+        for (size_t c = 0; c < 3; ++c)
+        {
+            load_table(luts + c * 256, quarters[c]);
+        }
+        for (; p + 16 <= pixels; p += 16)
+        {
+            uint8x16x3_t rgb = vld3q_u8(input + p * 3);
+            rgb.val[0]       = lookup(rgb.val[0], quarters[0]);
+            rgb.val[1]       = lookup(rgb.val[1], quarters[1]);
+            rgb.val[2]       = lookup(rgb.val[2], quarters[2]);
+            vst3q_u8(output + p * 3, rgb);
+        }
+    }
+#endif
+    for (; p < pixels; ++p)
+    {
+        for (size_t c = 0; c < channels; ++c)
+        {
+            output[p * channels + c] = luts[c * 256 + input[p * channels + c]];
+        }
+    }
+}
+
+template <size_t N>
+    requires(N == 2 || N == 3)
+auto ApplyLut(Tensor<uint8_t, N> const& image, Tensor<uint8_t, 2> const& luts, Tensor<uint8_t, N>& result) -> void
+{
+    size_t channels = ImageChannels(image);
+    Expect(image.Shape() == result.Shape(), "error: LUT result must have the image's shape");
+    Expect(luts.Shape()[0] == channels && luts.Shape()[1] == 256, "error: LUT needs 256 entries per channel");
+
+    uint8_t const* input = image.Data();
+    uint8_t* output      = result.Data();
+
+    DispatchRange(image.Size() / channels, size_t(1) << 16, [&](size_t start, size_t stop)
+    {
+        LookupBytes(input + start * channels, output + start * channels, stop - start, channels, luts.Data());
+    });
+}
+
+template <size_t N>
+    requires(N == 2 || N == 3)
+auto ApplyLut(Tensor<uint8_t, N> const& image, Tensor<uint8_t, 2> const& luts) -> Tensor<uint8_t, N>
+{
+    Tensor<uint8_t, N> result(image.Shape());
+    ApplyLut(image, luts, result);
+    return result;
+}
+
+template <size_t N>
+    requires(N == 2 || N == 3)
+auto EqualizeHistogram(Tensor<uint8_t, N> const& image) -> Tensor<uint8_t, N>
+{
+    return ApplyLut(image, EqualizationLut(Histogram(image)));
+}
+
+template <size_t N>
+    requires(N == 2 || N == 3)
+auto AutoLevels(Tensor<uint8_t, N> const& image, double clip = 0.005) -> Tensor<uint8_t, N>
+{
+    return ApplyLut(image, AutoLevelsLut(Histogram(image), clip));
+}
@@ -0,0 +1,312 @@
+#pragma once
+
+#include <Decoding.hpp>
+#include <Dispatcher.hpp>
+#include <Expect.hpp>
+#include <PNG.hpp>
+#include <PPM.hpp>
+#include <Tensor.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct LoaderOptions
+{
+    size_t io_threads = 2; // threads reading files, decoding runs on the shared dispatch pool
+    size_t lookahead  = 8; // images read or decoded ahead of the callback, each holding one buffer
+    size_t channels   = 3; // 1 or 3 to convert every image, 0 keeps each file's own
+};
+
+struct LoaderStats
+{
+    size_t frames = 0;
+    size_t bytes  = 0; // file bytes read
+
+    double seconds        = 0.0; // wall time for the whole batch
+    double read_seconds   = 0.0; // summed over I/O threads
+    double decode_seconds = 0.0; // summed over decode tasks
+
+    auto FramesPerSecond() const
+    {
+        return seconds > 0.0 ? frames / seconds : 0.0;
+    }
+
+    auto MegabytesPerSecond() const
+    {
+        return seconds > 0.0 ? bytes / seconds / 1e6 : 0.0;
+    }
+};
+
+inline auto IsPng(std::span<uint8_t const> data) -> bool
+{
+    return data.size() >= 4 && std::memcmp(data.data(), "\x89PNG", 4) == 0;
+}
+
+// {height, width, channels} of a PNG or binary PGM/PPM file, told apart by their magic bytes.
+inline auto ImageShape(std::span<uint8_t const> data) -> std::array<size_t, 3>
+{
+    if (IsPng(data))
+    {
+        return PngShape(data);
+    }
+    PpmHeader header = ReadPpmHeader(data);
+    return {header.height, header.width, header.channels};
+}
+
+template <SampleElement T>
+auto DecodeImage(std::span<uint8_t const> data, Tensor<T, 3>& image) -> void
+{
+    if (IsPng(data))
+    {
+        DecodePng(data, image);
+    }
+    else
+    {
+        DecodePpm(data, image);
+    }
+}
+
+// Loads every path and calls callback(index, image) for each in order on the calling thread. I/O
+// threads read files while earlier ones decode on the dispatch pool, at most options.lookahead
+// images ahead of the callback. Their file and image buffers are reused for later paths once the
+// callback returns, so the image must be copied to outlive the call. The first error from a read,
+// a decode or the callback stops the batch and is rethrown after every thread has finished.
+template <SampleElement T, typename Callback>
+auto LoadImages(std::vector<std::string> const& paths, LoaderOptions const& options, Callback&& callback) -> LoaderStats
+{
+    using Clock = std::chrono::steady_clock;
+
+    Expect(options.channels == 0 || options.channels == 1 || options.channels == 3, "error: images load with 0, 1 or 3 channels");
+
+    struct Slot
+    {
+        std::vector<uint8_t> bytes;
+        Tensor<T, 3> image = Tensor<T, 3>({0, 0, 0});
+        size_t index       = 0;
+    };
+
+    auto seconds_since = [](Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    };
+
+    size_t io_threads = std::clamp<size_t>(options.io_threads, 1, std::max<size_t>(paths.size(), 1));
+    std::vector<Slot> slots(std::max<size_t>(options.lookahead, 1));
+    std::vector<Slot*> free_slots;
+    for (auto& slot : slots)
+    {
+        free_slots.push_back(&slot);
+    }
+
+    std::mutex mutex;
+    std::condition_variable slot_freed;
+    std::condition_variable image_ready;
+    std::map<size_t, Slot*> ready;
+    size_t next_read = 0; // next path handed to an I/O thread
+    size_t decoding  = 0; // decode tasks queued or running
+    std::exception_ptr error;
+    LoaderStats stats;
+
+    auto fail = [&](std::exception_ptr exception)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!error)
+            {
+                error = exception;
+            }
+            next_read = paths.size();
+        }
+        slot_freed.notify_all();
+        image_ready.notify_all();
+    };
+
+    auto decode = [&](Slot* slot)
+    {
+        auto decode_start = Clock::now();
+        try
+        {
+            auto shape = ImageShape(slot->bytes);
+            if (options.channels != 0)
+            {
+                shape[2] = options.channels;
+            }
+            if (slot->image.Shape() != shape)
+            {
+                slot->image = Tensor<T, 3>(shape);
+            }
+            DecodeImage(std::span<uint8_t const>(slot->bytes), slot->image);
+        }
+        catch (...)
+        {
+            fail(std::current_exception());
+        }
+        double decode_time = seconds_since(decode_start);
+
+        // notified under the lock, the loader may return as soon as the last task is done
+        std::unique_lock<std::mutex> lock(mutex);
+        stats.decode_seconds += decode_time;
+        ready.emplace(slot->index, slot);
+        --decoding;
+        image_ready.notify_all();
+    };
+
+    // a caller that is itself a dispatch worker may be the pool's only thread, so it decodes on the I/O threads
+    bool decode_on_pool = !DispatchThreadPool().IsOwnWorker();
+
+    // the decoders still dispatch their conversions from the I/O threads, so a worker caller runs queued
+    // tasks while it waits instead of blocking the thread those conversions need
+    auto wait = [&](std::unique_lock<std::mutex>& lock, auto const& done)
+    {
+        if (decode_on_pool)
+        {
+            image_ready.wait(lock, done);
+            return;
+        }
+        while (!done())
+        {
+            lock.unlock();
+            bool ran = DispatchThreadPool().TryRunTask();
+            lock.lock();
+            if (!ran && !done())
+            {
+                image_ready.wait_for(lock, std::chrono::milliseconds(1));
+            }
+        }
+    };
+
+    auto read = [&]()
+    {
+        while (true)
+        {
+            Slot* slot = nullptr;
+            {
+                // slots are taken in path order, so the image the callback waits for always holds one
+                std::unique_lock<std::mutex> lock(mutex);
+                slot_freed.wait(lock, [&]
+                {
+                    return !free_slots.empty() || next_read >= paths.size();
+                });
+                if (next_read >= paths.size())
+                {
+                    break;
+                }
+
+                slot = free_slots.back();
+                free_slots.pop_back();
+                slot->index = next_read++;
+                ++decoding;
+            }
+
+            auto read_start = Clock::now();
+            try
+            {
+                ReadFileBytes(paths[slot->index], slot->bytes);
+            }
+            catch (...)
+            {
+                fail(std::current_exception());
+                std::unique_lock<std::mutex> lock(mutex);
+                --decoding;
+                break;
+            }
+            double read_time = seconds_since(read_start);
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                stats.read_seconds += read_time;
+                stats.bytes += slot->bytes.size();
+            }
+
+            if (decode_on_pool)
+            {
+                DispatchThreadPool().Enqueue([&decode, slot]()
+                {
+                    decode(slot);
+                });
+            }
+            else
+            {
+                decode(slot);
+            }
+        }
+        image_ready.notify_all();
+    };
+
+    auto start = Clock::now();
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < io_threads; ++i)
+    {
+        threads.emplace_back(read);
+    }
+
+    for (size_t index = 0; index < paths.size(); ++index)
+    {
+        Slot* slot = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wait(lock, [&]
+            {
+                return error || (!ready.empty() && ready.begin()->first == index);
+            });
+            if (error)
+            {
+                break;
+            }
+
+            slot = ready.begin()->second;
+            ready.erase(ready.begin());
+        }
+
+        try
+        {
+            callback(index, static_cast<Tensor<T, 3> const&>(slot->image));
+        }
+        catch (...)
+        {
+            fail(std::current_exception());
+            break;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ++stats.frames;
+            free_slots.push_back(slot);
+        }
+        slot_freed.notify_all();
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    // decode tasks still queued after a failure reference this frame
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        wait(lock, [&]
+        {
+            return decoding == 0;
+        });
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+
+    stats.seconds = seconds_since(start);
+    return stats;
+}
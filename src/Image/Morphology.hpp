@@ -0,0 +1,181 @@
+#pragma once
+
+#include <Dispatcher.hpp>
+#include <Filter.hpp>
+#include <Number.hpp>
+#include <Tensor.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+// Grey-level morphology with a (2 * radius + 1)^2 square structuring element. Pixels outside the
+// image are ignored, so the window is cut off at the border like BoxFilter's.
+
+template <Number T>
+constexpr auto LowestValue() -> T
+{
+    if constexpr (Real<T>)
+    {
+        return static_cast<T>(-std::numeric_limits<float>::infinity());
+    }
+    else
+    {
+        return std::numeric_limits<T>::lowest();
+    }
+}
+
+template <Number T>
+constexpr auto HighestValue() -> T
+{
+    if constexpr (Real<T>)
+    {
+        return static_cast<T>(std::numeric_limits<float>::infinity());
+    }
+    else
+    {
+        return std::numeric_limits<T>::max();
+    }
+}
+
+// van Herk / Gil-Werman running min or max over windows of 2 * radius + 1 elements, three
+// comparisons per element whatever the radius. The padded signal is cut into blocks of one window;
+// any window spans at most two blocks, so its extremum is the suffix extremum of the first block
+// combined with the prefix extremum of the second. Element i of lane l is in[i * stride + l], all
+// lanes are processed together so the inner loops are contiguous. padded and prefix are scratch.
+template <Number T, typename Select>
+auto RunningExtremum(T const* in, T* out, size_t size, size_t stride, size_t lanes, size_t radius, T identity, Select select, std::vector<T>& padded, std::vector<T>& prefix) -> void
+{
+    if (size == 0)
+    {
+        return;
+    }
+
+    // a window reaching past both ends covers the whole signal, larger radii change nothing
+    radius          = std::min(radius, size - 1);
+    size_t window   = 2 * radius + 1;
+    size_t extended = (size + 2 * radius + window - 1) / window * window;
+
+    padded.assign(extended * lanes, identity);
+    prefix.resize(extended * lanes);
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        std::copy_n(in + i * stride, lanes, padded.data() + (radius + i) * lanes);
+    }
+
+    for (size_t block = 0; block < extended; block += window)
+    {
+        T* p = prefix.data() + block * lanes;
+        T* s = padded.data() + block * lanes;
+
+        std::copy_n(s, lanes, p);
+        for (size_t j = 1; j < window; ++j)
+        {
+            for (size_t l = 0; l < lanes; ++l)
+            {
+                p[j * lanes + l] = select(p[(j - 1) * lanes + l], s[j * lanes + l]);
+            }
+        }
+
+        // suffix extrema overwrite the padded signal, each element is read once before it is replaced
+        for (size_t j = window - 1; j-- > 0;)
+        {
+            for (size_t l = 0; l < lanes; ++l)
+            {
+                s[j * lanes + l] = select(s[j * lanes + l], s[(j + 1) * lanes + l]);
+            }
+        }
+    }
+
+    // the window of element i is padded [i, i + window - 1]
+    for (size_t i = 0; i < size; ++i)
+    {
+        T const* suffix = padded.data() + i * lanes;
+        T const* last   = prefix.data() + (i + window - 1) * lanes;
+        for (size_t l = 0; l < lanes; ++l)
+        {
+            out[i * stride + l] = select(suffix[l], last[l]);
+        }
+    }
+}
+
+// Separable square window: along the rows in parallel by rows, then down the columns in parallel by
+// strips of columns.
+template <Number T, size_t N, typename Select>
+    requires(N == 2 || N == 3)
+auto MorphologyFilter(Tensor<T, N> const& image, size_t radius, T identity, Select select) -> Tensor<T, N>
+{
+    auto shape      = image.Shape();
+    size_t height   = shape[0];
+    size_t width    = shape[1];
+    size_t channels = N == 3 ? shape[2] : 1;
+    size_t stride   = width * channels;
+
+    Tensor<T, N> rows(shape);
+    Tensor<T, N> result(shape);
+
+    T const* input = image.Data();
+    T* row_extrema = rows.Data();
+    T* output      = result.Data();
+
+    DispatchRange(height, 16, [&](size_t start, size_t stop)
+    {
+        std::vector<T> padded, prefix;
+        for (size_t y = start; y < stop; ++y)
+        {
+            RunningExtremum(input + y * stride, row_extrema + y * stride, width, channels, channels, radius, identity, select, padded, prefix);
+        }
+    });
+
+    DispatchRange(stride, FilterStripWidth, [&](size_t start, size_t stop)
+    {
+        std::vector<T> padded, prefix;
+        for (size_t strip = start; strip < stop; strip += FilterStripWidth)
+        {
+            size_t lanes = std::min(FilterStripWidth, stop - strip);
+            RunningExtremum(row_extrema + strip, output + strip, height, stride, lanes, radius, identity, select, padded, prefix);
+        }
+    });
+
+    return result;
+}
+
+// Minimum over the window, shrinks bright regions.
+template <Number T, size_t N>
+    requires(N == 2 || N == 3)
+auto Erode(Tensor<T, N> const& image, size_t radius) -> Tensor<T, N>
+{
+    return MorphologyFilter(image, radius, HighestValue<T>(), [](T a, T b)
+    {
+        return b < a ? b : a;
+    });
+}
+
+// Maximum over the window, grows bright regions.
+template <Number T, size_t N>
+    requires(N == 2 || N == 3)
+auto Dilate(Tensor<T, N> const& image, size_t radius) -> Tensor<T, N>
+{
+    return MorphologyFilter(image, radius, LowestValue<T>(), [](T a, T b)
+    {
+        return a < b ? b : a;
+    });
+}
+
+// Erode then dilate, removes bright detail smaller than the window.
+template <Number T, size_t N>
+    requires(N == 2 || N == 3)
+auto Open(Tensor<T, N> const& image, size_t radius) -> Tensor<T, N>
+{
+    return Dilate(Erode(image, radius), radius);
+}
+
+// Dilate then erode, fills dark detail smaller than the window.
+template <Number T, size_t N>
+    requires(N == 2 || N == 3)
+auto Close(Tensor<T, N> const& image, size_t radius) -> Tensor<T, N>
+{
+    return Erode(Dilate(image, radius), radius);
+}
@@ -1,10 +1,16 @@
 #pragma once
 
+#include <Decoding.hpp>
 #include <Expect.hpp>
 #include <Tensor.hpp>
 #include <lodepng.h>
 
+#include <array>
+#include <cstdint>
 #include <fstream>
+#include <span>
+#include <string>
+#include <vector>
 
 auto EncodePng(const std::string& filename, Tensor<uint8_t, 3> const& rgb) -> void
 {
@@ -14,3 +20,55 @@ auto EncodePng(const std::string& filename, Tensor<uint8_t, 3> const& rgb) -> vo
     auto error = lodepng::encode(filename, rgb.Data(), width, height, LCT_RGB, 8);
     Expect(!error, "LodePNG encoding error: " + std::string(lodepng_error_text(error)));
 }
+
+// {height, width, channels} from the header alone, 1 channel for gray images and 3 for the rest.
+inline auto PngShape(std::span<uint8_t const> data) -> std::array<size_t, 3>
+{
+    unsigned width = 0, height = 0;
+    lodepng::State state;
+    auto error = lodepng_inspect(&width, &height, &state, data.data(), data.size());
+    Expect(!error, "LodePNG decoding error: " + std::string(lodepng_error_text(error)));
+
+    LodePNGColorType type = state.info_png.color.colortype;
+    return {height, width, type == LCT_GREY || type == LCT_GREY_ALPHA ? size_t(1) : size_t(3)};
+}
+
+// Decodes into a preallocated {height, width, channels} image, channels 1 or 3. LodePNG converts
+// palette, alpha and bit depth to gray or RGB at the depth of T into a per-thread buffer that is
+// reused across calls, then the samples are copied into the image.
+template <SampleElement T>
+auto DecodePng(std::span<uint8_t const> data, Tensor<T, 3>& image) -> void
+{
+    auto shape = image.Shape();
+    Expect(shape[2] == 1 || shape[2] == 3, "error: PNG images decode into 1 or 3 channels");
+
+    static thread_local std::vector<unsigned char> decoded;
+    decoded.clear();
+
+    unsigned width = 0, height = 0;
+    auto error = lodepng::decode(decoded, width, height, data.data(), data.size(), shape[2] == 1 ? LCT_GREY : LCT_RGB, sizeof(T) * 8);
+    Expect(!error, "LodePNG decoding error: " + std::string(lodepng_error_text(error)));
+    Expect(height == shape[0] && width == shape[1], "error: PNG size does not match the image");
+
+    ConvertSamples(decoded.data(), shape[2], sizeof(T) == 1 ? 255u : 65535u, image.Data(), shape[2], shape[0] * shape[1]);
+}
+
+template <SampleElement T>
+auto DecodePng(std::string const& filename, Tensor<T, 3>& image) -> void
+{
+    std::vector<uint8_t> bytes;
+    ReadFileBytes(filename, bytes);
+    DecodePng(std::span<uint8_t const>(bytes), image);
+}
+
+// Decodes into a new image with the file's own channel count.
+template <SampleElement T>
+auto DecodePng(std::string const& filename) -> Tensor<T, 3>
+{
+    std::vector<uint8_t> bytes;
+    ReadFileBytes(filename, bytes);
+
+    Tensor<T, 3> image(PngShape(bytes));
+    DecodePng(std::span<uint8_t const>(bytes), image);
+    return image;
+}
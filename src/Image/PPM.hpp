@@ -1,26 +1,152 @@
 #pragma once
 
+#include <Decoding.hpp>
 #include <Expect.hpp>
 #include <Tensor.hpp>
 
+#include <cctype>
+#include <cstdint>
 #include <fstream>
+#include <span>
+#include <string>
+#include <vector>
+
+// Writes a binary PPM a band of rows at a time, so encoding can start before the whole image is done.
+class PpmWriter
+{
+private:
+
+    std::ofstream outfile_;
+    size_t height_;
+    size_t width_;
+
+public:
+
+    PpmWriter(const std::string& filename, size_t height, size_t width)
+        : outfile_(filename, std::ios::binary)
+        , height_(height)
+        , width_(width)
+    {
+        if (!outfile_)
+        {
+            throw std::runtime_error("error: unable to open file for writing");
+        }
+
+        outfile_ << "P6" << std::endl;
+        outfile_ << width << " " << height << std::endl;
+        outfile_ << "255" << std::endl;
+    }
+
+    // Rows must arrive in order, each call appends rows [y_start, y_stop) of rgb.
+    auto WriteRows(Tensor<uint8_t, 3> const& rgb, size_t y_start, size_t y_stop) -> void
+    {
+        auto [height, width, channels] = rgb.Shape();
+        Expect(channels == 3, "Input tensor must have 3 channels (RGB)");
+        Expect(height == height_ && width == width_ && y_start <= y_stop && y_stop <= height, "error: rows outside the PPM image");
+
+        size_t row = width * channels;
+        outfile_.write(reinterpret_cast<const char*>(rgb.Data() + y_start * row), (y_stop - y_start) * row * sizeof(uint8_t));
+    }
+};
 
 auto EncodePpm(const std::string& filename, Tensor<uint8_t, 3> const& rgb) -> void
 {
     auto [height, width, channels] = rgb.Shape();
     Expect(channels == 3, "Input tensor must have 3 channels (RGB)");
 
-    std::ofstream outfile(filename, std::ios::binary);
-    if (!outfile)
+    PpmWriter writer(filename, height, width);
+    writer.WriteRows(rgb, 0, height);
+}
+
+// Binary PGM (P5, one channel) or PPM (P6, three channels) header, samples start at offset.
+struct PpmHeader
+{
+    size_t height   = 0;
+    size_t width    = 0;
+    size_t channels = 0;
+    uint32_t maxval = 0;
+    size_t offset   = 0;
+};
+
+inline auto ReadPpmHeader(std::span<uint8_t const> data) -> PpmHeader
+{
+    Expect(data.size() >= 2 && data[0] == 'P' && (data[1] == '5' || data[1] == '6'), "error: not a binary PGM or PPM image");
+
+    PpmHeader header;
+    header.channels = data[1] == '6' ? 3 : 1;
+
+    // width, height and maxval, separated by whitespace and comments running to the end of a line
+    size_t position = 2;
+    auto number     = [&]() -> size_t
     {
-        throw std::runtime_error("error: unable to open file for writing");
-    }
+        while (position < data.size() && (std::isspace(data[position]) || data[position] == '#'))
+        {
+            if (data[position] == '#')
+            {
+                while (position < data.size() && data[position] != '\n')
+                {
+                    ++position;
+                }
+            }
+            else
+            {
+                ++position;
+            }
+        }
+        Expect(position < data.size() && std::isdigit(data[position]), "error: malformed PPM header");
+
+        size_t value = 0;
+        while (position < data.size() && std::isdigit(data[position]) && value < (size_t(1) << 32))
+        {
+            value = value * 10 + (data[position++] - '0');
+        }
+        return value;
+    };
+
+    header.width  = number();
+    header.height = number();
+    header.maxval = static_cast<uint32_t>(number());
+    Expect(header.width <= (size_t(1) << 24) && header.height <= (size_t(1) << 24), "error: PPM image is too large");
+    Expect(header.maxval > 0 && header.maxval <= 65535, "error: PPM maxval must be in [1, 65535]");
+
+    // exactly one whitespace byte ends the header
+    Expect(position < data.size() && std::isspace(data[position]), "error: malformed PPM header");
+    header.offset = position + 1;
+
+    size_t bytes = header.height * header.width * header.channels * (header.maxval > 255 ? 2 : 1);
+    Expect(data.size() - header.offset >= bytes, "error: PPM data is truncated");
+    return header;
+}
+
+// Decodes into a preallocated {height, width, channels} image, channels 1 or 3 (a PGM fills all
+// three). Samples are rescaled from the file's maxval to the range of T.
+template <SampleElement T>
+auto DecodePpm(std::span<uint8_t const> data, Tensor<T, 3>& image) -> void
+{
+    PpmHeader header = ReadPpmHeader(data);
+    auto shape       = image.Shape();
+    Expect(shape[0] == header.height && shape[1] == header.width, "error: PPM size does not match the image");
+
+    ConvertSamples(data.data() + header.offset, header.channels, header.maxval, image.Data(), shape[2], header.height * header.width);
+}
 
-    outfile << "P6" << std::endl;
-    outfile << width << " " << height << std::endl;
-    outfile << "255" << std::endl;
+template <SampleElement T>
+auto DecodePpm(std::string const& filename, Tensor<T, 3>& image) -> void
+{
+    std::vector<uint8_t> bytes;
+    ReadFileBytes(filename, bytes);
+    DecodePpm(std::span<uint8_t const>(bytes), image);
+}
 
-    outfile.write(reinterpret_cast<const char*>(rgb.Data()), rgb.Size() * sizeof(uint8_t));
+// Decodes into a new image with the file's own channel count.
+template <SampleElement T>
+auto DecodePpm(std::string const& filename) -> Tensor<T, 3>
+{
+    std::vector<uint8_t> bytes;
+    ReadFileBytes(filename, bytes);
+    PpmHeader header = ReadPpmHeader(bytes);
 
-    outfile.close();
+    Tensor<T, 3> image({header.height, header.width, header.channels});
+    DecodePpm(std::span<uint8_t const>(bytes), image);
+    return image;
 }
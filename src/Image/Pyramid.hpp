@@ -0,0 +1,628 @@
+#pragma once
+
+#include <Dispatcher.hpp>
+#include <Expect.hpp>
+#include <Filter.hpp>
+#include <Number.hpp>
+#include <TaskGraph.hpp>
+#include <Tensor.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+// Gaussian and Laplacian pyramids with the 5-tap binomial kernel 1 4 6 4 1 in each direction. Images
+// are 2D, or 3D with interleaved channels last. Level k + 1 is level k blurred and decimated to
+// ceil(height / 2) x ceil(width / 2), borders mirrored without repeating the edge pixel.
+
+// Sums of the 256 kernel weights: 32 bits for integer elements up to 16 bits, 64 above, float for
+// the half types.
+template <Number T>
+using PyramidSum = std::conditional_t<Real<T>, std::conditional_t<std::is_floating_point_v<T>, T, float>, std::conditional_t<(sizeof(T) <= 2), int32_t, Accumulator<T>>>;
+
+// Band-pass levels hold differences, signed and one size up for integer images.
+template <Number T>
+using LaplacianElement = std::conditional_t<Real<T>, T, std::conditional_t<(sizeof(T) == 1), int16_t, std::conditional_t<(sizeof(T) == 2), int32_t, int64_t>>>;
+
+// Output rows of a level produced by one task. Neighbouring bands both filter the few source rows
+// they share, under 5% of the work at this height.
+inline constexpr size_t PyramidBandRows = 32;
+
+// Every level of a pyramid in one allocation, finest first, each starting on a cache line.
+template <Number T, size_t N>
+    requires(N == 2 || N == 3)
+class Pyramid
+{
+private:
+
+    std::vector<std::array<size_t, N>> shapes_;
+    std::vector<size_t> offsets_; // into storage_, one past the last level at the end
+    Tensor<T, 1> storage_;
+
+    static auto LevelShapes(std::array<size_t, N> base, size_t levels) -> std::vector<std::array<size_t, N>>
+    {
+        Expect(base[0] > 0 && base[1] > 0 && (N == 2 || base[N - 1] > 0), "error: a pyramid needs a non-empty image");
+
+        std::vector<std::array<size_t, N>> shapes = {base};
+        while (shapes.size() < levels && (base[0] > 1 || base[1] > 1))
+        {
+            base[0] = (base[0] + 1) / 2;
+            base[1] = (base[1] + 1) / 2;
+            shapes.push_back(base);
+        }
+        return shapes;
+    }
+
+    static auto LevelOffsets(std::vector<std::array<size_t, N>> const& shapes) -> std::vector<size_t>
+    {
+        constexpr size_t line = std::max<size_t>(64 / sizeof(T), 1);
+
+        std::vector<size_t> offsets = {0};
+        for (auto const& shape : shapes)
+        {
+            size_t size = shape[0] * shape[1] * (N == 3 ? shape[2] : 1);
+            offsets.push_back((offsets.back() + size + line - 1) / line * line);
+        }
+        return offsets;
+    }
+
+public:
+
+    // Levels of base down to levels of them or to 1x1, whichever comes first. Elements are left
+    // uninitialised.
+    Pyramid(std::array<size_t, N> base, size_t levels)
+        : shapes_(LevelShapes(base, levels))
+        , offsets_(LevelOffsets(shapes_))
+        , storage_(std::array<size_t, 1>{offsets_.back()})
+    {}
+
+    auto Levels() const -> size_t
+    {
+        return shapes_.size();
+    }
+
+    auto Shape(size_t level) const -> std::array<size_t, N> const&
+    {
+        return shapes_[level];
+    }
+
+    auto Size(size_t level) const -> size_t
+    {
+        return shapes_[level][0] * shapes_[level][1] * (N == 3 ? shapes_[level][2] : 1);
+    }
+
+    auto Data(size_t level) -> T*
+    {
+        return storage_.Data() + offsets_[level];
+    }
+
+    auto Data(size_t level) const -> T const*
+    {
+        return storage_.Data() + offsets_[level];
+    }
+
+    auto operator()(size_t level, size_t y, size_t x, size_t channel = 0) -> T&
+    {
+        auto const& shape = shapes_[level];
+        return Data(level)[(y * shape[1] + x) * (N == 3 ? shape[2] : 1) + channel];
+    }
+
+    auto operator()(size_t level, size_t y, size_t x, size_t channel = 0) const -> T const&
+    {
+        auto const& shape = shapes_[level];
+        return Data(level)[(y * shape[1] + x) * (N == 3 ? shape[2] : 1) + channel];
+    }
+
+    // The whole allocation, padding between levels included.
+    auto Storage() const -> std::span<T const>
+    {
+        return {storage_.Data(), storage_.Size()};
+    }
+
+    auto Level(size_t level) const -> Tensor<T, N>
+    {
+        Tensor<T, N> copy(shapes_[level]);
+        std::copy_n(Data(level), Size(level), copy.Data());
+        return copy;
+    }
+};
+
+// i mirrored into [0, n) about the edge elements, which are not repeated: -1 -> 1, n -> n - 2.
+inline auto ReflectIndex(std::ptrdiff_t i, size_t n) -> size_t
+{
+    std::ptrdiff_t last = static_cast<std::ptrdiff_t>(n) - 1;
+    if (i < 0)
+    {
+        i = -i;
+    }
+    if (i > last)
+    {
+        i = 2 * last - i;
+    }
+    return static_cast<size_t>(std::clamp<std::ptrdiff_t>(i, 0, last));
+}
+
+// sum / 2^Shift, integers rounded to nearest with halves up.
+template <int Shift, Number T, typename S>
+auto PyramidRound(S sum) -> T
+{
+    if constexpr (Real<T>)
+    {
+        return static_cast<T>(sum * (S(1) / S(1 << Shift)));
+    }
+    else
+    {
+        return static_cast<T>((sum + (S(1) << (Shift - 1))) >> Shift);
+    }
+}
+
+// Calls function with the channel count as a compile-time constant for the usual layouts, 0 for others.
+template <typename Function>
+auto WithChannels(size_t channels, Function&& function) -> void
+{
+    switch (channels)
+    {
+    case 1:
+        function(std::integral_constant<size_t, 1>());
+        break;
+    case 3:
+        function(std::integral_constant<size_t, 3>());
+        break;
+    case 4:
+        function(std::integral_constant<size_t, 4>());
+        break;
+    default:
+        function(std::integral_constant<size_t, 0>());
+        break;
+    }
+}
+
+// Horizontal 1 4 6 4 1 over one row at its even columns only, (width + 1) / 2 pixels out.
+template <size_t Channels, Number T, typename S>
+auto DecimateRow(T const* in, size_t width, size_t runtime_channels, S* out) -> void
+{
+    size_t channels  = Channels ? Channels : runtime_channels;
+    size_t out_width = (width + 1) / 2;
+
+    auto border = [&](size_t x)
+    {
+        std::ptrdiff_t center = 2 * static_cast<std::ptrdiff_t>(x);
+        for (size_t c = 0; c < channels; ++c)
+        {
+            auto at = [&](std::ptrdiff_t column)
+            {
+                return static_cast<S>(in[ReflectIndex(column, width) * channels + c]);
+            };
+            out[x * channels + c] = at(center - 2) + 4 * at(center - 1) + 6 * at(center) + 4 * at(center + 1) + at(center + 2);
+        }
+    };
+
+    // columns 2x - 2 .. 2x + 2 are all inside the row for 1 <= x < interior
+    size_t interior = width >= 3 ? std::min((width - 3) / 2 + 1, out_width) : 1;
+
+    border(0);
+    for (size_t x = 1; x < interior; ++x)
+    {
+        T const* p = in + (2 * x - 2) * channels;
+        S* q       = out + x * channels;
+        for (size_t c = 0; c < channels; ++c)
+        {
+            q[c] = static_cast<S>(p[c]) + 4 * static_cast<S>(p[c + channels]) + 6 * static_cast<S>(p[c + 2 * channels])
+                 + 4 * static_cast<S>(p[c + 3 * channels]) + static_cast<S>(p[c + 4 * channels]);
+        }
+    }
+    for (size_t x = std::max<size_t>(interior, 1); x < out_width; ++x)
+    {
+        border(x);
+    }
+}
+
+// Horizontal upsampling of one row to width columns, 1 6 1 at even and 4 4 at odd columns.
+template <size_t Channels, Number U, typename S>
+auto ExpandRow(U const* in, size_t coarse_width, size_t runtime_channels, size_t width, S* out) -> void
+{
+    size_t channels = Channels ? Channels : runtime_channels;
+
+    auto border = [&](size_t x)
+    {
+        std::ptrdiff_t m = static_cast<std::ptrdiff_t>(x / 2);
+        for (size_t c = 0; c < channels; ++c)
+        {
+            auto at = [&](std::ptrdiff_t column)
+            {
+                return static_cast<S>(in[ReflectIndex(column, coarse_width) * channels + c]);
+            };
+            out[x * channels + c] = x % 2 == 0 ? at(m - 1) + 6 * at(m) + at(m + 1) : 4 * (at(m) + at(m + 1));
+        }
+    };
+
+    // columns 2m and 2m + 1 read m - 1 .. m + 1, all inside the row for 1 <= m < interior
+    size_t interior = std::max<size_t>(std::min(coarse_width - 1, width / 2), 1);
+
+    for (size_t x = 0; x < std::min<size_t>(width, 2); ++x)
+    {
+        border(x);
+    }
+    for (size_t m = 1; m < interior; ++m)
+    {
+        U const* p = in + (m - 1) * channels;
+        S* q       = out + 2 * m * channels;
+        for (size_t c = 0; c < channels; ++c)
+        {
+            S left   = static_cast<S>(p[c]);
+            S center = static_cast<S>(p[c + channels]);
+            S right  = static_cast<S>(p[c + 2 * channels]);
+
+            q[c]            = left + 6 * center + right;
+            q[c + channels] = 4 * (center + right);
+        }
+    }
+    for (size_t x = std::max<size_t>(2 * interior, 2); x < width; ++x)
+    {
+        border(x);
+    }
+}
+
+// Rows [start, stop) of the level below a height x width image, blurred and decimated in one pass:
+// each source row is filtered horizontally at the surviving columns once, into a ring of five, and
+// each output row combines five of them.
+template <Number T>
+auto DecimateRows(T const* in, size_t height, size_t width, size_t channels, T* out, size_t start, size_t stop) -> void
+{
+    using Sum = PyramidSum<T>;
+
+    size_t in_stride  = width * channels;
+    size_t out_stride = (width + 1) / 2 * channels;
+
+    // rows for one output row lie within five consecutive source rows, so row % 5 never collides
+    std::vector<Sum> ring(5 * out_stride);
+    std::array<size_t, 5> cached;
+    cached.fill(std::numeric_limits<size_t>::max());
+
+    auto horizontal = [&](size_t row) -> Sum const*
+    {
+        Sum* slot = ring.data() + (row % 5) * out_stride;
+        if (cached[row % 5] != row)
+        {
+            WithChannels(channels, [&](auto constant)
+            {
+                DecimateRow<decltype(constant)::value>(in + row * in_stride, width, channels, slot);
+            });
+            cached[row % 5] = row;
+        }
+        return slot;
+    };
+
+    for (size_t y = start; y < stop; ++y)
+    {
+        std::ptrdiff_t center = 2 * static_cast<std::ptrdiff_t>(y);
+
+        Sum const* r0 = horizontal(ReflectIndex(center - 2, height));
+        Sum const* r1 = horizontal(ReflectIndex(center - 1, height));
+        Sum const* r2 = horizontal(ReflectIndex(center, height));
+        Sum const* r3 = horizontal(ReflectIndex(center + 1, height));
+        Sum const* r4 = horizontal(ReflectIndex(center + 2, height));
+        T* row        = out + y * out_stride;
+
+        for (size_t i = 0; i < out_stride; ++i)
+        {
+            row[i] = PyramidRound<8, T>(r0[i] + 4 * r1[i] + 6 * r2[i] + 4 * r3[i] + r4[i]);
+        }
+    }
+}
+
+// Rows [start, stop) of a coarse level expanded to twice its size cut to height x width, 1 6 1 on
+// even and 4 4 on odd rows and columns, passed to apply(y, row) one row at a time.
+template <Number U, typename Apply>
+auto ExpandRows(U const* in, size_t coarse_height, size_t coarse_width, size_t channels, size_t width, size_t start, size_t stop, Apply&& apply) -> void
+{
+    using Sum = PyramidSum<U>;
+
+    size_t in_stride  = coarse_width * channels;
+    size_t out_stride = width * channels;
+
+    // rows m - 1 .. m + 1 at most, distinct modulo 3
+    std::vector<Sum> ring(3 * out_stride);
+    std::vector<U> expanded(out_stride);
+    std::array<size_t, 3> cached;
+    cached.fill(std::numeric_limits<size_t>::max());
+
+    auto horizontal = [&](size_t row) -> Sum const*
+    {
+        Sum* slot = ring.data() + (row % 3) * out_stride;
+        if (cached[row % 3] != row)
+        {
+            WithChannels(channels, [&](auto constant)
+            {
+                ExpandRow<decltype(constant)::value>(in + row * in_stride, coarse_width, channels, width, slot);
+            });
+            cached[row % 3] = row;
+        }
+        return slot;
+    };
+
+    for (size_t y = start; y < stop; ++y)
+    {
+        std::ptrdiff_t m = static_cast<std::ptrdiff_t>(y / 2);
+
+        Sum const* center = horizontal(static_cast<size_t>(m));
+        Sum const* below  = horizontal(ReflectIndex(m + 1, coarse_height));
+        U* row            = expanded.data();
+
+        if (y % 2 == 0)
+        {
+            Sum const* above = horizontal(ReflectIndex(m - 1, coarse_height));
+            for (size_t i = 0; i < out_stride; ++i)
+            {
+                row[i] = PyramidRound<6, U>(above[i] + 6 * center[i] + below[i]);
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < out_stride; ++i)
+            {
+                row[i] = PyramidRound<6, U>(4 * (center[i] + below[i]));
+            }
+        }
+        apply(y, static_cast<U const*>(row));
+    }
+}
+
+// Tasks of the bands of a height-row level that hold any of rows first .. last, mirrored at the edges.
+inline auto BandTasks(std::vector<TaskGraph::TaskId> const& bands, std::ptrdiff_t first, std::ptrdiff_t last, size_t height) -> std::vector<TaskGraph::TaskId>
+{
+    size_t low  = height;
+    size_t high = 0;
+    for (std::ptrdiff_t i = first; i <= last; ++i)
+    {
+        size_t row = ReflectIndex(i, height);
+        low        = std::min(low, row);
+        high       = std::max(high, row);
+    }
+    return {bands.begin() + low / PyramidBandRows, bands.begin() + high / PyramidBandRows + 1};
+}
+
+// One level down from image.
+template <Number T, size_t N>
+    requires(N == 2 || N == 3)
+auto PyramidDown(Tensor<T, N> const& image) -> Tensor<T, N>
+{
+    auto shape      = image.Shape();
+    size_t height   = shape[0];
+    size_t width    = shape[1];
+    size_t channels = N == 3 ? shape[2] : 1;
+
+    auto down_shape = shape;
+    down_shape[0]   = (height + 1) / 2;
+    down_shape[1]   = (width + 1) / 2;
+    Tensor<T, N> result(down_shape);
+    if (image.Size() == 0)
+    {
+        return result;
+    }
+
+    T const* in = image.Data();
+    T* out      = result.Data();
+    DispatchRange(down_shape[0], PyramidBandRows, [&](size_t start, size_t stop)
+    {
+        DecimateRows(in, height, width, channels, out, start, stop);
+    });
+    return result;
+}
+
+// Adds tasks filling the levels of pyramid from image to graph, a task per band of rows, and returns
+// the band tasks of each level. A band waits only for the bands of the level above it reads, so
+// coarse levels start as soon as the first fine rows exist. Level 0 is copied from the image in
+// bands of its own, or left untouched without copy_base; level 1 reads the image either way.
+template <Number T, size_t N>
+auto AddPyramidTasks(TaskGraph& graph, Tensor<T, N> const& image, Pyramid<T, N>& pyramid, bool copy_base) -> std::vector<std::vector<TaskGraph::TaskId>>
+{
+    std::vector<std::vector<TaskGraph::TaskId>> bands(pyramid.Levels());
+
+    size_t row_size = pyramid.Size(0) / pyramid.Shape(0)[0];
+    for (size_t start = 0; copy_base && start < pyramid.Shape(0)[0]; start += PyramidBandRows)
+    {
+        size_t stop   = std::min(start + PyramidBandRows, pyramid.Shape(0)[0]);
+        T const* from = image.Data() + start * row_size;
+        T* to         = pyramid.Data(0) + start * row_size;
+        bands[0].push_back(graph.Add("PyramidCopy", [from, to, count = (stop - start) * row_size]()
+        {
+            std::memcpy(to, from, count * sizeof(T));
+        }));
+    }
+
+    for (size_t level = 1; level < pyramid.Levels(); ++level)
+    {
+        auto const& above = pyramid.Shape(level - 1);
+        size_t channels   = N == 3 ? above[2] : 1;
+        T const* in       = level == 1 ? image.Data() : pyramid.Data(level - 1);
+        T* out            = pyramid.Data(level);
+
+        for (size_t start = 0; start < pyramid.Shape(level)[0]; start += PyramidBandRows)
+        {
+            size_t stop = std::min(start + PyramidBandRows, pyramid.Shape(level)[0]);
+
+            std::vector<TaskGraph::TaskId> dependencies;
+            if (level > 1)
+            {
+                std::ptrdiff_t first = 2 * static_cast<std::ptrdiff_t>(start) - 2;
+                std::ptrdiff_t last  = 2 * static_cast<std::ptrdiff_t>(stop - 1) + 2;
+                dependencies         = BandTasks(bands[level - 1], first, last, above[0]);
+            }
+
+            bands[level].push_back(graph.Add("PyramidDown", [=, height = above[0], width = above[1]]()
+            {
+                DecimateRows(in, height, width, channels, out, start, stop);
+            }, dependencies));
+        }
+    }
+    return bands;
+}
+
+// Levels of image down to levels of them or to 1x1, level 0 being the image itself.
+template <Number T, size_t N>
+    requires(N == 2 || N == 3)
+auto GaussianPyramid(Tensor<T, N> const& image, size_t levels) -> Pyramid<T, N>
+{
+    Pyramid<T, N> pyramid(image.Shape(), levels);
+
+    TaskGraph graph;
+    AddPyramidTasks(graph, image, pyramid, true);
+    graph.Run();
+    return pyramid;
+}
+
+// Level k is Gaussian level k minus Gaussian level k + 1 expanded, the last level the coarsest
+// Gaussian level itself. Band-pass bands run in the same graph as the Gaussian ones they read.
+template <Number T, size_t N>
+    requires(N == 2 || N == 3)
+auto LaplacianPyramid(Tensor<T, N> const& image, size_t levels) -> Pyramid<LaplacianElement<T>, N>
+{
+    using E = LaplacianElement<T>;
+
+    // level 0 of the Gaussian pyramid is never written, its pages are never touched
+    Pyramid<T, N> gaussian(image.Shape(), levels);
+    Pyramid<E, N> laplacian(image.Shape(), gaussian.Levels());
+    size_t last = gaussian.Levels() - 1;
+
+    TaskGraph graph;
+    auto bands = AddPyramidTasks(graph, image, gaussian, false);
+
+    for (size_t level = 0; level < last; ++level)
+    {
+        auto const& shape      = gaussian.Shape(level);
+        auto const& coarse     = gaussian.Shape(level + 1);
+        size_t channels        = N == 3 ? shape[2] : 1;
+        size_t stride          = shape[1] * channels;
+        T const* fine          = level == 0 ? image.Data() : gaussian.Data(level);
+        T const* coarse_levels = gaussian.Data(level + 1);
+        E* out                 = laplacian.Data(level);
+
+        for (size_t start = 0; start < shape[0]; start += PyramidBandRows)
+        {
+            size_t stop = std::min(start + PyramidBandRows, shape[0]);
+
+            std::ptrdiff_t first    = static_cast<std::ptrdiff_t>(start / 2) - 1;
+            std::ptrdiff_t last_row = static_cast<std::ptrdiff_t>((stop - 1) / 2) + 1;
+            auto dependencies       = BandTasks(bands[level + 1], first, last_row, coarse[0]);
+            if (level > 0)
+            {
+                auto own = BandTasks(bands[level], static_cast<std::ptrdiff_t>(start), static_cast<std::ptrdiff_t>(stop - 1), shape[0]);
+                dependencies.insert(dependencies.end(), own.begin(), own.end());
+            }
+
+            graph.Add("PyramidBandPass", [=, width = shape[1]]()
+            {
+                ExpandRows(coarse_levels, coarse[0], coarse[1], channels, width, start, stop, [&](size_t y, T const* expanded)
+                {
+                    T const* source = fine + y * stride;
+                    E* target       = out + y * stride;
+                    for (size_t i = 0; i < stride; ++i)
+                    {
+                        target[i] = static_cast<E>(static_cast<E>(source[i]) - static_cast<E>(expanded[i]));
+                    }
+                });
+            }, dependencies);
+        }
+    }
+
+    graph.Run();
+
+    T const* coarsest = last == 0 ? image.Data() : gaussian.Data(last);
+    std::transform(coarsest, coarsest + gaussian.Size(last), laplacian.Data(last), [](T value)
+    {
+        return static_cast<E>(value);
+    });
+    return laplacian;
+}
+
+// Sums a Laplacian pyramid back into an image, coarse to fine, each level's bands starting once the
+// coarser bands they expand are done. Integer images come back bit for bit; edited coefficients are
+// clamped to the range of T.
+template <Number T, Number E, size_t N>
+    requires(N == 2 || N == 3)
+auto ReconstructLaplacian(Pyramid<E, N> const& laplacian) -> Tensor<T, N>
+{
+    auto to_element = [](E value)
+    {
+        if constexpr (Integer<T> && sizeof(T) < sizeof(E))
+        {
+            return static_cast<T>(std::clamp<E>(value, static_cast<E>(std::numeric_limits<T>::lowest()), static_cast<E>(std::numeric_limits<T>::max())));
+        }
+        else
+        {
+            return static_cast<T>(value);
+        }
+    };
+
+    Tensor<T, N> result(laplacian.Shape(0));
+    size_t last = laplacian.Levels() - 1;
+    if (last == 0)
+    {
+        std::transform(laplacian.Data(0), laplacian.Data(0) + laplacian.Size(0), result.Data(), to_element);
+        return result;
+    }
+
+    // intermediate levels; level 0 goes straight into the result and the scratch pages stay untouched
+    Pyramid<E, N> sums(laplacian.Shape(0), laplacian.Levels());
+
+    TaskGraph graph;
+    std::vector<std::vector<TaskGraph::TaskId>> bands(laplacian.Levels());
+    for (size_t level = last; level-- > 0;)
+    {
+        auto const& shape  = laplacian.Shape(level);
+        auto const& coarse = laplacian.Shape(level + 1);
+        size_t channels    = N == 3 ? shape[2] : 1;
+        size_t stride      = shape[1] * channels;
+        E const* in        = level + 1 == last ? laplacian.Data(last) : sums.Data(level + 1);
+        E const* band_pass = laplacian.Data(level);
+        E* out             = sums.Data(level);
+        T* image           = result.Data();
+
+        for (size_t start = 0; start < shape[0]; start += PyramidBandRows)
+        {
+            size_t stop = std::min(start + PyramidBandRows, shape[0]);
+
+            std::vector<TaskGraph::TaskId> dependencies;
+            if (level + 1 < last)
+            {
+                std::ptrdiff_t first    = static_cast<std::ptrdiff_t>(start / 2) - 1;
+                std::ptrdiff_t last_row = static_cast<std::ptrdiff_t>((stop - 1) / 2) + 1;
+                dependencies            = BandTasks(bands[level + 1], first, last_row, coarse[0]);
+            }
+
+            bands[level].push_back(graph.Add("PyramidCollapse", [=, width = shape[1]]()
+            {
+                ExpandRows(in, coarse[0], coarse[1], channels, width, start, stop, [&](size_t y, E const* expanded)
+                {
+                    E const* detail = band_pass + y * stride;
+                    if (level == 0)
+                    {
+                        T* target = image + y * stride;
+                        for (size_t i = 0; i < stride; ++i)
+                        {
+                            target[i] = to_element(static_cast<E>(detail[i] + expanded[i]));
+                        }
+                    }
+                    else
+                    {
+                        E* target = out + y * stride;
+                        for (size_t i = 0; i < stride; ++i)
+                        {
+                            target[i] = static_cast<E>(detail[i] + expanded[i]);
+                        }
+                    }
+                });
+            }, dependencies));
+        }
+    }
+
+    graph.Run();
+    return result;
+}
@@ -0,0 +1,440 @@
+#pragma once
+
+#include <Dispatcher.hpp>
+#include <Expect.hpp>
+#include <Number.hpp>
+#include <StaticTensor.hpp>
+#include <Tensor.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numbers>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MATRIX_WARP_SSE2
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define MATRIX_WARP_NEON
+#endif
+
+// Geometric transforms of images, 2D or 3D with interleaved channels last. Matrices act on column
+// vectors (x, y, 1) with x along the width and map source positions to destination positions.
+// Integer coordinates are pixel centres.
+using AffineMatrix      = StaticTensor<double, Extents<2, 3>>;
+using PerspectiveMatrix = StaticTensor<double, Extents<3, 3>>;
+
+enum class Interpolation
+{
+    Nearest,
+    Bilinear,
+};
+
+enum class BorderMode
+{
+    Constant,  // outside pixels read as WarpOptions::fill
+    Replicate, // nearest edge pixel, aaa|abcd|ddd
+    Reflect,   // mirrored without repeating the edge, dcb|abcd|cba
+    Wrap,      // periodic, bcd|abcd|abc
+};
+
+struct WarpOptions
+{
+    Interpolation interpolation = Interpolation::Bilinear;
+    BorderMode border           = BorderMode::Constant;
+    double fill                 = 0.0;
+    size_t tile                 = 64; // output tiles, small enough that their source footprint stays in cache
+};
+
+// Rotation by degrees about (center_x, center_y), counter-clockwise as displayed with y pointing
+// down, combined with a uniform scale.
+inline auto RotationMatrix(double center_x, double center_y, double degrees, double scale = 1.0) -> AffineMatrix
+{
+    double radians = degrees * std::numbers::pi / 180.0;
+    double a       = scale * std::cos(radians);
+    double b       = scale * std::sin(radians);
+    return AffineMatrix({
+        {a, b, (1.0 - a) * center_x - b * center_y},
+        {-b, a, b * center_x + (1.0 - a) * center_y},
+    });
+}
+
+inline auto InvertTransform(AffineMatrix const& m) -> AffineMatrix
+{
+    double determinant = m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0);
+    Expect(determinant != 0.0, "error: affine transform is not invertible");
+
+    double a = m(1, 1) / determinant, b = -m(0, 1) / determinant;
+    double c = -m(1, 0) / determinant, d = m(0, 0) / determinant;
+    return AffineMatrix({
+        {a, b, -(a * m(0, 2) + b * m(1, 2))},
+        {c, d, -(c * m(0, 2) + d * m(1, 2))},
+    });
+}
+
+inline auto InvertTransform(PerspectiveMatrix const& m) -> PerspectiveMatrix
+{
+    // adjugate over determinant
+    PerspectiveMatrix inverse({
+        {m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1), m(0, 2) * m(2, 1) - m(0, 1) * m(2, 2), m(0, 1) * m(1, 2) - m(0, 2) * m(1, 1)},
+        {m(1, 2) * m(2, 0) - m(1, 0) * m(2, 2), m(0, 0) * m(2, 2) - m(0, 2) * m(2, 0), m(0, 2) * m(1, 0) - m(0, 0) * m(1, 2)},
+        {m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0), m(0, 1) * m(2, 0) - m(0, 0) * m(2, 1), m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0)},
+    });
+
+    double determinant = m(0, 0) * inverse(0, 0) + m(0, 1) * inverse(1, 0) + m(0, 2) * inverse(2, 0);
+    Expect(determinant != 0.0, "error: perspective transform is not invertible");
+    return inverse / determinant;
+}
+
+// Index of the source element read for position i along an axis of extent elements, or -1 for a
+// constant border.
+inline auto BorderIndex(ptrdiff_t i, ptrdiff_t extent, BorderMode border) -> ptrdiff_t
+{
+    if (i >= 0 && i < extent)
+    {
+        return i;
+    }
+
+    switch (border)
+    {
+    case BorderMode::Constant:
+        return -1;
+    case BorderMode::Replicate:
+        return std::clamp<ptrdiff_t>(i, 0, extent - 1);
+    case BorderMode::Reflect:
+    {
+        if (extent == 1)
+        {
+            return 0;
+        }
+        ptrdiff_t period = 2 * (extent - 1);
+        ptrdiff_t folded = (i % period + period) % period;
+        return folded < extent ? folded : period - folded;
+    }
+    case BorderMode::Wrap:
+        return (i % extent + extent) % extent;
+    }
+    return -1;
+}
+
+template <Number T>
+auto RoundSample(double value) -> T
+{
+    if constexpr (Integer<T>)
+    {
+        double limited = std::clamp(std::round(value), static_cast<double>(std::numeric_limits<T>::lowest()), static_cast<double>(std::numeric_limits<T>::max()));
+        return static_cast<T>(limited);
+    }
+    else
+    {
+        return static_cast<T>(value);
+    }
+}
+
+// Source positions further out than this are clamped before conversion to integers; every border
+// mode already treats them as far outside, or folds them back from the clamped position.
+inline constexpr double WarpCoordinateLimit = 1 << 24;
+
+// Source positions are Q32 fixed point, so a tile row steps through them with integer adds and the
+// integer and fractional parts come out with shifts and masks.
+inline constexpr int WarpFractionBits = 32;
+
+inline auto ToWarpFixed(double position) -> int64_t
+{
+    // truncating a value offset to be positive floors it, without a libm call
+    constexpr double Offset = static_cast<double>(int64_t(1) << 56);
+    double clamped          = std::clamp(position, -WarpCoordinateLimit, WarpCoordinateLimit);
+    return static_cast<int64_t>(clamped * 4294967296.0 + Offset) - (int64_t(1) << 56);
+}
+
+// ----- 8-bit fixed-point bilinear blend, vector body plus scalar tail -----
+
+// Bilinear weights are Q7. top and bottom hold each output element's left and right neighbours as
+// int16 pairs, horizontal and vertical hold the matching (128 - w, w) weight pairs. The horizontal
+// blend stays below 2^15, so it is repacked into (top, bottom) pairs for the vertical one.
+inline auto BlendBilinear(int16_t const* top, int16_t const* bottom, int16_t const* horizontal, int16_t const* vertical, uint8_t* output, size_t size) -> void
+{
+    size_t i = 0;
+#if defined(MATRIX_WARP_SSE2)
+    auto blend4 = [&](size_t e)
+    {
+        __m128i weights = _mm_loadu_si128(reinterpret_cast<__m128i const*>(horizontal + 2 * e));
+        __m128i upper   = _mm_madd_epi16(_mm_loadu_si128(reinterpret_cast<__m128i const*>(top + 2 * e)), weights);
+        __m128i lower   = _mm_madd_epi16(_mm_loadu_si128(reinterpret_cast<__m128i const*>(bottom + 2 * e)), weights);
+        __m128i pairs   = _mm_unpacklo_epi16(_mm_packs_epi32(upper, upper), _mm_packs_epi32(lower, lower));
+        __m128i blended = _mm_madd_epi16(pairs, _mm_loadu_si128(reinterpret_cast<__m128i const*>(vertical + 2 * e)));
+        return _mm_srai_epi32(_mm_add_epi32(blended, _mm_set1_epi32(1 << 13)), 14);
+    };
+    for (; i + 8 <= size; i += 8)
+    {
+        __m128i words = _mm_packs_epi32(blend4(i), blend4(i + 4));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(output + i), _mm_packus_epi16(words, words));
+    }
+#elif defined(MATRIX_WARP_NEON)
+    auto madd = [](int16x8_t values, int16x8_t weights)
+    {
+        return vpaddq_s32(vmull_s16(vget_low_s16(values), vget_low_s16(weights)), vmull_high_s16(values, weights));
+    };
+    auto blend4 = [&](size_t e)
+    {
+        int16x8_t weights = vld1q_s16(horizontal + 2 * e);
+        int16x4_t upper   = vmovn_s32(madd(vld1q_s16(top + 2 * e), weights));
+        int16x4_t lower   = vmovn_s32(madd(vld1q_s16(bottom + 2 * e), weights));
+        int16x8_t pairs   = vcombine_s16(vzip1_s16(upper, lower), vzip2_s16(upper, lower));
+        return vrshrq_n_s32(madd(pairs, vld1q_s16(vertical + 2 * e)), 14);
+    };
+    for (; i + 8 <= size; i += 8)
+    {
+        int16x8_t words = vcombine_s16(vmovn_s32(blend4(i)), vmovn_s32(blend4(i + 4)));
+        vst1_u8(output + i, vqmovun_s16(words));
+    }
+#endif
+    for (; i < size; ++i)
+    {
+        int32_t upper = top[2 * i] * horizontal[2 * i] + top[2 * i + 1] * horizontal[2 * i + 1];
+        int32_t lower = bottom[2 * i] * horizontal[2 * i] + bottom[2 * i + 1] * horizontal[2 * i + 1];
+        output[i]     = static_cast<uint8_t>((upper * vertical[2 * i] + lower * vertical[2 * i + 1] + (1 << 13)) >> 14);
+    }
+}
+
+// Resamples image through inverse, which maps destination positions to source positions. Output
+// tiles are dispatched in parallel; within a tile row the source position advances by adding the
+// matrix's first column instead of a full product per pixel, for affine maps as a fixed-point add.
+template <bool Perspective, Number T, size_t N>
+    requires(N == 2 || N == 3)
+auto WarpImage(Tensor<T, N> const& image, PerspectiveMatrix const& inverse, std::array<size_t, 2> size, WarpOptions const& options) -> Tensor<T, N>
+{
+    auto shape      = image.Shape();
+    ptrdiff_t src_h = static_cast<ptrdiff_t>(shape[0]);
+    ptrdiff_t src_w = static_cast<ptrdiff_t>(shape[1]);
+    size_t channels = N == 3 ? shape[2] : 1;
+
+    auto [height, width] = size;
+    auto result_shape    = shape;
+    result_shape[0]      = height;
+    result_shape[1]      = width;
+    Tensor<T, N> result(result_shape);
+
+    if (result.Size() == 0)
+    {
+        return result;
+    }
+    Expect(image.Size() > 0 || options.border == BorderMode::Constant, "error: only a constant border can warp an empty image");
+
+    T const* source = image.Data();
+    T* output       = result.Data();
+    T fill          = RoundSample<T>(options.fill);
+    size_t tile     = std::max<size_t>(options.tile, 1);
+    size_t block    = std::max<size_t>(256 / tile, 1) * tile;
+
+    constexpr bool FixedPoint = std::same_as<T, uint8_t>;
+
+    // neighbours of a position near or past the border, resolved once per pixel for all channels
+    struct Taps
+    {
+        ptrdiff_t x0, x1, y0, y1;
+    };
+
+    auto taps = [&](ptrdiff_t x, ptrdiff_t y) -> Taps
+    {
+        return {BorderIndex(x, src_w, options.border), BorderIndex(x + 1, src_w, options.border), BorderIndex(y, src_h, options.border), BorderIndex(y + 1, src_h, options.border)};
+    };
+
+    auto read = [&](ptrdiff_t y, ptrdiff_t x, size_t c) -> T
+    {
+        return y < 0 || x < 0 ? fill : source[(y * src_w + x) * channels + c];
+    };
+
+    DispatchBlocks(height, width, block, block, [&](size_t y_start, size_t y_stop, size_t x_start, size_t x_stop)
+    {
+        std::vector<int64_t> xs(tile), ys(tile);
+        std::vector<int16_t> top, bottom, horizontal, vertical;
+        if constexpr (FixedPoint)
+        {
+            top.resize(2 * tile * channels);
+            bottom.resize(2 * tile * channels);
+            horizontal.resize(2 * tile * channels);
+            vertical.resize(2 * tile * channels);
+        }
+
+        constexpr int64_t One  = int64_t(1) << WarpFractionBits;
+        constexpr int64_t Half = One >> 1;
+
+        for (size_t tile_y = y_start; tile_y < y_stop; tile_y += tile)
+        {
+            for (size_t tile_x = x_start; tile_x < x_stop; tile_x += tile)
+            {
+                size_t tile_y_stop = std::min(tile_y + tile, y_stop);
+                size_t tile_x_stop = std::min(tile_x + tile, x_stop);
+                size_t run         = tile_x_stop - tile_x;
+
+                for (size_t y = tile_y; y < tile_y_stop; ++y)
+                {
+                    double fx = static_cast<double>(tile_x);
+                    double fy = static_cast<double>(y);
+                    double sx = inverse(0, 0) * fx + inverse(0, 1) * fy + inverse(0, 2);
+                    double sy = inverse(1, 0) * fx + inverse(1, 1) * fy + inverse(1, 2);
+
+                    if constexpr (Perspective)
+                    {
+                        double sw = inverse(2, 0) * fx + inverse(2, 1) * fy + inverse(2, 2);
+                        for (size_t i = 0; i < run; ++i)
+                        {
+                            // behind the projection centre, treated as far outside the source
+                            xs[i] = ToWarpFixed(sw > 0.0 ? sx / sw : -WarpCoordinateLimit);
+                            ys[i] = ToWarpFixed(sw > 0.0 ? sy / sw : -WarpCoordinateLimit);
+                            sx += inverse(0, 0);
+                            sy += inverse(1, 0);
+                            sw += inverse(2, 0);
+                        }
+                    }
+                    else
+                    {
+                        // positions are linear along the row, when both ends are in range so is every step
+                        double ex = sx + inverse(0, 0) * static_cast<double>(run - 1);
+                        double ey = sy + inverse(1, 0) * static_cast<double>(run - 1);
+                        bool exact = std::max({std::abs(sx), std::abs(sy), std::abs(ex), std::abs(ey)}) < WarpCoordinateLimit;
+
+                        int64_t qx = ToWarpFixed(sx), dx = ToWarpFixed(inverse(0, 0));
+                        int64_t qy = ToWarpFixed(sy), dy = ToWarpFixed(inverse(1, 0));
+                        for (size_t i = 0; i < run; ++i)
+                        {
+                            xs[i] = exact ? qx : ToWarpFixed(sx + inverse(0, 0) * static_cast<double>(i));
+                            ys[i] = exact ? qy : ToWarpFixed(sy + inverse(1, 0) * static_cast<double>(i));
+                            qx += dx;
+                            qy += dy;
+                        }
+                    }
+
+                    T* out = output + (y * width + tile_x) * channels;
+
+                    if (options.interpolation == Interpolation::Nearest)
+                    {
+                        for (size_t i = 0; i < run; ++i)
+                        {
+                            auto ix = static_cast<ptrdiff_t>((xs[i] + Half) >> WarpFractionBits);
+                            auto iy = static_cast<ptrdiff_t>((ys[i] + Half) >> WarpFractionBits);
+                            if (ix >= 0 && ix < src_w && iy >= 0 && iy < src_h)
+                            {
+                                std::copy_n(source + (iy * src_w + ix) * channels, channels, out + i * channels);
+                                continue;
+                            }
+                            ix = BorderIndex(ix, src_w, options.border);
+                            iy = BorderIndex(iy, src_h, options.border);
+                            for (size_t c = 0; c < channels; ++c)
+                            {
+                                out[i * channels + c] = read(iy, ix, c);
+                            }
+                        }
+                    }
+                    else if constexpr (FixedPoint)
+                    {
+                        // gather the four neighbours and Q7 weights of every element, then blend in bulk
+                        constexpr int WeightShift = WarpFractionBits - 7;
+                        for (size_t i = 0; i < run; ++i)
+                        {
+                            int64_t qx = xs[i] + (int64_t(1) << (WeightShift - 1));
+                            int64_t qy = ys[i] + (int64_t(1) << (WeightShift - 1));
+                            auto x0    = static_cast<ptrdiff_t>(qx >> WarpFractionBits);
+                            auto y0    = static_cast<ptrdiff_t>(qy >> WarpFractionBits);
+                            auto wx    = static_cast<int16_t>((qx >> WeightShift) & 127);
+                            auto wy    = static_cast<int16_t>((qy >> WeightShift) & 127);
+                            bool fast  = x0 >= 0 && x0 + 1 < src_w && y0 >= 0 && y0 + 1 < src_h;
+
+                            uint8_t const* p = fast ? source + (y0 * src_w + x0) * channels : nullptr;
+                            Taps t           = fast ? Taps{} : taps(x0, y0);
+                            for (size_t c = 0; c < channels; ++c)
+                            {
+                                size_t e = 2 * (i * channels + c);
+                                if (fast)
+                                {
+                                    top[e]        = p[c];
+                                    top[e + 1]    = p[channels + c];
+                                    bottom[e]     = p[src_w * channels + c];
+                                    bottom[e + 1] = p[(src_w + 1) * channels + c];
+                                }
+                                else
+                                {
+                                    top[e]        = read(t.y0, t.x0, c);
+                                    top[e + 1]    = read(t.y0, t.x1, c);
+                                    bottom[e]     = read(t.y1, t.x0, c);
+                                    bottom[e + 1] = read(t.y1, t.x1, c);
+                                }
+                                horizontal[e]     = static_cast<int16_t>(128 - wx);
+                                horizontal[e + 1] = wx;
+                                vertical[e]       = static_cast<int16_t>(128 - wy);
+                                vertical[e + 1]   = wy;
+                            }
+                        }
+                        BlendBilinear(top.data(), bottom.data(), horizontal.data(), vertical.data(), out, run * channels);
+                    }
+                    else
+                    {
+                        constexpr double Scale = 1.0 / static_cast<double>(One);
+                        for (size_t i = 0; i < run; ++i)
+                        {
+                            auto x0   = static_cast<ptrdiff_t>(xs[i] >> WarpFractionBits);
+                            auto y0   = static_cast<ptrdiff_t>(ys[i] >> WarpFractionBits);
+                            double wx = static_cast<double>(xs[i] & (One - 1)) * Scale;
+                            double wy = static_cast<double>(ys[i] & (One - 1)) * Scale;
+                            Taps t    = taps(x0, y0);
+
+                            for (size_t c = 0; c < channels; ++c)
+                            {
+                                double a = static_cast<double>(read(t.y0, t.x0, c));
+                                double b = static_cast<double>(read(t.y0, t.x1, c));
+                                double d = static_cast<double>(read(t.y1, t.x0, c));
+                                double e = static_cast<double>(read(t.y1, t.x1, c));
+
+                                double upper          = a + (b - a) * wx;
+                                double lower          = d + (e - d) * wx;
+                                out[i * channels + c] = RoundSample<T>(upper + (lower - upper) * wy);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    });
+
+    return result;
+}
+
+// Output of the given {height, width}, where every destination pixel p shows the source at
+// matrix^-1 * p.
+template <Number T, size_t N>
+    requires(N == 2 || N == 3)
+auto WarpAffine(Tensor<T, N> const& image, AffineMatrix const& matrix, std::array<size_t, 2> size, WarpOptions const& options = {}) -> Tensor<T, N>
+{
+    AffineMatrix inverse = InvertTransform(matrix);
+    PerspectiveMatrix extended({
+        {inverse(0, 0), inverse(0, 1), inverse(0, 2)},
+        {inverse(1, 0), inverse(1, 1), inverse(1, 2)},
+        {0.0, 0.0, 1.0},
+    });
+    return WarpImage<false>(image, extended, size, options);
+}
+
+// Homography warp. Destination pixels whose source position has w <= 0 read as far outside the source.
+template <Number T, size_t N>
+    requires(N == 2 || N == 3)
+auto WarpPerspective(Tensor<T, N> const& image, PerspectiveMatrix const& matrix, std::array<size_t, 2> size, WarpOptions const& options = {}) -> Tensor<T, N>
+{
+    return WarpImage<true>(image, InvertTransform(matrix), size, options);
+}
+
+// Rotation about the image centre into an output of the same size.
+template <Number T, size_t N>
+    requires(N == 2 || N == 3)
+auto Rotate(Tensor<T, N> const& image, double degrees, WarpOptions const& options = {}) -> Tensor<T, N>
+{
+    auto shape      = image.Shape();
+    double center_x = (static_cast<double>(shape[1]) - 1.0) / 2.0;
+    double center_y = (static_cast<double>(shape[0]) - 1.0) / 2.0;
+    return WarpAffine(image, RotationMatrix(center_x, center_y, degrees), {shape[0], shape[1]}, options);
+}
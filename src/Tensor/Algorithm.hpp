@@ -0,0 +1,269 @@
+#pragma once
+
+#include <Dispatcher.hpp>
+#include <Expect.hpp>
+#include <Number.hpp>
+#include <Tensor.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+// Element-wise algorithms for user kernels on row-major tensors, run on the dispatch pool in the
+// manner of the std parallel algorithms. The callable sees elements, not blocks or indices, except
+// in Generate.
+
+enum class Execution
+{
+    Serial,       // on the calling thread, in order
+    Parallel,     // blocks on the dispatch pool
+    ParallelSimd, // blocks on the dispatch pool, inner loops vectorized as if no iterations alias
+};
+
+// Loops under ParallelSimd promise the compiler that iterations are independent. With OpenMP SIMD
+// annotations enabled the loops are vectorized even where the cost model would decline, e.g. at -O2.
+#if defined(MATRIX_OPENMP_SIMD)
+#define MATRIX_SIMD_LOOP _Pragma("omp simd")
+#elif defined(__clang__)
+#define MATRIX_SIMD_LOOP _Pragma("clang loop vectorize(assume_safety)")
+#elif defined(__GNUC__)
+#define MATRIX_SIMD_LOOP _Pragma("GCC ivdep")
+#else
+#define MATRIX_SIMD_LOOP
+#endif
+
+// Elements per block. Blocks do not depend on the thread count, which keeps reductions reproducible.
+constexpr size_t AlgorithmGrain = size_t(1) << 14;
+
+// Calls body(start, stop) for each block of [0, size) with blocks of grain, on the dispatch pool
+// unless policy is Serial. Block boundaries are multiples of grain either way.
+template <typename Body>
+auto RunBlocks(Execution policy, size_t size, size_t grain, Body&& body) -> void
+{
+    auto blocks = [&](size_t start, size_t stop)
+    {
+        for (size_t block = start; block < stop; block += grain)
+        {
+            body(block, std::min(block + grain, stop));
+        }
+    };
+
+    if (policy == Execution::Serial)
+    {
+        blocks(0, size);
+    }
+    else
+    {
+        DispatchRange(size, grain, blocks);
+    }
+}
+
+// function(element) for every element, which it may modify through a reference.
+template <Number T, size_t Order, typename Function>
+auto ForEach(Execution policy, Tensor<T, Order>& tensor, Function&& function) -> void
+{
+    RunBlocks(policy, tensor.Size(), AlgorithmGrain, [&](size_t start, size_t stop)
+    {
+        // pointers in locals, a byte store could otherwise alias the closure and force reloads
+        T* data      = tensor.Data() + start;
+        size_t count = stop - start;
+        if (policy == Execution::ParallelSimd)
+        {
+            MATRIX_SIMD_LOOP
+            for (size_t i = 0; i < count; ++i)
+            {
+                function(data[i]);
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                function(data[i]);
+            }
+        }
+    });
+}
+
+// out = function(in) element-wise. out may be in itself.
+template <Number T, Number U, size_t Order, typename Function>
+auto Transform(Execution policy, Tensor<T, Order> const& in, Tensor<U, Order>& out, Function&& function) -> void
+{
+    Expect(in.Shape() == out.Shape(), "error: Transform needs tensors of one shape");
+
+    RunBlocks(policy, in.Size(), AlgorithmGrain, [&](size_t start, size_t stop)
+    {
+        T const* source = in.Data() + start;
+        U* target       = out.Data() + start;
+        size_t count    = stop - start;
+        if (policy == Execution::ParallelSimd)
+        {
+            MATRIX_SIMD_LOOP
+            for (size_t i = 0; i < count; ++i)
+            {
+                target[i] = static_cast<U>(function(source[i]));
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                target[i] = static_cast<U>(function(source[i]));
+            }
+        }
+    });
+}
+
+// out = function(left, right) element-wise.
+template <Number T, Number U, Number V, size_t Order, typename Function>
+auto Transform(Execution policy, Tensor<T, Order> const& left, Tensor<U, Order> const& right, Tensor<V, Order>& out, Function&& function) -> void
+{
+    Expect(left.Shape() == right.Shape() && left.Shape() == out.Shape(), "error: Transform needs tensors of one shape");
+
+    RunBlocks(policy, left.Size(), AlgorithmGrain, [&](size_t start, size_t stop)
+    {
+        T const* first  = left.Data() + start;
+        U const* second = right.Data() + start;
+        V* target       = out.Data() + start;
+        size_t count    = stop - start;
+        if (policy == Execution::ParallelSimd)
+        {
+            MATRIX_SIMD_LOOP
+            for (size_t i = 0; i < count; ++i)
+            {
+                target[i] = static_cast<V>(function(first[i], second[i]));
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                target[i] = static_cast<V>(function(first[i], second[i]));
+            }
+        }
+    });
+}
+
+// init combined with transform(element) of every element. reduce must be associative and
+// commutative, as for std::transform_reduce. Each block is reduced on its own and the blocks are
+// combined in order, so Serial and Parallel give the same result bit for bit. ParallelSimd keeps
+// eight running values per block, which lets it vectorize but regroups floating-point sums.
+template <typename R, Number T, size_t Order, typename Reduce, typename Function>
+auto TransformReduce(Execution policy, Tensor<T, Order> const& tensor, R init, Reduce&& reduce, Function&& transform) -> R
+{
+    constexpr size_t lanes = 8;
+
+    T const* data = tensor.Data();
+    size_t size   = tensor.Size();
+    std::vector<std::optional<R>> partials((size + AlgorithmGrain - 1) / AlgorithmGrain);
+
+    RunBlocks(policy, size, AlgorithmGrain, [&](size_t start, size_t stop)
+    {
+        if (policy == Execution::ParallelSimd && stop - start >= lanes)
+        {
+            std::array<R, lanes> running;
+            for (size_t k = 0; k < lanes; ++k)
+            {
+                running[k] = static_cast<R>(transform(data[start + k]));
+            }
+
+            size_t i = start + lanes;
+            for (; i + lanes <= stop; i += lanes)
+            {
+                MATRIX_SIMD_LOOP
+                for (size_t k = 0; k < lanes; ++k)
+                {
+                    running[k] = reduce(running[k], static_cast<R>(transform(data[i + k])));
+                }
+            }
+            for (; i < stop; ++i)
+            {
+                running[0] = reduce(running[0], static_cast<R>(transform(data[i])));
+            }
+
+            R partial = running[0];
+            for (size_t k = 1; k < lanes; ++k)
+            {
+                partial = reduce(partial, running[k]);
+            }
+            partials[start / AlgorithmGrain] = partial;
+            return;
+        }
+
+        R partial = static_cast<R>(transform(data[start]));
+        for (size_t i = start + 1; i < stop; ++i)
+        {
+            partial = reduce(partial, static_cast<R>(transform(data[i])));
+        }
+        partials[start / AlgorithmGrain] = partial;
+    });
+
+    for (auto const& partial : partials)
+    {
+        init = reduce(init, *partial);
+    }
+    return init;
+}
+
+// tensor(indices...) = function(indices...) for every element, rows split across the pool.
+template <Number T, size_t Order, typename Function>
+auto Generate(Execution policy, Tensor<T, Order>& tensor, Function&& function) -> void
+{
+    auto shape = tensor.Shape();
+    T* data    = tensor.Data();
+
+    if constexpr (Order == 1)
+    {
+        RunBlocks(policy, shape[0], AlgorithmGrain, [&](size_t start, size_t stop)
+        {
+            for (size_t i = start; i < stop; ++i)
+            {
+                data[i] = static_cast<T>(function(i));
+            }
+        });
+    }
+    else
+    {
+        size_t width    = shape[1];
+        size_t row_size = tensor.Size() / std::max<size_t>(shape[0], 1);
+        size_t rows     = std::max<size_t>(AlgorithmGrain / std::max<size_t>(row_size, 1), 1);
+
+        RunBlocks(policy, shape[0], rows, [&](size_t y_start, size_t y_stop)
+        {
+            for (size_t y = y_start; y < y_stop; ++y)
+            {
+                T* row = data + y * row_size;
+                if constexpr (Order == 2)
+                {
+                    if (policy == Execution::ParallelSimd)
+                    {
+                        MATRIX_SIMD_LOOP
+                        for (size_t x = 0; x < width; ++x)
+                        {
+                            row[x] = static_cast<T>(function(y, x));
+                        }
+                    }
+                    else
+                    {
+                        for (size_t x = 0; x < width; ++x)
+                        {
+                            row[x] = static_cast<T>(function(y, x));
+                        }
+                    }
+                }
+                else
+                {
+                    for (size_t x = 0; x < width; ++x)
+                    {
+                        for (size_t z = 0; z < shape[2]; ++z)
+                        {
+                            row[x * shape[2] + z] = static_cast<T>(function(y, x, z));
+                        }
+                    }
+                }
+            }
+        });
+    }
+}
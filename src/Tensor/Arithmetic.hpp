@@ -2,8 +2,35 @@
 
 #include <Number.hpp>
 #include <Tensor.hpp>
+#include <Tuning.hpp>
 
+#include <concepts>
 #include <functional>
+#include <string>
+
+// Kernel name an operation is tuned under, see TunedDispatch2d.
+template <typename Operation>
+auto OperationName(const char* operands) -> std::string
+{
+    std::string name = "elementwise";
+    if constexpr (std::same_as<Operation, std::plus<>>)
+    {
+        name = "add";
+    }
+    else if constexpr (std::same_as<Operation, std::minus<>>)
+    {
+        name = "subtract";
+    }
+    else if constexpr (std::same_as<Operation, std::multiplies<>>)
+    {
+        name = "multiply";
+    }
+    else if constexpr (std::same_as<Operation, std::divides<>>)
+    {
+        name = "divide";
+    }
+    return name + "_" + operands;
+}
 
 template <typename Operation, Number T1, Number T2, size_t N>
 auto ElementwiseBinaryOperation(Tensor<T1, N> const& left, Tensor<T2, N> const& right)
@@ -28,9 +55,9 @@ auto ElementwiseBinaryOperation(Tensor<T1, 2> const& left, Tensor<T2, 2> const&
 {
     Expect(left.Shape() == right.Shape());
     using ResultType = std::common_type_t<T1, T2>;
-    Tensor<ResultType, 2> result(left.Shape(), 0);
+    Tensor<ResultType, 2> result(left.Shape());
     Operation operation;
-    Dispatch2d(left.Shape()[0], left.Shape()[1], [&](size_t y, size_t x)
+    TunedDispatch2d<ResultType>(OperationName<Operation>("tensor"), left.Shape()[0], left.Shape()[1], [&](size_t y, size_t x)
     {
         result(y, x) = operation(left(y, x), right(y, x));
     });
@@ -43,7 +70,7 @@ auto ElementwiseScalarOperation(Tensor<T1, 2> const& left, T2 right)
     using ResultType = std::common_type_t<T1, T2>;
     Tensor<ResultType, 2> result(left.Shape());
     Operation operation;
-    Dispatch2d(left.Shape()[0], left.Shape()[1], [&](size_t y, size_t x)
+    TunedDispatch2d<ResultType>(OperationName<Operation>("scalar"), left.Shape()[0], left.Shape()[1], [&](size_t y, size_t x)
     {
         result(y, x) = operation(left(y, x), right);
     });
@@ -54,9 +81,9 @@ template <typename Operation, Number T1, Number T2>
 auto ElementwiseScalarOperation(T1 left, Tensor<T2, 2> const& right)
 {
     using ResultType = std::common_type_t<T1, T2>;
-    Tensor<ResultType, 2> result(left.Shape());
+    Tensor<ResultType, 2> result(right.Shape());
     Operation operation;
-    Dispatch2d(left.Shape()[0], left.Shape()[1], [&](size_t y, size_t x)
+    TunedDispatch2d<ResultType>(OperationName<Operation>("scalar"), right.Shape()[0], right.Shape()[1], [&](size_t y, size_t x)
     {
         result(y, x) = operation(left, right(y, x));
     });
@@ -90,47 +117,47 @@ auto operator/(Tensor<T1, N> const& left, Tensor<T2, N> const& right)
 template <Number T1, Number T2, size_t N>
 auto operator+(Tensor<T1, N> const& left, T2 right)
 {
-    return ScalarBroadcastOperation<std::plus<>, T1, T2>(left, right);
+    return ElementwiseScalarOperation<std::plus<>, T1, T2>(left, right);
 }
 
 template <Number T1, Number T2, size_t N>
 auto operator+(T1 left, Tensor<T2, N> const& right)
 {
-    return ScalarBroadcastOperation<std::plus<>, T1, T2>(left, right);
+    return ElementwiseScalarOperation<std::plus<>, T1, T2>(left, right);
 }
 
 template <Number T1, Number T2, size_t N>
 auto operator-(Tensor<T1, N> const& left, T2 right)
 {
-    return ScalarBroadcastOperation<std::minus<>, T1, T2>(left, right);
+    return ElementwiseScalarOperation<std::minus<>, T1, T2>(left, right);
 }
 
 template <Number T1, Number T2, size_t N>
 auto operator-(T1 left, Tensor<T2, N> const& right)
 {
-    return ScalarBroadcastOperation<std::minus<>, T1, T2>(left, right);
+    return ElementwiseScalarOperation<std::minus<>, T1, T2>(left, right);
 }
 
 template <Number T1, Number T2, size_t N>
 auto operator*(Tensor<T1, N> const& left, T2 right)
 {
-    return ScalarBroadcastOperation<std::multiplies<>, T1, T2>(left, right);
+    return ElementwiseScalarOperation<std::multiplies<>, T1, T2>(left, right);
 }
 
 template <Number T1, Number T2, size_t N>
 auto operator*(T1 left, Tensor<T2, N> const& right)
 {
-    return ScalarBroadcastOperation<std::multiplies<>, T1, T2>(left, right);
+    return ElementwiseScalarOperation<std::multiplies<>, T1, T2>(left, right);
 }
 
 template <Number T1, Number T2, size_t N>
 auto operator/(Tensor<T1, N> const& left, T2 right)
 {
-    return ScalarBroadcastOperation<std::divides<>, T1, T2>(left, right);
+    return ElementwiseScalarOperation<std::divides<>, T1, T2>(left, right);
 }
 
 template <Number T1, Number T2, size_t N>
 auto operator/(T1 left, Tensor<T2, N> const& right)
 {
-    return ScalarBroadcastOperation<std::divides<>, T1, T2>(left, right);
+    return ElementwiseScalarOperation<std::divides<>, T1, T2>(left, right);
 }
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <Dispatcher.hpp>
+#include <ThreadPool.hpp>
+#include <Trace.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+// Completion of a set of tasks running on the dispatch pool. Wait() blocks until all of them have
+// finished and rethrows the first exception one of them threw. A handle that is destroyed without
+// being waited on waits in its destructor, so the tasks never outlive the data they reference.
+class [[nodiscard]] DispatchHandle
+{
+private:
+
+    struct State
+    {
+        std::mutex mutex;
+        std::condition_variable cv;
+        size_t remaining = 0;
+        std::exception_ptr error;
+    };
+
+    std::shared_ptr<State> state_;
+
+    // Waits for the tasks without rethrowing, their error is dropped with the state.
+    auto Drain() -> void
+    {
+        if (state_)
+        {
+            std::unique_lock<std::mutex> lock(state_->mutex);
+            state_->cv.wait(lock, [this]
+            {
+                return state_->remaining == 0;
+            });
+        }
+    }
+
+public:
+
+    DispatchHandle() = default;
+
+    explicit DispatchHandle(size_t tasks)
+    {
+        if (tasks > 0)
+        {
+            state_            = std::make_shared<State>();
+            state_->remaining = tasks;
+        }
+    }
+
+    DispatchHandle(DispatchHandle&&) noexcept = default;
+
+    // Replacing a pending handle waits for its tasks first, as destroying it would.
+    DispatchHandle& operator=(DispatchHandle&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Drain();
+            state_ = std::move(other.state_);
+        }
+        return *this;
+    }
+
+    ~DispatchHandle()
+    {
+        Drain();
+    }
+
+    auto Ready() const -> bool
+    {
+        if (!state_)
+        {
+            return true;
+        }
+        std::unique_lock<std::mutex> lock(state_->mutex);
+        return state_->remaining == 0;
+    }
+
+    auto Wait() -> void
+    {
+        if (!state_)
+        {
+            return;
+        }
+
+        std::exception_ptr error;
+        {
+            std::unique_lock<std::mutex> lock(state_->mutex);
+            state_->cv.wait(lock, [this]
+            {
+                return state_->remaining == 0;
+            });
+            error = state_->error;
+        }
+        state_.reset();
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // Completion callback for one task, safe to copy into each task.
+    auto Completer() const
+    {
+        return [state = state_](std::exception_ptr error)
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            if (error && !state->error)
+            {
+                state->error = error;
+            }
+            if (--state->remaining == 0)
+            {
+                state->cv.notify_all();
+            }
+        };
+    }
+};
+
+// Non-blocking DispatchBlocks. The callable is moved into the tasks, anything it references must stay
+// alive until the handle is waited on. Called from a worker it runs inline and returns a ready handle.
+template <typename Callable>
+auto DispatchBlocksAsync(size_t height, size_t width, size_t block_height, size_t block_width, Callable&& callable) -> DispatchHandle
+{
+    block_height = std::max<size_t>(block_height, 1);
+    block_width  = std::max<size_t>(block_width, 1);
+
+    size_t num_blocks_y = (height + block_height - 1) / block_height;
+    size_t num_blocks_x = (width + block_width - 1) / block_width;
+
+    if (ThreadPool::IsWorkerThread())
+    {
+        DispatchBlocks(height, width, block_height, block_width, callable);
+        return DispatchHandle();
+    }
+
+    DispatchHandle handle(num_blocks_y * num_blocks_x);
+    auto complete = handle.Completer();
+    auto shared   = std::make_shared<std::decay_t<Callable>>(std::forward<Callable>(callable));
+
+    ThreadPool& thread_pool = DispatchThreadPool();
+    const char* region      = Tracer::CurrentRegion();
+
+    for (size_t block_y = 0; block_y < num_blocks_y; ++block_y)
+    {
+        for (size_t block_x = 0; block_x < num_blocks_x; ++block_x)
+        {
+            uint64_t enqueued = TracingEnabled ? Tracer::Now() : 0;
+
+            thread_pool.EnqueueOnGroup(thread_pool.GroupFor(block_y, num_blocks_y), [=]()
+            {
+                uint64_t started = TracingEnabled ? Tracer::Now() : 0;
+
+                size_t y_start = block_y * block_height;
+                size_t y_stop  = std::min(y_start + block_height, height);
+
+                size_t x_start = block_x * block_width;
+                size_t x_stop  = std::min(x_start + block_width, width);
+
+                std::exception_ptr error;
+                try
+                {
+                    (*shared)(y_start, y_stop, x_start, x_stop);
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+
+                if constexpr (TracingEnabled)
+                {
+                    TraceTile(region, enqueued, started, block_y, block_x);
+                }
+
+                complete(error);
+            });
+        }
+    }
+
+    return handle;
+}
+
+template <typename Callable>
+auto Dispatch2dAsync(size_t height, size_t width, Callable&& callable) -> DispatchHandle
+{
+    return DispatchBlocksAsync(height, width, 256, 256, [callable = std::forward<Callable>(callable)](size_t y_start, size_t y_stop, size_t x_start, size_t x_stop) mutable
+    {
+        for (size_t y = y_start; y < y_stop; ++y)
+        {
+            for (size_t x = x_start; x < x_stop; ++x)
+            {
+                callable(y, x);
+            }
+        }
+    });
+}
+
+// Non-blocking DispatchRange, one row of blocks.
+template <typename Callable>
+auto DispatchRangeAsync(size_t size, size_t block_size, Callable&& callable) -> DispatchHandle
+{
+    return DispatchBlocksAsync(1, size, 1, block_size, [callable = std::forward<Callable>(callable)](size_t, size_t, size_t start, size_t stop) mutable
+    {
+        callable(start, stop);
+    });
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <Dispatcher.hpp>
+#include <Half.hpp>
+#include <Tensor.hpp>
+
+#include <algorithm>
+#include <concepts>
+
+template <typename T>
+concept HalfFloat = std::same_as<T, Float16> || std::same_as<T, BFloat16>;
+
+inline constexpr size_t ConversionBlockSize = 1 << 16;
+
+// Element type conversion, e.g. TensorCast<Float16>(intensity) to store a float field at half the size.
+// Half <-> float goes through the bulk converters, everything else is a plain static_cast.
+template <Number To, Number From, size_t N>
+auto TensorCast(Tensor<From, N> const& tensor) -> Tensor<To, N>
+{
+    Tensor<To, N> result(tensor.Shape());
+    DispatchRange(tensor.Size(), ConversionBlockSize, [&](size_t start, size_t stop)
+    {
+        From const* input = tensor.Data() + start;
+        To* output        = result.Data() + start;
+
+        if constexpr (HalfFloat<From> && std::same_as<To, float>)
+        {
+            ConvertToFloat(input, output, stop - start);
+        }
+        else if constexpr (std::same_as<From, float> && HalfFloat<To>)
+        {
+            ConvertFromFloat(input, output, stop - start);
+        }
+        else
+        {
+            std::transform(input, input + (stop - start), output, [](From value)
+            {
+                return static_cast<To>(value);
+            });
+        }
+    });
+    return result;
+}
@@ -2,40 +2,344 @@
 
 #include <Number.hpp>
 #include <ThreadPool.hpp>
+#include <Trace.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <latch>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Options of the shared pool from the environment: MATRIX_NUM_THREADS caps the worker count,
+// MATRIX_AFFINITY pins the workers (compact, scatter, none, or a CPU list such as 0-7,16-23).
+inline auto ThreadPoolOptionsFromEnvironment() -> ThreadPoolOptions
+{
+    ThreadPoolOptions options;
+    if (const char* threads = std::getenv("MATRIX_NUM_THREADS"))
+    {
+        options.threads = std::min<size_t>(std::strtoul(threads, nullptr, 10), AllowedCpus().size());
+    }
+    if (const char* affinity = std::getenv("MATRIX_AFFINITY"))
+    {
+        options.affinity = ParseAffinity(affinity, options.cpus).value_or(AffinityPolicy::None);
+    }
+    return options;
+}
+
+struct DispatchPoolSettings
+{
+    std::mutex mutex;
+    ThreadPoolOptions options = ThreadPoolOptionsFromEnvironment();
+    bool started              = false;
+
+    static auto Instance() -> DispatchPoolSettings&
+    {
+        static DispatchPoolSettings settings;
+        return settings;
+    }
+};
+
+// Shared pool behind every dispatch so repeated calls do not respawn threads, and so nested calls
+// never start a second set of workers.
+inline auto DispatchThreadPool() -> ThreadPool&
+{
+    static ThreadPool thread_pool([]
+    {
+        auto& settings = DispatchPoolSettings::Instance();
+        std::unique_lock<std::mutex> lock(settings.mutex);
+        settings.started = true;
+        return settings.options;
+    }());
+    return thread_pool;
+}
+
+// Replaces the environment's options for the shared pool. The pool is built by the first dispatch,
+// after which this returns false and changes nothing.
+inline auto ConfigureDispatchThreadPool(ThreadPoolOptions options) -> bool
+{
+    auto& settings = DispatchPoolSettings::Instance();
+    std::unique_lock<std::mutex> lock(settings.mutex);
+    if (settings.started)
+    {
+        return false;
+    }
+    settings.options = std::move(options);
+    return true;
+}
+
+// What a dispatch called from a worker of the shared pool does. Blocking that worker on tasks queued
+// behind it could deadlock, so it either runs the whole range itself or helps run the queue.
+enum class NestedDispatch
+{
+    Inline, // the calling worker runs the whole range as one block
+    Join,   // the blocks are queued on the shared pool and the calling worker runs tasks until they finish
+};
+
+// Inline unless MATRIX_NESTED=join.
+inline auto NestedDispatchPolicy() -> std::atomic<NestedDispatch>&
+{
+    static std::atomic<NestedDispatch> policy = []
+    {
+        const char* nested = std::getenv("MATRIX_NESTED");
+        return nested && std::string(nested) == "join" ? NestedDispatch::Join : NestedDispatch::Inline;
+    }();
+    return policy;
+}
+
+inline auto SetNestedDispatch(NestedDispatch policy) -> void
+{
+    NestedDispatchPolicy() = policy;
+}
+
+// True when a dispatch from the calling thread runs inline: it is a worker, and either the policy is
+// Inline or its pool is not the shared one.
+inline auto DispatchRunsInline() -> bool
+{
+    return ThreadPool::IsWorkerThread() && !(NestedDispatchPolicy() == NestedDispatch::Join && DispatchThreadPool().IsOwnWorker());
+}
+
+// Waits for a dispatch's blocks. A worker of the pool runs queued tasks meanwhile, its own blocks
+// among them, so a joined nested dispatch always makes progress.
+inline auto AwaitBlocks(ThreadPool& thread_pool, std::latch& done) -> void
+{
+    if (!thread_pool.IsOwnWorker())
+    {
+        done.wait();
+        return;
+    }
+    while (!done.try_wait())
+    {
+        if (!thread_pool.TryRunTask())
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// Records a tile that just finished on the calling worker, only called when tracing is compiled in.
+inline auto TraceTile(const char* region, uint64_t enqueued, uint64_t started, size_t tile_y, size_t tile_x) -> void
+{
+    Tracer::Instance().Record({
+        region,
+        enqueued,
+        started,
+        Tracer::Now(),
+        static_cast<uint32_t>(ThreadPool::WorkerIndex()),
+        static_cast<uint32_t>(tile_y),
+        static_cast<uint32_t>(tile_x),
+        ThreadPool::RunningStolenTask(),
+    });
+}
+
+// Records the whole dispatch on the calling thread, only called when tracing is compiled in.
+inline auto TraceDispatch(const char* region, uint64_t dispatched) -> void
+{
+    Tracer::Instance().Record({region, dispatched, dispatched, Tracer::Now()});
+}
+
+// Splits height x width into block_height x block_width blocks and calls
+// callable(y_start, y_stop, x_start, x_stop) once per block on the shared pool.
 template <typename Callable>
-auto Dispatch2d(size_t height, size_t width, Callable&& callable) -> void
+auto DispatchBlocks(size_t height, size_t width, size_t block_height, size_t block_width, Callable&& callable) -> void
 {
-    size_t block_height = 256;
-    size_t block_width  = 256;
+    block_height = std::max<size_t>(block_height, 1);
+    block_width  = std::max<size_t>(block_width, 1);
 
     size_t num_blocks_y = (height + block_height - 1) / block_height;
     size_t num_blocks_x = (width + block_width - 1) / block_width;
 
-    ThreadPool thread_pool;
+    // A nested dispatch from inside a worker runs inline unless it joins the pool, see NestedDispatch.
+    if (DispatchRunsInline())
+    {
+        if (height > 0 && width > 0)
+        {
+            callable(size_t(0), height, size_t(0), width);
+        }
+        return;
+    }
+
+    ThreadPool& thread_pool = DispatchThreadPool();
+    std::latch done(num_blocks_y * num_blocks_x);
+
+    const char* region  = Tracer::CurrentRegion();
+    uint64_t dispatched = TracingEnabled ? Tracer::Now() : 0;
 
     for (size_t block_y = 0; block_y < num_blocks_y; ++block_y)
     {
         for (size_t block_x = 0; block_x < num_blocks_x; ++block_x)
         {
-            thread_pool.Enqueue([=, &callable]()
+            uint64_t enqueued = TracingEnabled ? Tracer::Now() : 0;
+
+            // bands of block rows go to one worker group each, see ThreadPool::GroupFor
+            thread_pool.EnqueueOnGroup(thread_pool.GroupFor(block_y, num_blocks_y), [=, &callable, &done]()
             {
+                uint64_t started = TracingEnabled ? Tracer::Now() : 0;
+
                 size_t y_start = block_y * block_height;
                 size_t y_stop  = std::min(y_start + block_height, height);
 
                 size_t x_start = block_x * block_width;
                 size_t x_stop  = std::min(x_start + block_width, width);
 
-                for (size_t y = y_start; y < y_stop; ++y)
+                callable(y_start, y_stop, x_start, x_stop);
+
+                if constexpr (TracingEnabled)
+                {
+                    TraceTile(region, enqueued, started, block_y, block_x);
+                }
+
+                done.count_down();
+            });
+        }
+    }
+
+    AwaitBlocks(thread_pool, done);
+
+    if constexpr (TracingEnabled)
+    {
+        TraceDispatch(region, dispatched);
+    }
+}
+
+template <typename Callable>
+auto Dispatch2d(size_t height, size_t width, size_t block_height, size_t block_width, Callable&& callable) -> void
+{
+    DispatchBlocks(height, width, block_height, block_width, [&](size_t y_start, size_t y_stop, size_t x_start, size_t x_stop)
+    {
+        for (size_t y = y_start; y < y_stop; ++y)
+        {
+            for (size_t x = x_start; x < x_stop; ++x)
+            {
+                callable(y, x);
+            }
+        }
+    });
+}
+
+template <typename Callable>
+auto Dispatch2d(size_t height, size_t width, Callable&& callable) -> void
+{
+    Dispatch2d(height, width, 256, 256, callable);
+}
+
+// Dispatch2d lined up with tile_size x tile_size storage tiles, see Tiled in Layout.hpp. Blocks are whole
+// tiles, about 256x256 elements, and each block is walked one tile at a time so every tile is finished
+// while it is still in cache.
+template <typename Callable>
+auto DispatchTiles(size_t height, size_t width, size_t tile_size, Callable&& callable) -> void
+{
+    tile_size    = std::max<size_t>(tile_size, 1);
+    size_t block = std::max<size_t>(256 / tile_size, 1) * tile_size;
+
+    DispatchBlocks(height, width, block, block, [&](size_t y_start, size_t y_stop, size_t x_start, size_t x_stop)
+    {
+        for (size_t tile_y = y_start; tile_y < y_stop; tile_y += tile_size)
+        {
+            for (size_t tile_x = x_start; tile_x < x_stop; tile_x += tile_size)
+            {
+                size_t tile_y_stop = std::min(tile_y + tile_size, y_stop);
+                size_t tile_x_stop = std::min(tile_x + tile_size, x_stop);
+
+                for (size_t y = tile_y; y < tile_y_stop; ++y)
                 {
-                    for (size_t x = x_start; x < x_stop; ++x)
+                    for (size_t x = tile_x; x < tile_x_stop; ++x)
                     {
                         callable(y, x);
                     }
                 }
-            });
+            }
+        }
+    });
+}
+
+// Dispatch2d for tensors too large to stay resident, such as Tensor::Mapped ones. Rows run in bands of
+// block rows, top to bottom as Dispatch2d orders its blocks. While a band runs, the next band is
+// prefetched in every listed tensor, and finished bands are released, so only a few bands stay resident.
+template <typename Callable, typename... Tensors>
+auto DispatchStreaming(size_t height, size_t width, Callable&& callable, Tensors const&... tensors) -> void
+{
+    // bands cover whole storage tiles so releasing one never drops rows of the next
+    size_t band = std::max({size_t(256), Tensors::LayoutType::RowGranularity...});
+
+    (tensors.Prefetch(0, band), ...);
+    for (size_t y_start = 0; y_start < height; y_start += band)
+    {
+        size_t y_stop = std::min(y_start + band, height);
+        (tensors.Prefetch(y_stop, y_stop + band), ...);
+
+        Dispatch2d(y_stop - y_start, width, [&](size_t y, size_t x)
+        {
+            callable(y_start + y, x);
+        });
+
+        (tensors.Release(y_start, y_stop), ...);
+    }
+}
+
+// Splits [0, size) into contiguous blocks and calls callable(start, stop) once per block, so
+// kernels can run their own vectorized inner loop over each block.
+template <typename Callable>
+auto DispatchRange(size_t size, size_t block_size, Callable&& callable) -> void
+{
+    block_size = std::max<size_t>(block_size, 1);
+
+    size_t num_blocks = (size + block_size - 1) / block_size;
+
+    if (DispatchRunsInline())
+    {
+        if (size > 0)
+        {
+            callable(size_t(0), size);
         }
+        return;
     }
 
-    thread_pool.Wait();
+    ThreadPool& thread_pool = DispatchThreadPool();
+    std::latch done(num_blocks);
+
+    const char* region  = Tracer::CurrentRegion();
+    uint64_t dispatched = TracingEnabled ? Tracer::Now() : 0;
+
+    for (size_t block = 0; block < num_blocks; ++block)
+    {
+        uint64_t enqueued = TracingEnabled ? Tracer::Now() : 0;
+
+        thread_pool.EnqueueOnGroup(thread_pool.GroupFor(block, num_blocks), [=, &callable, &done]()
+        {
+            uint64_t started = TracingEnabled ? Tracer::Now() : 0;
+
+            size_t start = block * block_size;
+            size_t stop  = std::min(start + block_size, size);
+
+            callable(start, stop);
+
+            if constexpr (TracingEnabled)
+            {
+                TraceTile(region, enqueued, started, 0, block);
+            }
+
+            done.count_down();
+        });
+    }
+
+    AwaitBlocks(thread_pool, done);
+
+    if constexpr (TracingEnabled)
+    {
+        TraceDispatch(region, dispatched);
+    }
+}
+
+template <typename Callable>
+auto Dispatch1d(size_t size, Callable&& callable) -> void
+{
+    DispatchRange(size, 256, [&callable](size_t start, size_t stop)
+    {
+        for (size_t i = start; i < stop; ++i)
+        {
+            callable(i);
+        }
+    });
 }
@@ -0,0 +1,345 @@
+#pragma once
+
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__F16C__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MATRIX_HALF_SSE2
+#endif
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// IEEE binary16 bits from a float, rounding to nearest even. Overflow becomes infinity.
+constexpr auto FloatToHalfBits(float value) -> uint16_t
+{
+    uint32_t bits = std::bit_cast<uint32_t>(value);
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    uint32_t abs  = bits & 0x7fffffffu;
+
+    if (abs >= 0x47800000u)
+    {
+        // NaN stays a quiet NaN, everything at or above 2^16 is out of range
+        return static_cast<uint16_t>(sign | (abs > 0x7f800000u ? 0x7e00u : 0x7c00u));
+    }
+
+    if (abs < 0x38800000u)
+    {
+        // below the smallest normal half, adding 0.5 lines the float ulp up with the half subnormal ulp
+        float shifted = std::bit_cast<float>(abs) + 0.5f;
+        return static_cast<uint16_t>(sign | (std::bit_cast<uint32_t>(shifted) - 0x3f000000u));
+    }
+
+    uint32_t odd = (abs >> 13) & 1u;
+    abs += 0xc8000fffu + odd; // rebias the exponent from 127 to 15 and round half to even
+    return static_cast<uint16_t>(sign | (abs >> 13));
+}
+
+constexpr auto HalfBitsToFloat(uint16_t half) -> float
+{
+    uint32_t sign     = static_cast<uint32_t>(half & 0x8000u) << 16;
+    uint32_t exponent = (half >> 10) & 0x1fu;
+    uint32_t mantissa = half & 0x3ffu;
+
+    if (exponent == 0)
+    {
+        float magnitude = static_cast<float>(mantissa) * 0x1p-24f;
+        return std::bit_cast<float>(sign | std::bit_cast<uint32_t>(magnitude));
+    }
+
+    if (exponent == 0x1f)
+    {
+        return std::bit_cast<float>(sign | 0x7f800000u | (mantissa << 13));
+    }
+
+    return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+// bfloat16 bits from a float, rounding to nearest even. NaN stays NaN.
+constexpr auto FloatToBFloatBits(float value) -> uint16_t
+{
+    uint32_t bits = std::bit_cast<uint32_t>(value);
+
+    if ((bits & 0x7fffffffu) > 0x7f800000u)
+    {
+        return static_cast<uint16_t>((bits >> 16) | 0x40u);
+    }
+
+    return static_cast<uint16_t>((bits + 0x7fffu + ((bits >> 16) & 1u)) >> 16);
+}
+
+constexpr auto BFloatBitsToFloat(uint16_t bfloat) -> float
+{
+    return std::bit_cast<float>(static_cast<uint32_t>(bfloat) << 16);
+}
+
+// Packed 16-bit storage types. They convert implicitly to float for computing and only
+// explicitly from float, so mixed expressions promote to float rather than narrowing.
+class Float16
+{
+private:
+
+    uint16_t bits_;
+
+public:
+
+    Float16() = default;
+
+    explicit constexpr Float16(float value)
+        : bits_(FloatToHalfBits(value))
+    {}
+
+    static constexpr auto FromBits(uint16_t bits) -> Float16
+    {
+        Float16 half;
+        half.bits_ = bits;
+        return half;
+    }
+
+    constexpr auto Bits() const -> uint16_t
+    {
+        return bits_;
+    }
+
+    constexpr operator float() const
+    {
+        return HalfBitsToFloat(bits_);
+    }
+
+    friend constexpr Float16 operator+(Float16 left, Float16 right)
+    {
+        return Float16(float(left) + float(right));
+    }
+
+    friend constexpr Float16 operator-(Float16 left, Float16 right)
+    {
+        return Float16(float(left) - float(right));
+    }
+
+    friend constexpr Float16 operator*(Float16 left, Float16 right)
+    {
+        return Float16(float(left) * float(right));
+    }
+
+    friend constexpr Float16 operator/(Float16 left, Float16 right)
+    {
+        return Float16(float(left) / float(right));
+    }
+};
+
+class BFloat16
+{
+private:
+
+    uint16_t bits_;
+
+public:
+
+    BFloat16() = default;
+
+    explicit constexpr BFloat16(float value)
+        : bits_(FloatToBFloatBits(value))
+    {}
+
+    static constexpr auto FromBits(uint16_t bits) -> BFloat16
+    {
+        BFloat16 bfloat;
+        bfloat.bits_ = bits;
+        return bfloat;
+    }
+
+    constexpr auto Bits() const -> uint16_t
+    {
+        return bits_;
+    }
+
+    constexpr operator float() const
+    {
+        return BFloatBitsToFloat(bits_);
+    }
+
+    friend constexpr BFloat16 operator+(BFloat16 left, BFloat16 right)
+    {
+        return BFloat16(float(left) + float(right));
+    }
+
+    friend constexpr BFloat16 operator-(BFloat16 left, BFloat16 right)
+    {
+        return BFloat16(float(left) - float(right));
+    }
+
+    friend constexpr BFloat16 operator*(BFloat16 left, BFloat16 right)
+    {
+        return BFloat16(float(left) * float(right));
+    }
+
+    friend constexpr BFloat16 operator/(BFloat16 left, BFloat16 right)
+    {
+        return BFloat16(float(left) / float(right));
+    }
+};
+
+static_assert(sizeof(Float16) == 2 && sizeof(BFloat16) == 2);
+
+// Mixing the two 16-bit types, or either with an integer, computes in float.
+template <>
+struct std::common_type<Float16, BFloat16>
+{
+    using type = float;
+};
+
+template <>
+struct std::common_type<BFloat16, Float16>
+{
+    using type = float;
+};
+
+template <std::integral T>
+struct std::common_type<Float16, T>
+{
+    using type = float;
+};
+
+template <std::integral T>
+struct std::common_type<T, Float16>
+{
+    using type = float;
+};
+
+template <std::integral T>
+struct std::common_type<BFloat16, T>
+{
+    using type = float;
+};
+
+template <std::integral T>
+struct std::common_type<T, BFloat16>
+{
+    using type = float;
+};
+
+// ----- bulk conversion, hardware where the target has it (MATRIX_NATIVE on x86) with the scalar routines as tail and fallback -----
+
+inline auto ConvertToFloat(Float16 const* input, float* output, size_t size) -> void
+{
+    auto bits = reinterpret_cast<uint16_t const*>(input);
+
+    size_t i = 0;
+#if defined(__AVX512F__)
+    for (; i + 16 <= size; i += 16)
+    {
+        _mm512_storeu_ps(output + i, _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(bits + i))));
+    }
+#endif
+#if defined(__F16C__)
+    for (; i + 8 <= size; i += 8)
+    {
+        _mm256_storeu_ps(output + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<__m128i const*>(bits + i))));
+    }
+#elif defined(__aarch64__)
+    for (; i + 4 <= size; i += 4)
+    {
+        vst1q_f32(output + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(bits + i))));
+    }
+#endif
+    for (; i < size; ++i)
+    {
+        output[i] = HalfBitsToFloat(bits[i]);
+    }
+}
+
+inline auto ConvertFromFloat(float const* input, Float16* output, size_t size) -> void
+{
+    auto bits = reinterpret_cast<uint16_t*>(output);
+
+    size_t i = 0;
+#if defined(__AVX512F__)
+    for (; i + 16 <= size; i += 16)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(bits + i), _mm512_cvtps_ph(_mm512_loadu_ps(input + i), _MM_FROUND_TO_NEAREST_INT));
+    }
+#endif
+#if defined(__F16C__)
+    for (; i + 8 <= size; i += 8)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(bits + i), _mm256_cvtps_ph(_mm256_loadu_ps(input + i), _MM_FROUND_TO_NEAREST_INT));
+    }
+#elif defined(__aarch64__)
+    for (; i + 4 <= size; i += 4)
+    {
+        vst1_u16(bits + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(input + i))));
+    }
+#endif
+    for (; i < size; ++i)
+    {
+        bits[i] = FloatToHalfBits(input[i]);
+    }
+}
+
+inline auto ConvertToFloat(BFloat16 const* input, float* output, size_t size) -> void
+{
+    auto bits = reinterpret_cast<uint16_t const*>(input);
+
+    size_t i = 0;
+#if defined(MATRIX_HALF_SSE2)
+    __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= size; i += 8)
+    {
+        // widening is a 16-bit shift, interleaving zeros below each value does it
+        __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(bits + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_unpacklo_epi16(zero, v));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i + 4), _mm_unpackhi_epi16(zero, v));
+    }
+#elif defined(__aarch64__)
+    for (; i + 4 <= size; i += 4)
+    {
+        vst1q_f32(output + i, vreinterpretq_f32_u32(vshll_n_u16(vld1_u16(bits + i), 16)));
+    }
+#endif
+    for (; i < size; ++i)
+    {
+        output[i] = BFloatBitsToFloat(bits[i]);
+    }
+}
+
+inline auto ConvertFromFloat(float const* input, BFloat16* output, size_t size) -> void
+{
+    auto bits = reinterpret_cast<uint16_t*>(output);
+
+    size_t i = 0;
+#if defined(MATRIX_HALF_SSE2)
+    __m128i one    = _mm_set1_epi32(1);
+    __m128i bias   = _mm_set1_epi32(0x7fff);
+    __m128i quiet  = _mm_set1_epi32(0x40);
+    auto round_four = [&](float const* values)
+    {
+        __m128 v    = _mm_loadu_ps(values);
+        __m128i x   = _mm_castps_si128(v);
+        __m128i lsb = _mm_and_si128(_mm_srli_epi32(x, 16), one);
+
+        __m128i rounded = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(x, bias), lsb), 16);
+        __m128i nan     = _mm_castps_si128(_mm_cmpunord_ps(v, v));
+        __m128i quieted = _mm_or_si128(_mm_srli_epi32(x, 16), quiet);
+        __m128i result  = _mm_or_si128(_mm_and_si128(nan, quieted), _mm_andnot_si128(nan, rounded));
+
+        // sign-extend from 16 bits so the signed pack keeps the bit pattern
+        return _mm_srai_epi32(_mm_slli_epi32(result, 16), 16);
+    };
+    for (; i + 8 <= size; i += 8)
+    {
+        __m128i packed = _mm_packs_epi32(round_four(input + i), round_four(input + i + 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(bits + i), packed);
+    }
+#endif
+    for (; i < size; ++i)
+    {
+        bits[i] = FloatToBFloatBits(input[i]);
+    }
+}
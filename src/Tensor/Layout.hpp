@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <functional>
+#include <numeric>
+
+// Storage layouts, selected by Tensor's third template parameter. A layout maps a shape to the
+// number of stored elements and an index tuple to a storage offset.
+
+// Plain row-major storage, the last index varies fastest.
+struct RowMajor
+{
+    // Rows [y, y + n) are one contiguous storage range whenever y and n are multiples of this.
+    static constexpr size_t RowGranularity = 1;
+
+    template <size_t Order>
+    static auto StoredRows(std::array<size_t, Order> const& shape) -> size_t
+    {
+        return shape[0];
+    }
+
+    template <size_t Order>
+    static auto StorageSize(std::array<size_t, Order> const& shape) -> size_t
+    {
+        return std::accumulate(shape.begin(), shape.end(), size_t(1), std::multiplies<size_t>());
+    }
+
+    static inline auto Index(std::array<size_t, 1> const&, size_t i) -> size_t
+    {
+        return i;
+    }
+
+    static inline auto Index(std::array<size_t, 2> const& shape, size_t y, size_t x) -> size_t
+    {
+        auto [_, width] = shape;
+        return y * width + x;
+    }
+
+    static inline auto Index(std::array<size_t, 3> const& shape, size_t z, size_t y, size_t x) -> size_t
+    {
+        auto [_, height, width] = shape;
+        return z * (height * width) + y * width + x;
+    }
+};
+
+// A grid of TileSize x TileSize tiles over the first two dimensions, tiles in row-major order and
+// row-major inside each tile, so a vertical neighbour is usually in the same few cache lines. A third
+// dimension such as colour channels stays innermost. Edge tiles are padded, which makes the storage
+// larger than Size() unless both extents are multiples of TileSize.
+template <size_t TileSize>
+    requires(std::has_single_bit(TileSize))
+struct Tiled
+{
+    static constexpr size_t Tile  = TileSize;
+    static constexpr size_t Shift = std::countr_zero(TileSize);
+    static constexpr size_t Mask  = TileSize - 1;
+
+    static constexpr size_t RowGranularity = TileSize;
+
+    static inline auto TileCount(size_t extent) -> size_t
+    {
+        return (extent + Mask) >> Shift;
+    }
+
+    template <size_t Order>
+    static auto StoredRows(std::array<size_t, Order> const& shape) -> size_t
+    {
+        return TileCount(shape[0]) << Shift;
+    }
+
+    template <size_t Order>
+        requires(Order == 2 || Order == 3)
+    static auto StorageSize(std::array<size_t, Order> const& shape) -> size_t
+    {
+        size_t size = (TileCount(shape[0]) << Shift) * (TileCount(shape[1]) << Shift);
+        return Order == 3 ? size * shape[Order - 1] : size;
+    }
+
+    static inline auto Index(std::array<size_t, 2> const& shape, size_t y, size_t x) -> size_t
+    {
+        size_t tile = (y >> Shift) * TileCount(shape[1]) + (x >> Shift);
+        return (tile << (2 * Shift)) + ((y & Mask) << Shift) + (x & Mask);
+    }
+
+    static inline auto Index(std::array<size_t, 3> const& shape, size_t y, size_t x, size_t c) -> size_t
+    {
+        return Index({shape[0], shape[1]}, y, x) * shape[2] + c;
+    }
+};
+
+template <typename L, size_t Order>
+concept TensorLayout = requires(std::array<size_t, Order> shape) {
+    { L::StorageSize(shape) } -> std::convertible_to<size_t>;
+};
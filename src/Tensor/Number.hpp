@@ -1,5 +1,7 @@
 #pragma once
 
+#include <Half.hpp>
+
 #include <cstdint>
 #include <concepts>
 
@@ -21,7 +23,9 @@ concept Integer = Signed<T> || Unsigned<T>;
 template <typename T>
 concept Real = std::same_as<T, float>
             || std::same_as<T, double>
-			|| std::same_as<T, long double>;
+			|| std::same_as<T, long double>
+            || std::same_as<T, Float16>
+            || std::same_as<T, BFloat16>;
 
 template <typename T>
 concept Number = Integer<T> || Real<T>;
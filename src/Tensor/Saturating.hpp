@@ -0,0 +1,368 @@
+#pragma once
+
+#include <Dispatcher.hpp>
+#include <Expect.hpp>
+#include <Tensor.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MATRIX_SATURATING_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MATRIX_SATURATING_NEON
+#endif
+
+// Image arithmetic that stays in the narrow element type instead of promoting through
+// std::common_type, clamping to [0, max] rather than wrapping.
+template <typename T>
+concept SaturatingUnsigned = std::same_as<T, uint8_t> || std::same_as<T, uint16_t>;
+
+// Fixed-point factors are Q8 for uint8_t (256 == 1.0) and Q15 for uint16_t (32768 == 1.0).
+template <SaturatingUnsigned T>
+inline constexpr uint32_t FixedPointShift = std::same_as<T, uint8_t> ? 8 : 15;
+
+template <SaturatingUnsigned T>
+inline constexpr uint32_t FixedPointOne = 1u << FixedPointShift<T>;
+
+template <SaturatingUnsigned T>
+auto ToFixedPoint(double value) -> uint32_t
+{
+    Expect(value >= 0.0, "fixed-point factor must be non-negative");
+    // a factor of the type's maximum already saturates every non-zero element
+    double scaled = std::round(std::min(value, static_cast<double>(std::numeric_limits<T>::max())) * FixedPointOne<T>);
+    return static_cast<uint32_t>(scaled);
+}
+
+template <SaturatingUnsigned T>
+constexpr auto SaturateCast(uint32_t value) -> T
+{
+    return static_cast<T>(std::min<uint32_t>(value, std::numeric_limits<T>::max()));
+}
+
+// ----- span kernels, vector body plus scalar tail -----
+
+inline auto AddSaturate(uint8_t const* left, uint8_t const* right, uint8_t* result, size_t size) -> void
+{
+    size_t i = 0;
+#if defined(MATRIX_SATURATING_SSE2)
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i const*>(left + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<__m128i const*>(right + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(result + i), _mm_adds_epu8(a, b));
+    }
+#elif defined(MATRIX_SATURATING_NEON)
+    for (; i + 16 <= size; i += 16)
+    {
+        vst1q_u8(result + i, vqaddq_u8(vld1q_u8(left + i), vld1q_u8(right + i)));
+    }
+#endif
+    for (; i < size; ++i)
+    {
+        result[i] = SaturateCast<uint8_t>(uint32_t(left[i]) + right[i]);
+    }
+}
+
+inline auto AddSaturate(uint16_t const* left, uint16_t const* right, uint16_t* result, size_t size) -> void
+{
+    size_t i = 0;
+#if defined(MATRIX_SATURATING_SSE2)
+    for (; i + 8 <= size; i += 8)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i const*>(left + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<__m128i const*>(right + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(result + i), _mm_adds_epu16(a, b));
+    }
+#elif defined(MATRIX_SATURATING_NEON)
+    for (; i + 8 <= size; i += 8)
+    {
+        vst1q_u16(result + i, vqaddq_u16(vld1q_u16(left + i), vld1q_u16(right + i)));
+    }
+#endif
+    for (; i < size; ++i)
+    {
+        result[i] = SaturateCast<uint16_t>(uint32_t(left[i]) + right[i]);
+    }
+}
+
+inline auto SubtractSaturate(uint8_t const* left, uint8_t const* right, uint8_t* result, size_t size) -> void
+{
+    size_t i = 0;
+#if defined(MATRIX_SATURATING_SSE2)
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i const*>(left + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<__m128i const*>(right + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(result + i), _mm_subs_epu8(a, b));
+    }
+#elif defined(MATRIX_SATURATING_NEON)
+    for (; i + 16 <= size; i += 16)
+    {
+        vst1q_u8(result + i, vqsubq_u8(vld1q_u8(left + i), vld1q_u8(right + i)));
+    }
+#endif
+    for (; i < size; ++i)
+    {
+        result[i] = left[i] > right[i] ? left[i] - right[i] : 0;
+    }
+}
+
+inline auto SubtractSaturate(uint16_t const* left, uint16_t const* right, uint16_t* result, size_t size) -> void
+{
+    size_t i = 0;
+#if defined(MATRIX_SATURATING_SSE2)
+    for (; i + 8 <= size; i += 8)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i const*>(left + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<__m128i const*>(right + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(result + i), _mm_subs_epu16(a, b));
+    }
+#elif defined(MATRIX_SATURATING_NEON)
+    for (; i + 8 <= size; i += 8)
+    {
+        vst1q_u16(result + i, vqsubq_u16(vld1q_u16(left + i), vld1q_u16(right + i)));
+    }
+#endif
+    for (; i < size; ++i)
+    {
+        result[i] = left[i] > right[i] ? left[i] - right[i] : 0;
+    }
+}
+
+inline auto MultiplySaturate(uint8_t const* left, uint8_t const* right, uint8_t* result, size_t size) -> void
+{
+    size_t i = 0;
+#if defined(MATRIX_SATURATING_SSE2)
+    __m128i zero = _mm_setzero_si128();
+    __m128i max  = _mm_set1_epi16(0xff);
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i const*>(left + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<__m128i const*>(right + i));
+
+        // 8x8 -> 16 bit products are exact, anything with a high byte saturates to 255
+        __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+        __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+        __m128i lo_fits = _mm_cmpeq_epi16(_mm_srli_epi16(lo, 8), zero);
+        __m128i hi_fits = _mm_cmpeq_epi16(_mm_srli_epi16(hi, 8), zero);
+        lo              = _mm_or_si128(_mm_and_si128(lo_fits, lo), _mm_andnot_si128(lo_fits, max));
+        hi              = _mm_or_si128(_mm_and_si128(hi_fits, hi), _mm_andnot_si128(hi_fits, max));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(result + i), _mm_packus_epi16(lo, hi));
+    }
+#elif defined(MATRIX_SATURATING_NEON)
+    for (; i + 8 <= size; i += 8)
+    {
+        vst1_u8(result + i, vqmovn_u16(vmull_u8(vld1_u8(left + i), vld1_u8(right + i))));
+    }
+#endif
+    for (; i < size; ++i)
+    {
+        result[i] = SaturateCast<uint8_t>(uint32_t(left[i]) * right[i]);
+    }
+}
+
+inline auto MultiplySaturate(uint16_t const* left, uint16_t const* right, uint16_t* result, size_t size) -> void
+{
+    size_t i = 0;
+#if defined(MATRIX_SATURATING_SSE2)
+    __m128i zero = _mm_setzero_si128();
+    __m128i ones = _mm_set1_epi16(-1);
+    for (; i + 8 <= size; i += 8)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i const*>(left + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<__m128i const*>(right + i));
+
+        __m128i lo       = _mm_mullo_epi16(a, b);
+        __m128i overflow = _mm_xor_si128(_mm_cmpeq_epi16(_mm_mulhi_epu16(a, b), zero), ones);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(result + i), _mm_or_si128(lo, overflow));
+    }
+#elif defined(MATRIX_SATURATING_NEON)
+    for (; i + 4 <= size; i += 4)
+    {
+        vst1_u16(result + i, vqmovn_u32(vmull_u16(vld1_u16(left + i), vld1_u16(right + i))));
+    }
+#endif
+    for (; i < size; ++i)
+    {
+        result[i] = SaturateCast<uint16_t>(uint32_t(left[i]) * right[i]);
+    }
+}
+
+// result = round(value * scale / 256) for a Q8 scale below 256.0.
+inline auto ScaleFixed(uint8_t const* values, uint32_t scale, uint8_t* result, size_t size) -> void
+{
+    scale = std::min<uint32_t>(scale, std::numeric_limits<uint16_t>::max());
+
+    size_t i = 0;
+#if defined(MATRIX_SATURATING_SSE2)
+    __m128i zero   = _mm_setzero_si128();
+    __m128i factor = _mm_set1_epi16(static_cast<int16_t>(scale));
+    __m128i half   = _mm_set1_epi32(1 << 7);
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(values + i));
+
+        __m128i packed[2];
+        for (int part = 0; part < 2; ++part)
+        {
+            __m128i x = part == 0 ? _mm_unpacklo_epi8(v, zero) : _mm_unpackhi_epi8(v, zero);
+
+            // full 32-bit products from the low and high halves of the 16x16 multiply
+            __m128i lo = _mm_mullo_epi16(x, factor);
+            __m128i hi = _mm_mulhi_epu16(x, factor);
+            __m128i p0 = _mm_srli_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), half), 8);
+            __m128i p1 = _mm_srli_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), half), 8);
+
+            packed[part] = _mm_packs_epi32(p0, p1);
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(result + i), _mm_packus_epi16(packed[0], packed[1]));
+    }
+#endif
+    for (; i < size; ++i)
+    {
+        result[i] = SaturateCast<uint8_t>((values[i] * scale + (1u << 7)) >> 8);
+    }
+}
+
+// result = round(value * scale / 32768) for a Q15 scale, the product taken in 64 bits so factors
+// of 2.0 and above keep their integer part.
+inline auto ScaleFixed(uint16_t const* values, uint32_t scale, uint16_t* result, size_t size) -> void
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        uint64_t product = (uint64_t{values[i]} * scale + (1u << 14)) >> 15;
+        result[i]        = static_cast<uint16_t>(std::min<uint64_t>(product, std::numeric_limits<uint16_t>::max()));
+    }
+}
+
+// result = round((alpha * left + (256 - alpha) * right) / 256) for a Q8 alpha in [0, 256].
+inline auto BlendFixed(uint8_t const* left, uint8_t const* right, uint32_t alpha, uint8_t* result, size_t size) -> void
+{
+    alpha = std::min(alpha, FixedPointOne<uint8_t>);
+
+    size_t i = 0;
+#if defined(MATRIX_SATURATING_SSE2)
+    __m128i zero         = _mm_setzero_si128();
+    __m128i weight_left  = _mm_set1_epi16(static_cast<int16_t>(alpha));
+    __m128i weight_right = _mm_set1_epi16(static_cast<int16_t>(FixedPointOne<uint8_t> - alpha));
+    __m128i half         = _mm_set1_epi16(1 << 7);
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i const*>(left + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<__m128i const*>(right + i));
+
+        // the weights sum to 256, so each blended sum is at most 255 * 256 and fits in 16 bits
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), weight_left), _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), weight_right));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), weight_left), _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), weight_right));
+
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, half), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, half), 8);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(result + i), _mm_packus_epi16(lo, hi));
+    }
+#elif defined(MATRIX_SATURATING_NEON)
+    uint8x8_t weight_left  = vdup_n_u8(static_cast<uint8_t>(std::min<uint32_t>(alpha, 255)));
+    uint8x8_t weight_right = vdup_n_u8(static_cast<uint8_t>(std::min<uint32_t>(FixedPointOne<uint8_t> - alpha, 255)));
+    if (alpha != 0 && alpha != FixedPointOne<uint8_t>)
+    {
+        for (; i + 8 <= size; i += 8)
+        {
+            uint16x8_t sum = vmlal_u8(vmull_u8(vld1_u8(left + i), weight_left), vld1_u8(right + i), weight_right);
+            vst1_u8(result + i, vrshrn_n_u16(sum, 8));
+        }
+    }
+#endif
+    for (; i < size; ++i)
+    {
+        result[i] = SaturateCast<uint8_t>((left[i] * alpha + right[i] * (FixedPointOne<uint8_t> - alpha) + (1u << 7)) >> 8);
+    }
+}
+
+// result = round((alpha * left + (32768 - alpha) * right) / 32768) for a Q15 alpha in [0, 32768].
+inline auto BlendFixed(uint16_t const* left, uint16_t const* right, uint32_t alpha, uint16_t* result, size_t size) -> void
+{
+    alpha = std::min(alpha, FixedPointOne<uint16_t>);
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        result[i] = SaturateCast<uint16_t>((left[i] * alpha + right[i] * (FixedPointOne<uint16_t> - alpha) + (1u << 14)) >> 15);
+    }
+}
+
+// ----- tensor operations -----
+
+// Elements per dispatched block, large enough to amortize scheduling over a vector loop.
+inline constexpr size_t SaturatingBlockSize = 1 << 16;
+
+template <SaturatingUnsigned T, size_t N>
+auto AddSaturate(Tensor<T, N> const& left, Tensor<T, N> const& right) -> Tensor<T, N>
+{
+    Expect(left.Shape() == right.Shape());
+    Tensor<T, N> result(left.Shape());
+    DispatchRange(left.Size(), SaturatingBlockSize, [&](size_t start, size_t stop)
+    {
+        AddSaturate(left.Data() + start, right.Data() + start, result.Data() + start, stop - start);
+    });
+    return result;
+}
+
+template <SaturatingUnsigned T, size_t N>
+auto SubtractSaturate(Tensor<T, N> const& left, Tensor<T, N> const& right) -> Tensor<T, N>
+{
+    Expect(left.Shape() == right.Shape());
+    Tensor<T, N> result(left.Shape());
+    DispatchRange(left.Size(), SaturatingBlockSize, [&](size_t start, size_t stop)
+    {
+        SubtractSaturate(left.Data() + start, right.Data() + start, result.Data() + start, stop - start);
+    });
+    return result;
+}
+
+template <SaturatingUnsigned T, size_t N>
+auto MultiplySaturate(Tensor<T, N> const& left, Tensor<T, N> const& right) -> Tensor<T, N>
+{
+    Expect(left.Shape() == right.Shape());
+    Tensor<T, N> result(left.Shape());
+    DispatchRange(left.Size(), SaturatingBlockSize, [&](size_t start, size_t stop)
+    {
+        MultiplySaturate(left.Data() + start, right.Data() + start, result.Data() + start, stop - start);
+    });
+    return result;
+}
+
+// Multiplies every element by a non-negative factor in fixed point, clamping at the type's maximum.
+template <SaturatingUnsigned T, size_t N>
+auto Scale(Tensor<T, N> const& tensor, double factor) -> Tensor<T, N>
+{
+    uint32_t scale = ToFixedPoint<T>(factor);
+    Tensor<T, N> result(tensor.Shape());
+    DispatchRange(tensor.Size(), SaturatingBlockSize, [&](size_t start, size_t stop)
+    {
+        ScaleFixed(tensor.Data() + start, scale, result.Data() + start, stop - start);
+    });
+    return result;
+}
+
+// alpha * left + (1 - alpha) * right with alpha in [0, 1], quantized to Q8 or Q15.
+template <SaturatingUnsigned T, size_t N>
+auto Blend(Tensor<T, N> const& left, Tensor<T, N> const& right, double alpha) -> Tensor<T, N>
+{
+    Expect(left.Shape() == right.Shape());
+    uint32_t weight = ToFixedPoint<T>(std::clamp(alpha, 0.0, 1.0));
+    Tensor<T, N> result(left.Shape());
+    DispatchRange(left.Size(), SaturatingBlockSize, [&](size_t start, size_t stop)
+    {
+        BlendFixed(left.Data() + start, right.Data() + start, weight, result.Data() + start, stop - start);
+    });
+    return result;
+}
@@ -0,0 +1,238 @@
+#pragma once
+
+#include <Number.hpp>
+#include <Tensor.hpp>
+#include <TensorInitializer.hpp>
+
+#include <array>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+// Shape known at compile time, e.g. Extents<3, 3> for a colour matrix or Extents<5> for a kernel.
+template <size_t... E>
+struct Extents
+{
+    static constexpr size_t Order = sizeof...(E);
+    static constexpr size_t Size  = (E * ...);
+
+    static constexpr std::array<size_t, Order> Shape = {E...};
+};
+
+template <Number T, typename E>
+class StaticTensor;
+
+// Fixed-shape tensor with its elements stored inside the object, so building one per pixel costs no
+// allocation. Everything is constexpr and elementwise arithmetic unrolls over the whole extent, which
+// is meant for small shapes; large fields belong in Tensor.
+template <Number T, size_t... E>
+    requires ValidOrder<sizeof...(E)> && ((E > 0) && ...)
+class StaticTensor<T, Extents<E...>>
+{
+public:
+
+    using Extent = Extents<E...>;
+
+    static constexpr size_t Order = Extent::Order;
+
+private:
+
+    std::array<T, Extent::Size> data_{};
+
+public:
+
+    constexpr StaticTensor() = default;
+
+    explicit constexpr StaticTensor(T initializer)
+    {
+        data_.fill(initializer);
+    }
+
+    constexpr StaticTensor(TensorInitializer<T, Order> const& initializer)
+    {
+        StaticInitializerFlatten<T, E...>(initializer, data_.data());
+    }
+
+    static constexpr auto Shape()
+    {
+        return Extent::Shape;
+    }
+
+    static constexpr auto Size()
+    {
+        return Extent::Size;
+    }
+
+    constexpr auto Data()
+    {
+        return data_.data();
+    }
+
+    constexpr auto Data() const
+    {
+        return data_.data();
+    }
+
+    template <typename... Indices>
+        requires ValidIndices<Order, Indices...>
+    constexpr auto& operator()(Indices... indices)
+    {
+        return data_[LinearIndex(indices...)];
+    }
+
+    template <typename... Indices>
+        requires ValidIndices<Order, Indices...>
+    constexpr auto operator()(Indices... indices) const
+    {
+        return data_[LinearIndex(indices...)];
+    }
+
+    // Heap-backed copy for handing to code that works on Tensor.
+    auto ToTensor() const -> Tensor<T, Order>
+    {
+        Tensor<T, Order> tensor(Extent::Shape);
+        std::copy(data_.begin(), data_.end(), tensor.Data());
+        return tensor;
+    }
+
+    friend constexpr bool operator==(StaticTensor const& left, StaticTensor const& right)
+    {
+        return left.data_ == right.data_;
+    }
+
+private:
+
+    template <typename... Indices>
+    static constexpr auto LinearIndex(Indices... indices) -> size_t
+    {
+        std::array<size_t, Order> index = {static_cast<size_t>(indices)...};
+
+        size_t linear = 0;
+        for (size_t d = 0; d < Order; ++d)
+        {
+            linear = linear * Extent::Shape[d] + index[d];
+        }
+        return linear;
+    }
+};
+
+// Calls callable(std::integral_constant<size_t, I>) for every I below Size as one unrolled expression.
+template <size_t Size, typename Callable>
+constexpr void StaticFor(Callable&& callable)
+{
+    [&]<size_t... I>(std::index_sequence<I...>)
+    {
+        (callable(std::integral_constant<size_t, I>{}), ...);
+    }(std::make_index_sequence<Size>{});
+}
+
+template <typename Operation, Number T1, Number T2, typename E>
+constexpr auto ElementwiseBinaryOperation(StaticTensor<T1, E> const& left, StaticTensor<T2, E> const& right)
+{
+    using ResultType = std::common_type_t<T1, T2>;
+    StaticTensor<ResultType, E> result;
+    Operation operation;
+    StaticFor<E::Size>([&](size_t i)
+    {
+        result.Data()[i] = operation(left.Data()[i], right.Data()[i]);
+    });
+    return result;
+}
+
+template <typename Operation, Number T1, Number T2, typename E>
+constexpr auto ElementwiseScalarOperation(StaticTensor<T1, E> const& left, T2 right)
+{
+    using ResultType = std::common_type_t<T1, T2>;
+    StaticTensor<ResultType, E> result;
+    Operation operation;
+    StaticFor<E::Size>([&](size_t i)
+    {
+        result.Data()[i] = operation(left.Data()[i], right);
+    });
+    return result;
+}
+
+template <typename Operation, Number T1, Number T2, typename E>
+constexpr auto ElementwiseScalarOperation(T1 left, StaticTensor<T2, E> const& right)
+{
+    using ResultType = std::common_type_t<T1, T2>;
+    StaticTensor<ResultType, E> result;
+    Operation operation;
+    StaticFor<E::Size>([&](size_t i)
+    {
+        result.Data()[i] = operation(left, right.Data()[i]);
+    });
+    return result;
+}
+
+template <Number T1, Number T2, typename E>
+constexpr auto operator+(StaticTensor<T1, E> const& left, StaticTensor<T2, E> const& right)
+{
+    return ElementwiseBinaryOperation<std::plus<>, T1, T2>(left, right);
+}
+
+template <Number T1, Number T2, typename E>
+constexpr auto operator-(StaticTensor<T1, E> const& left, StaticTensor<T2, E> const& right)
+{
+    return ElementwiseBinaryOperation<std::minus<>, T1, T2>(left, right);
+}
+
+template <Number T1, Number T2, typename E>
+constexpr auto operator*(StaticTensor<T1, E> const& left, StaticTensor<T2, E> const& right)
+{
+    return ElementwiseBinaryOperation<std::multiplies<>, T1, T2>(left, right);
+}
+
+template <Number T1, Number T2, typename E>
+constexpr auto operator/(StaticTensor<T1, E> const& left, StaticTensor<T2, E> const& right)
+{
+    return ElementwiseBinaryOperation<std::divides<>, T1, T2>(left, right);
+}
+
+template <Number T1, Number T2, typename E>
+constexpr auto operator+(StaticTensor<T1, E> const& left, T2 right)
+{
+    return ElementwiseScalarOperation<std::plus<>, T1, T2>(left, right);
+}
+
+template <Number T1, Number T2, typename E>
+constexpr auto operator+(T1 left, StaticTensor<T2, E> const& right)
+{
+    return ElementwiseScalarOperation<std::plus<>, T1, T2>(left, right);
+}
+
+template <Number T1, Number T2, typename E>
+constexpr auto operator-(StaticTensor<T1, E> const& left, T2 right)
+{
+    return ElementwiseScalarOperation<std::minus<>, T1, T2>(left, right);
+}
+
+template <Number T1, Number T2, typename E>
+constexpr auto operator-(T1 left, StaticTensor<T2, E> const& right)
+{
+    return ElementwiseScalarOperation<std::minus<>, T1, T2>(left, right);
+}
+
+template <Number T1, Number T2, typename E>
+constexpr auto operator*(StaticTensor<T1, E> const& left, T2 right)
+{
+    return ElementwiseScalarOperation<std::multiplies<>, T1, T2>(left, right);
+}
+
+template <Number T1, Number T2, typename E>
+constexpr auto operator*(T1 left, StaticTensor<T2, E> const& right)
+{
+    return ElementwiseScalarOperation<std::multiplies<>, T1, T2>(left, right);
+}
+
+template <Number T1, Number T2, typename E>
+constexpr auto operator/(StaticTensor<T1, E> const& left, T2 right)
+{
+    return ElementwiseScalarOperation<std::divides<>, T1, T2>(left, right);
+}
+
+template <Number T1, Number T2, typename E>
+constexpr auto operator/(T1 left, StaticTensor<T2, E> const& right)
+{
+    return ElementwiseScalarOperation<std::divides<>, T1, T2>(left, right);
+}
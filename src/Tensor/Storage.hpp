@@ -0,0 +1,155 @@
+#pragma once
+
+#include <Expect.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MATRIX_MAPPED_STORAGE
+#endif
+
+enum class MapMode
+{
+    Create, // create or truncate the file to the tensor's size, zero filled
+    Open,   // map an existing file read-write, its size must match the tensor
+};
+
+enum class Access
+{
+    Normal,
+    Sequential, // aggressive read-ahead, pages behind the cursor can be dropped early
+    Random,     // no read-ahead
+};
+
+// Deleter behind Tensor's storage. Heap storage is freed with delete[], file mappings are unmapped,
+// which leaves every written page in the file.
+template <typename T>
+struct StorageDeleter
+{
+    size_t mapped_bytes = 0; // non-zero when the storage is a file mapping
+
+    void operator()(T* data) const
+    {
+        if (mapped_bytes == 0)
+        {
+            delete[] data;
+            return;
+        }
+#if defined(MATRIX_MAPPED_STORAGE)
+        munmap(data, mapped_bytes);
+#endif
+    }
+};
+
+inline auto PageSize() -> size_t
+{
+#if defined(MATRIX_MAPPED_STORAGE)
+    static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return page_size;
+#else
+    return 4096;
+#endif
+}
+
+// Maps bytes of filename read-write and shared, so stores go to the file through the page cache.
+inline auto MapFile(std::string const& filename, size_t bytes, MapMode mode) -> void*
+{
+#if defined(MATRIX_MAPPED_STORAGE)
+    int flags = mode == MapMode::Create ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR;
+    int file  = open(filename.c_str(), flags, 0644);
+    Expect(file >= 0, "error: unable to open " + filename + " for mapping");
+
+    struct stat status;
+    bool sized = fstat(file, &status) == 0;
+    if (mode == MapMode::Create)
+    {
+        sized = sized && ftruncate(file, static_cast<off_t>(bytes)) == 0;
+    }
+    else
+    {
+        sized = sized && static_cast<size_t>(status.st_size) == bytes;
+    }
+    if (!sized)
+    {
+        close(file);
+        Expect(false, "error: " + filename + " does not have the size of the mapped tensor");
+    }
+
+    void* data = bytes > 0 ? mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0) : nullptr;
+    close(file); // the mapping keeps its own reference to the file
+    Expect(data != MAP_FAILED, "error: unable to map " + filename);
+    return data;
+#else
+    (void)filename;
+    (void)bytes;
+    (void)mode;
+    Expect(false, "error: memory-mapped tensors need a POSIX system");
+    return nullptr;
+#endif
+}
+
+// madvise hints over the pages covering [data, data + bytes). Hints are advisory, failures are ignored.
+enum class PageHint
+{
+    WillNeed, // start reading the pages in now
+    Release,  // schedule writeback and drop the pages from this process, the file keeps their contents
+};
+
+inline auto AdvisePages(void const* data, size_t bytes, PageHint hint) -> void
+{
+#if defined(MATRIX_MAPPED_STORAGE)
+    if (bytes == 0)
+    {
+        return;
+    }
+
+    // madvise and msync want page-aligned ranges, widen to whole pages
+    auto address = reinterpret_cast<uintptr_t>(data);
+    auto start   = address & ~(PageSize() - 1);
+    auto length  = address + bytes - start;
+    auto pages   = reinterpret_cast<void*>(start);
+
+    if (hint == PageHint::WillNeed)
+    {
+        madvise(pages, length, MADV_WILLNEED);
+    }
+    else
+    {
+        msync(pages, length, MS_ASYNC);
+        madvise(pages, length, MADV_DONTNEED);
+    }
+#else
+    (void)data;
+    (void)bytes;
+    (void)hint;
+#endif
+}
+
+inline auto AdviseAccess(void const* data, size_t bytes, Access access) -> void
+{
+#if defined(MATRIX_MAPPED_STORAGE)
+    int advice = access == Access::Sequential ? MADV_SEQUENTIAL : access == Access::Random ? MADV_RANDOM : MADV_NORMAL;
+    madvise(const_cast<void*>(data), bytes, advice);
+#else
+    (void)data;
+    (void)bytes;
+    (void)access;
+#endif
+}
+
+// Blocks until every dirty page in the mapping is written to the file.
+inline auto FlushPages(void const* data, size_t bytes) -> void
+{
+#if defined(MATRIX_MAPPED_STORAGE)
+    Expect(bytes == 0 || msync(const_cast<void*>(data), bytes, MS_SYNC) == 0, "error: unable to flush mapped tensor");
+#else
+    (void)data;
+    (void)bytes;
+#endif
+}
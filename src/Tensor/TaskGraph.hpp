@@ -0,0 +1,189 @@
+#pragma once
+
+#include <Async.hpp>
+#include <Dispatcher.hpp>
+#include <Expect.hpp>
+#include <ThreadPool.hpp>
+#include <Trace.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Row-major grid of tile x tile blocks over height x width, the unit per-tile stages are declared on.
+struct TileGrid
+{
+    size_t height = 0;
+    size_t width  = 0;
+    size_t tile   = 256;
+
+    struct Bounds
+    {
+        size_t y_start;
+        size_t y_stop;
+        size_t x_start;
+        size_t x_stop;
+    };
+
+    auto Rows() const -> size_t
+    {
+        return (height + tile - 1) / tile;
+    }
+
+    auto Columns() const -> size_t
+    {
+        return (width + tile - 1) / tile;
+    }
+
+    auto Count() const -> size_t
+    {
+        return Rows() * Columns();
+    }
+
+    auto Index(size_t row, size_t column) const -> size_t
+    {
+        return row * Columns() + column;
+    }
+
+    auto TileBounds(size_t index) const -> Bounds
+    {
+        size_t y_start = (index / Columns()) * tile;
+        size_t x_start = (index % Columns()) * tile;
+        return {y_start, std::min(y_start + tile, height), x_start, std::min(x_start + tile, width)};
+    }
+};
+
+// A DAG of tasks run on the dispatch pool. Each task starts as soon as the tasks it depends on have
+// finished, so a stage can begin on one tile while an earlier stage is still busy with others.
+// Dependencies can only name tasks added before, which keeps the graph acyclic by construction.
+class TaskGraph
+{
+public:
+
+    using TaskId = size_t;
+
+private:
+
+    struct Node
+    {
+        const char* name;
+        std::function<void()> task;
+        std::vector<TaskId> successors;
+        size_t dependencies = 0;
+    };
+
+    std::vector<Node> nodes_;
+
+    // Per-run counters, kept apart from the nodes so a graph can be launched again after it finished.
+    struct RunState
+    {
+        std::unique_ptr<std::atomic<size_t>[]> waiting;
+        std::atomic<bool> failed = false;
+    };
+
+public:
+
+    auto Add(const char* name, std::function<void()> task, std::vector<TaskId> const& dependencies = {}) -> TaskId
+    {
+        TaskId id = nodes_.size();
+        for (TaskId dependency : dependencies)
+        {
+            Expect(dependency < id, "error: a task can only depend on tasks added before it");
+            nodes_[dependency].successors.push_back(id);
+        }
+        nodes_.push_back({name, std::move(task), {}, dependencies.size()});
+        return id;
+    }
+
+    auto Size() const -> size_t
+    {
+        return nodes_.size();
+    }
+
+    // Starts every task without waiting. The graph and whatever its tasks reference must outlive the
+    // handle. After one task throws, the remaining tasks are skipped and Wait() rethrows.
+    auto Launch() -> DispatchHandle
+    {
+        // blocking a worker on tasks queued behind it could deadlock, so nested graphs run inline in
+        // insertion order, which is a topological order
+        if (ThreadPool::IsWorkerThread())
+        {
+            for (auto& node : nodes_)
+            {
+                node.task();
+            }
+            return DispatchHandle();
+        }
+
+        DispatchHandle handle(nodes_.size());
+
+        auto run     = std::make_shared<RunState>();
+        run->waiting = std::make_unique<std::atomic<size_t>[]>(nodes_.size());
+        for (size_t i = 0; i < nodes_.size(); ++i)
+        {
+            run->waiting[i] = nodes_[i].dependencies;
+        }
+
+        auto complete = handle.Completer();
+        for (TaskId id = 0; id < nodes_.size(); ++id)
+        {
+            if (nodes_[id].dependencies == 0)
+            {
+                Schedule(id, run, complete);
+            }
+        }
+
+        return handle;
+    }
+
+    auto Run() -> void
+    {
+        Launch().Wait();
+    }
+
+private:
+
+    template <typename Complete>
+    auto Schedule(TaskId id, std::shared_ptr<RunState> const& run, Complete const& complete) -> void
+    {
+        uint64_t enqueued = TracingEnabled ? Tracer::Now() : 0;
+
+        DispatchThreadPool().Enqueue([this, id, run, complete, enqueued]()
+        {
+            uint64_t started = TracingEnabled ? Tracer::Now() : 0;
+
+            std::exception_ptr error;
+            if (!run->failed)
+            {
+                try
+                {
+                    nodes_[id].task();
+                }
+                catch (...)
+                {
+                    error       = std::current_exception();
+                    run->failed = true;
+                }
+            }
+
+            if constexpr (TracingEnabled)
+            {
+                TraceTile(nodes_[id].name, enqueued, started, TraceEvent::NoTile, TraceEvent::NoTile);
+            }
+
+            // release successors before reporting, the handle may be waited on as soon as the count hits zero
+            for (TaskId successor : nodes_[id].successors)
+            {
+                if (--run->waiting[successor] == 0)
+                {
+                    Schedule(successor, run, complete);
+                }
+            }
+
+            complete(error);
+        });
+    }
+};
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Dispatcher.hpp"
+#include "Layout.hpp"
+#include "Storage.hpp"
 #include "TensorInitializer.hpp"
 
 #include <Expect.hpp>
@@ -10,7 +12,9 @@
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <span>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
 template <size_t N>
@@ -19,15 +23,23 @@ concept ValidOrder = (N == 1 || N == 2 || N == 3);
 template <size_t Order, typename... Indices>
 concept ValidIndices = (sizeof...(Indices) == Order && (std::is_convertible_v<Indices, size_t> && ...));
 
-template <Number T, size_t Order>
-    requires ValidOrder<Order>
+template <Number T, size_t Order, typename Layout = RowMajor>
+    requires ValidOrder<Order> && TensorLayout<Layout, Order>
 class Tensor
 {
+public:
+
+    using LayoutType = Layout;
+
+    static constexpr bool IsRowMajor = std::is_same_v<Layout, RowMajor>;
+
 private:
 
+    using Storage = std::unique_ptr<T[], StorageDeleter<T>>;
+
     std::array<size_t, Order> shape_;
     size_t size_;
-    std::unique_ptr<T[]> data_;
+    Storage data_;
 
 public:
 
@@ -36,25 +48,37 @@ public:
     Tensor(std::array<size_t, Order> const& shape)
         : shape_(shape)
         , size_(Size(shape_))
-        , data_(new T[size_])
+        , data_(new T[StorageSize()])
     {}
 
     Tensor(std::array<size_t, Order> const& shape, T initializer)
         : Tensor(shape)
     {
-        std::fill(data_.get(), data_.get() + size_, initializer);
+        std::fill(data_.get(), data_.get() + StorageSize(), initializer);
     }
 
     Tensor(TensorInitializer<T, Order> const& initializer)
+        requires IsRowMajor
         : shape_(InitializerShape<T, Order>(initializer))
         , size_(Size(shape_))
-        , data_(InitializerFlatten<T, Order>(initializer))
+        , data_(InitializerFlatten<T, Order>(initializer).release())
     {}
 
+    Tensor(TensorInitializer<T, Order> const& initializer)
+        requires(!IsRowMajor)
+        : Tensor(InitializerShape<T, Order>(initializer))
+    {
+        auto flat = InitializerFlatten<T, Order>(initializer);
+        for (size_t i = 0; i < size_; ++i)
+        {
+            data_[StorageIndex(i)] = flat[i];
+        }
+    }
+
     Tensor(Tensor const& other)
         : Tensor(other.shape_)
     {
-        std::copy(other.data_.get(), other.data_.get() + size_, data_.get());
+        std::copy(other.data_.get(), other.data_.get() + StorageSize(), data_.get());
     }
 
     Tensor(Tensor&& other) noexcept
@@ -74,8 +98,8 @@ public:
 
         shape_ = other.shape_;
         size_  = other.size_;
-        data_.reset(new T[size_]);
-        std::copy(other.data_.get(), other.data_.get() + size_, data_.get());
+        data_ = Storage(new T[StorageSize()]);
+        std::copy(other.data_.get(), other.data_.get() + StorageSize(), data_.get());
 
         return *this;
     }
@@ -98,6 +122,48 @@ public:
 
     ~Tensor() = default;
 
+    // Tensor whose storage is the file itself through a shared memory mapping, so it can be far larger
+    // than RAM. Kernels and encoders see an ordinary tensor. Copies are heap tensors, moves keep the mapping.
+    static auto Mapped(std::string const& filename, std::array<size_t, Order> const& shape, MapMode mode = MapMode::Create) -> Tensor
+    {
+        size_t bytes = Layout::StorageSize(shape) * sizeof(T);
+        return Tensor(shape, Storage(static_cast<T*>(MapFile(filename, bytes, mode)), StorageDeleter<T>{bytes}));
+    }
+
+    auto IsMapped() const
+    {
+        return data_.get_deleter().mapped_bytes != 0;
+    }
+
+    // Writes every modified page back to the file, a no-op for heap storage.
+    auto Flush() const -> void
+    {
+        if (IsMapped())
+        {
+            FlushPages(data_.get(), data_.get_deleter().mapped_bytes);
+        }
+    }
+
+    auto Advise(Access access) const -> void
+    {
+        if (IsMapped())
+        {
+            AdviseAccess(data_.get(), data_.get_deleter().mapped_bytes, access);
+        }
+    }
+
+    // Starts paging in the storage behind rows [y_start, y_stop), rounded out to whole pages.
+    auto Prefetch(size_t y_start, size_t y_stop) const -> void
+    {
+        AdviseRows(y_start, y_stop, PageHint::WillNeed);
+    }
+
+    // Schedules writeback of rows [y_start, y_stop) and lets the kernel drop their pages.
+    auto Release(size_t y_start, size_t y_stop) const -> void
+    {
+        AdviseRows(y_start, y_stop, PageHint::Release);
+    }
+
     auto Shape() const
     {
         return shape_;
@@ -108,11 +174,68 @@ public:
         return size_;
     }
 
+    // Elements held in memory, larger than Size() when the layout pads.
+    auto StorageSize() const
+    {
+        return Layout::StorageSize(shape_);
+    }
+
     auto Data() const
     {
         return data_.get();
     }
 
+    // Contiguous iterators over the elements in row-major order, for std algorithms and ranges.
+    auto begin()
+        requires IsRowMajor
+    {
+        return data_.get();
+    }
+
+    auto end()
+        requires IsRowMajor
+    {
+        return data_.get() + size_;
+    }
+
+    auto begin() const
+        requires IsRowMajor
+    {
+        return static_cast<T const*>(data_.get());
+    }
+
+    auto end() const
+        requires IsRowMajor
+    {
+        return static_cast<T const*>(data_.get() + size_);
+    }
+
+    // Row y of a matrix, or every channel of pixel row y of a {height, width, channels} image.
+    auto Row(size_t y)
+        requires IsRowMajor && (Order >= 2)
+    {
+        return std::span<T>(data_.get() + y * RowSize(), RowSize());
+    }
+
+    auto Row(size_t y) const
+        requires IsRowMajor && (Order >= 2)
+    {
+        return std::span<T const>(data_.get() + y * RowSize(), RowSize());
+    }
+
+    // Plane p of a planar {planes, height, width} tensor, such as one channel from ToPlanar.
+    auto Plane(size_t p)
+        requires IsRowMajor && (Order == 3)
+    {
+        return std::span<T>(data_.get() + p * RowSize(), RowSize());
+    }
+
+    auto Plane(size_t p) const
+        requires IsRowMajor && (Order == 3)
+    {
+        return std::span<T const>(data_.get() + p * RowSize(), RowSize());
+    }
+
     template <typename... Indices>
         requires ValidIndices<Order, Indices...>
     inline auto& operator()(Indices... indices)
@@ -129,26 +252,74 @@ public:
 
 private:
 
-    static auto Size(std::array<size_t, Order> const& shape)
+    Tensor(std::array<size_t, Order> const& shape, Storage data)
+        : shape_(shape)
+        , size_(Size(shape_))
+        , data_(std::move(data))
+    {}
+
+    auto AdviseRows(size_t y_start, size_t y_stop, PageHint hint) const -> void
     {
-        return std::accumulate(shape.begin(), shape.end(), 1ull, std::multiplies<size_t>());
+        if (!IsMapped())
+        {
+            return;
+        }
+
+        // rows only form one contiguous range at the layout's granularity, e.g. whole tile rows
+        size_t granularity = Layout::RowGranularity;
+        size_t rows        = Layout::StoredRows(shape_);
+        size_t row_size    = rows > 0 ? StorageSize() / rows : 0;
+
+        y_start = y_start / granularity * granularity;
+        y_stop  = std::min((y_stop + granularity - 1) / granularity * granularity, rows);
+        if (y_start >= y_stop)
+        {
+            return;
+        }
+
+        AdvisePages(data_.get() + y_start * row_size, (y_stop - y_start) * row_size * sizeof(T), hint);
+    }
+
+    // Elements under one value of the leading index.
+    auto RowSize() const -> size_t
+    {
+        if constexpr (Order == 3)
+        {
+            return shape_[1] * shape_[2];
+        }
+        else
+        {
+            return shape_[Order - 1];
+        }
     }
 
-    inline auto LinearIndex(size_t i) const
+    static auto Size(std::array<size_t, Order> const& shape)
     {
-        return i;
+        return std::accumulate(shape.begin(), shape.end(), 1ull, std::multiplies<size_t>());
     }
 
-    inline auto LinearIndex(size_t y, size_t x) const
+    template <typename... Indices>
+    inline auto LinearIndex(Indices... indices) const
     {
-        auto [_, width] = shape_;
-        return y * width + x;
+        return Layout::Index(shape_, static_cast<size_t>(indices)...);
     }
 
-    inline auto LinearIndex(size_t z, size_t y, size_t x) const
+    // Storage offset of the i-th element in row-major order.
+    inline auto StorageIndex(size_t i) const
     {
-        auto [_, height, width] = shape_;
-        return z * (height * width) + y * width + x;
+        if constexpr (IsRowMajor)
+        {
+            return i;
+        }
+        else if constexpr (Order == 2)
+        {
+            return LinearIndex(i / shape_[1], i % shape_[1]);
+        }
+        else
+        {
+            size_t pixel = i / shape_[2];
+            return LinearIndex(pixel / shape_[1], pixel % shape_[1], i % shape_[2]);
+        }
     }
 
     friend bool operator==(Tensor const& left, Tensor const& right)
@@ -156,7 +327,8 @@ private:
         // Expect(DimensionsEqual(left, right));
         for (size_t i = 0; i < left.size_; ++i)
         {
-            if (left.data_[i] != right.data_[i])
+            // padding in non-row-major layouts is never compared
+            if (left.data_[left.StorageIndex(i)] != right.data_[right.StorageIndex(i)])
             {
                 return false;
             }
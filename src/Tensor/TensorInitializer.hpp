@@ -12,6 +12,7 @@
 #include <initializer_list>
 #include <memory>
 #include <numeric>
+#include <stdexcept>
 #include <type_traits>
 #include <vector>
 
@@ -99,3 +100,26 @@ auto InitializerFlatten(TensorInitializer<T, Order> const& initializer) -> std::
     std::copy(tmp.begin(), tmp.end(), data.get());
     return data;
 }
+
+// Compile-time counterpart of InitializerFlatten for fixed extents, writes into caller storage and
+// throws (a compile error in a constant expression) when the nesting does not match the extents.
+template <typename T, size_t First, size_t... Rest>
+constexpr auto StaticInitializerFlatten(TensorInitializer<T, 1 + sizeof...(Rest)> const& initializer, T* output) -> T*
+{
+    if (initializer.size() != First)
+    {
+        throw std::runtime_error("error: initializer does not match the static extents");
+    }
+    for (auto const& element : initializer)
+    {
+        if constexpr (sizeof...(Rest) == 0)
+        {
+            *output++ = element;
+        }
+        else
+        {
+            output = StaticInitializerFlatten<T, Rest...>(element, output);
+        }
+    }
+    return output;
+}
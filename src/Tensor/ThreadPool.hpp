@@ -1,32 +1,122 @@
 #pragma once
 
+#include <Topology.hpp>
+
 #include <algorithm>
+#include <atomic>
 #include <condition_variable>
 #include <functional>
+#include <future>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <queue>
 #include <thread>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+struct ThreadPoolOptions
+{
+    size_t threads          = 0; // 0 for one per allowed CPU
+    AffinityPolicy affinity = AffinityPolicy::None;
+    std::vector<size_t> cpus;    // placement under AffinityPolicy::Explicit
+
+    std::optional<CpuTopology> topology; // read from sysfs when empty
+};
+
+// Workers pinned to CPUs are grouped by NUMA node, each group with its own queue. A worker takes
+// tasks from its own group's queue first and steals from the others when it runs dry, so work
+// queued for a node runs there while the machine stays busy. Unpinned workers form one group.
 class ThreadPool
 {
 private:
 
     std::vector<std::thread> threads_;
-    std::queue<std::function<void()>> tasks_;
+    std::vector<std::queue<std::function<void()>>> queues_; // one per worker group
+    std::vector<size_t> worker_groups_;
+    std::vector<size_t> worker_cpus_;
     std::mutex queue_mutex_;
     std::condition_variable cv_;
-    bool stop_ = false;
+    size_t pending_ = 0;
+    bool stop_      = false;
+    std::atomic<size_t> next_group_{0};
+    std::atomic<size_t> steals_{0};
+
+    static inline thread_local ThreadPool const* current_ = nullptr;
+    static inline thread_local size_t worker_index_       = 0;
+    static inline thread_local bool running_stolen_       = false;
+
+    // Takes the next task for a worker of group, called with queue_mutex_ held and pending_ > 0.
+    auto PopLocked(size_t group) -> std::function<void()>
+    {
+        for (size_t i = 0; i < queues_.size(); ++i)
+        {
+            auto& queue = queues_[(group + i) % queues_.size()];
+            if (!queue.empty())
+            {
+                auto task = std::move(queue.front());
+                queue.pop();
+                --pending_;
+                if (i > 0)
+                {
+                    steals_.fetch_add(1, std::memory_order_relaxed);
+                }
+                running_stolen_ = i > 0;
+                return task;
+            }
+        }
+        return {};
+    }
+
+    auto Push(size_t group, std::function<void()> task) -> void
+    {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queues_[group % queues_.size()].push(std::move(task));
+            ++pending_;
+        }
+        cv_.notify_one();
+    }
 
 public:
 
     ThreadPool(size_t thread_count = std::max(std::thread::hardware_concurrency(), 1u))
+        : ThreadPool(ThreadPoolOptions{thread_count, AffinityPolicy::None, {}, std::nullopt})
+    {}
+
+    explicit ThreadPool(ThreadPoolOptions const& options)
     {
+        CpuTopology topology = options.topology ? *options.topology : ReadCpuTopology();
+        size_t thread_count  = options.threads > 0 ? options.threads : std::max<size_t>(topology.CpuCount(), 1);
+
+        // group numbers follow the nodes' first appearance in the placement, so they are dense
+        worker_cpus_ = PlaceWorkers(topology, options.affinity, options.cpus, thread_count);
+        std::vector<std::optional<size_t>> node_groups(topology.nodes.size());
+        size_t groups = 0;
+        for (size_t i = 0; i < thread_count; ++i)
+        {
+            std::optional<size_t> node = worker_cpus_.empty() ? std::nullopt : topology.NodeOf(worker_cpus_[i]);
+            if (node && !node_groups[*node])
+            {
+                node_groups[*node] = groups++;
+            }
+            worker_groups_.push_back(node ? *node_groups[*node] : 0);
+        }
+        queues_.resize(std::max<size_t>(groups, 1));
+
         for (size_t i = 0; i < thread_count; ++i)
         {
-            threads_.emplace_back([this]()
+            threads_.emplace_back([this, i]()
             {
+                current_      = this;
+                worker_index_ = i;
+
+                if (!worker_cpus_.empty())
+                {
+                    PinCurrentThread(worker_cpus_[i]);
+                }
+
                 while (true)
                 {
                     std::function<void()> task;
@@ -35,18 +125,17 @@ public:
                         this->cv_.wait(lock, [this]
                         {
                             // Wake up if there is a task or if we're stopping
-                            return this->stop_ || !this->tasks_.empty();
+                            return this->stop_ || this->pending_ > 0;
                         });
 
                         // If we are stopping and have no tasks, break out of loop
-                        if (this->stop_ && this->tasks_.empty())
+                        if (this->stop_ && this->pending_ == 0)
                         {
                             return;
                         }
 
-                        // Otherwise, pop a task from the queue
-                        task = std::move(this->tasks_.front());
-                        this->tasks_.pop();
+                        // Otherwise, pop a task, from our own group's queue if it has one
+                        task = PopLocked(worker_groups_[i]);
                     }
 
                     // Execute the task outside the lock
@@ -56,14 +145,113 @@ public:
         }
     }
 
+    // Queues round-robin over the worker groups.
     template <typename Function, typename... Arguments>
     void Enqueue(Function&& function, Arguments&&... args)
     {
+        size_t group = queues_.size() > 1 ? next_group_.fetch_add(1, std::memory_order_relaxed) : 0;
+        Push(group, std::bind(std::forward<Function>(function), std::forward<Arguments>(args)...));
+    }
+
+    // Queues for the workers of one group, taken modulo GroupCount().
+    template <typename Function>
+    void EnqueueOnGroup(size_t group, Function&& function)
+    {
+        Push(group, std::forward<Function>(function));
+    }
+
+    // Group for part index of count equal parts of some work, so consecutive parts (rows of a
+    // tensor, say) stay on one node and the pages each node first touched are the ones it reuses.
+    auto GroupFor(size_t index, size_t count) const -> size_t
+    {
+        return count > 0 ? std::min(index, count - 1) * queues_.size() / count : 0;
+    }
+
+    // Runs function on the pool and returns a future for its result or exception.
+    template <typename Function>
+    auto Submit(Function&& function) -> std::future<std::invoke_result_t<Function>>
+    {
+        using Result = std::invoke_result_t<Function>;
+
+        // std::function needs a copyable target, so the move-only packaged_task is shared
+        auto task   = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+        auto result = task->get_future();
+        Enqueue([task]()
+        {
+            (*task)();
+        });
+        return result;
+    }
+
+    // Runs one queued task on the calling thread, false when none was waiting. A worker that waits
+    // on tasks it queued itself helps with this instead of blocking.
+    auto TryRunTask() -> bool
+    {
+        // the task may run inside another one, whose flag must survive it
+        bool outer_stolen = running_stolen_;
+        std::function<void()> task;
         {
             std::unique_lock<std::mutex> lock(queue_mutex_);
-            tasks_.emplace(std::bind(std::forward<Function>(function), std::forward<Arguments>(args)...));
+            if (pending_ == 0)
+            {
+                return false;
+            }
+            task = PopLocked(IsOwnWorker() ? worker_groups_[worker_index_] : 0);
         }
-        cv_.notify_one();
+        task();
+        running_stolen_ = outer_stolen;
+        return true;
+    }
+
+    auto ThreadCount() const -> size_t
+    {
+        return threads_.size();
+    }
+
+    auto GroupCount() const -> size_t
+    {
+        return queues_.size();
+    }
+
+    auto WorkerGroup(size_t worker) const -> size_t
+    {
+        return worker_groups_[worker];
+    }
+
+    // CPU each worker is pinned to, empty when the pool is unpinned.
+    auto WorkerCpus() const -> std::vector<size_t> const&
+    {
+        return worker_cpus_;
+    }
+
+    // Tasks a worker took from another group's queue.
+    auto Steals() const -> size_t
+    {
+        return steals_.load(std::memory_order_relaxed);
+    }
+
+    // True when called from a task running on any pool's worker thread.
+    static bool IsWorkerThread()
+    {
+        return current_ != nullptr;
+    }
+
+    // True when called from a task running on this pool's worker thread.
+    auto IsOwnWorker() const -> bool
+    {
+        return current_ == this;
+    }
+
+    // Index of the calling worker within its pool, only meaningful when IsWorkerThread().
+    static size_t WorkerIndex()
+    {
+        return worker_index_;
+    }
+
+    // True while the calling thread runs a task it took from another group's queue.
+    static bool RunningStolenTask()
+    {
+        return running_stolen_;
     }
 
     void Wait()
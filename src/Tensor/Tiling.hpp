@@ -0,0 +1,200 @@
+#pragma once
+
+#include <Dispatcher.hpp>
+#include <Layout.hpp>
+#include <Number.hpp>
+#include <Tensor.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+
+template <typename T>
+struct TileView
+{
+    T* data = nullptr; // first element of the tile, rows are tile_size * channels elements apart
+
+    size_t tile_size = 0;
+    size_t channels  = 1;
+
+    size_t tile_y  = 0; // position in the tile grid
+    size_t tile_x  = 0;
+    size_t y_start = 0; // position of the top-left element in the tensor
+    size_t x_start = 0;
+    size_t height  = 0; // valid extent, smaller than tile_size along the bottom and right edges
+    size_t width   = 0;
+
+    inline auto& operator()(size_t y, size_t x, size_t c = 0) const
+    {
+        return data[(y * tile_size + x) * channels + c];
+    }
+};
+
+// Walks a tiled tensor one storage tile at a time, in storage order.
+template <Number T, size_t N, size_t TileSize>
+class TileIterator
+{
+private:
+
+    using Layout = Tiled<TileSize>;
+
+    Tensor<T, N, Layout> const* tensor_ = nullptr;
+    size_t tile_                        = 0;
+
+public:
+
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = TileView<T>;
+    using difference_type   = std::ptrdiff_t;
+
+    TileIterator() = default;
+
+    TileIterator(Tensor<T, N, Layout> const& tensor, size_t tile)
+        : tensor_(&tensor)
+        , tile_(tile)
+    {}
+
+    auto operator*() const -> TileView<T>
+    {
+        auto shape        = tensor_->Shape();
+        size_t channels   = N == 3 ? shape[N - 1] : 1;
+        size_t tiles_x    = Layout::TileCount(shape[1]);
+        size_t tile_y     = tile_ / tiles_x;
+        size_t tile_x     = tile_ % tiles_x;
+        size_t y_start    = tile_y * TileSize;
+        size_t x_start    = tile_x * TileSize;
+        size_t tile_elems = TileSize * TileSize * channels;
+
+        return {
+            tensor_->Data() + tile_ * tile_elems,
+            TileSize,
+            channels,
+            tile_y,
+            tile_x,
+            y_start,
+            x_start,
+            std::min(TileSize, shape[0] - y_start),
+            std::min(TileSize, shape[1] - x_start),
+        };
+    }
+
+    auto operator++() -> TileIterator&
+    {
+        ++tile_;
+        return *this;
+    }
+
+    auto operator++(int) -> TileIterator
+    {
+        TileIterator previous = *this;
+        ++tile_;
+        return previous;
+    }
+
+    friend bool operator==(TileIterator const& left, TileIterator const& right)
+    {
+        return left.tile_ == right.tile_;
+    }
+};
+
+template <Number T, size_t N, size_t TileSize>
+class TileRange
+{
+private:
+
+    Tensor<T, N, Tiled<TileSize>> const& tensor_;
+
+public:
+
+    explicit TileRange(Tensor<T, N, Tiled<TileSize>> const& tensor)
+        : tensor_(tensor)
+    {}
+
+    auto size() const -> size_t
+    {
+        auto shape = tensor_.Shape();
+        return Tiled<TileSize>::TileCount(shape[0]) * Tiled<TileSize>::TileCount(shape[1]);
+    }
+
+    auto begin() const
+    {
+        return TileIterator<T, N, TileSize>(tensor_, 0);
+    }
+
+    auto end() const
+    {
+        return TileIterator<T, N, TileSize>(tensor_, size());
+    }
+};
+
+// for (auto tile : Tiles(tensor)) visits each storage tile, see TileView.
+template <Number T, size_t N, size_t TileSize>
+auto Tiles(Tensor<T, N, Tiled<TileSize>> const& tensor) -> TileRange<T, N, TileSize>
+{
+    return TileRange<T, N, TileSize>(tensor);
+}
+
+// Copies between row-major and tiled storage. Each tile row is one contiguous run in both
+// layouts, so the copy is a memcpy per tile row, with one block of tile rows per task.
+template <bool ToTiledLayout, Number T, size_t N, size_t TileSize>
+auto CopyTiles(T const* source, T* destination, std::array<size_t, N> const& shape) -> void
+{
+    using Layout = Tiled<TileSize>;
+
+    size_t height     = shape[0];
+    size_t width      = shape[1];
+    size_t channels   = N == 3 ? shape[N - 1] : 1;
+    size_t tiles_x    = Layout::TileCount(width);
+    size_t tile_elems = TileSize * TileSize * channels;
+
+    DispatchRange(Layout::TileCount(height) * tiles_x, tiles_x, [&](size_t start, size_t stop)
+    {
+        for (size_t tile = start; tile < stop; ++tile)
+        {
+            size_t y_start = (tile / tiles_x) * TileSize;
+            size_t x_start = (tile % tiles_x) * TileSize;
+            size_t rows    = std::min(TileSize, height - y_start);
+            size_t run     = std::min(TileSize, width - x_start) * channels;
+
+            for (size_t row = 0; row < rows; ++row)
+            {
+                size_t row_major = ((y_start + row) * width + x_start) * channels;
+                size_t tiled     = tile * tile_elems + row * TileSize * channels;
+
+                if constexpr (ToTiledLayout)
+                {
+                    std::copy_n(source + row_major, run, destination + tiled);
+                }
+                else
+                {
+                    std::copy_n(source + tiled, run, destination + row_major);
+                }
+            }
+        }
+    });
+}
+
+template <size_t TileSize, Number T, size_t N>
+    requires(N == 2 || N == 3)
+auto ToTiled(Tensor<T, N> const& tensor) -> Tensor<T, N, Tiled<TileSize>>
+{
+    Tensor<T, N, Tiled<TileSize>> result(tensor.Shape());
+    CopyTiles<true, T, N, TileSize>(tensor.Data(), result.Data(), tensor.Shape());
+    return result;
+}
+
+template <Number T, size_t N, size_t TileSize>
+auto ToRowMajor(Tensor<T, N, Tiled<TileSize>> const& tensor) -> Tensor<T, N>
+{
+    Tensor<T, N> result(tensor.Shape());
+    CopyTiles<false, T, N, TileSize>(tensor.Data(), result.Data(), tensor.Shape());
+    return result;
+}
+
+// Dispatch2d over a tiled tensor's shape, one storage tile at a time.
+template <Number T, size_t N, size_t TileSize, typename Callable>
+auto DispatchTiles(Tensor<T, N, Tiled<TileSize>> const& tensor, Callable&& callable) -> void
+{
+    auto shape = tensor.Shape();
+    DispatchTiles(shape[0], shape[1], TileSize, callable);
+}
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// CPU placement for ThreadPool workers: which CPUs the process may run on, how they group into NUMA
+// nodes, and which CPU each worker is pinned to under a policy.
+
+enum class AffinityPolicy
+{
+    None,     // threads float wherever the scheduler puts them
+    Compact,  // fill one NUMA node before the next, workers sharing a node share its caches
+    Scatter,  // round-robin over the nodes, spreading memory bandwidth across sockets
+    Explicit, // worker i on ThreadPoolOptions::cpus[i % size]
+};
+
+// "0-3,8,10-11" as {0, 1, 2, 3, 8, 10, 11}, the format of the cpulist files in sysfs. Malformed pieces are skipped.
+inline auto ParseCpuList(std::string const& text) -> std::vector<size_t>
+{
+    std::vector<size_t> cpus;
+    std::istringstream stream(text);
+    std::string piece;
+    while (std::getline(stream, piece, ','))
+    {
+        size_t first = 0, last = 0;
+        char dash    = 0;
+        std::istringstream range(piece);
+        if (!(range >> first))
+        {
+            continue;
+        }
+        if (!(range >> dash))
+        {
+            last = first;
+        }
+        else if (dash != '-' || !(range >> last))
+        {
+            continue;
+        }
+        for (size_t cpu = first; cpu <= last; ++cpu)
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+struct CpuTopology
+{
+    std::vector<std::vector<size_t>> nodes; // usable CPUs of each NUMA node that has any
+
+    auto CpuCount() const -> size_t
+    {
+        size_t count = 0;
+        for (auto const& node : nodes)
+        {
+            count += node.size();
+        }
+        return count;
+    }
+
+    // Index into nodes of the node holding cpu, nullopt for a CPU outside the topology.
+    auto NodeOf(size_t cpu) const -> std::optional<size_t>
+    {
+        for (size_t node = 0; node < nodes.size(); ++node)
+        {
+            if (std::find(nodes[node].begin(), nodes[node].end(), cpu) != nodes[node].end())
+            {
+                return node;
+            }
+        }
+        return std::nullopt;
+    }
+};
+
+// CPUs in the process affinity mask, which a container or taskset may have narrowed.
+inline auto AllowedCpus() -> std::vector<size_t>
+{
+    std::vector<size_t> cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        for (size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &set))
+            {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    if (cpus.empty())
+    {
+        for (size_t cpu = 0; cpu < std::max(std::thread::hardware_concurrency(), 1u); ++cpu)
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+// NUMA nodes from <root>/node<N>/cpulist, limited to the allowed CPUs. Without sysfs, or on a
+// single-node machine, every allowed CPU is one node.
+inline auto ReadCpuTopology(std::string const& root = "/sys/devices/system/node", std::vector<size_t> const& allowed = AllowedCpus()) -> CpuTopology
+{
+    std::vector<std::pair<size_t, std::vector<size_t>>> numbered;
+
+    std::error_code error;
+    for (auto const& entry : std::filesystem::directory_iterator(root, error))
+    {
+        std::string name = entry.path().filename().string();
+        auto is_digit    = [](char c)
+        {
+            return c >= '0' && c <= '9';
+        };
+        if (!name.starts_with("node") || name.size() == 4 || !std::all_of(name.begin() + 4, name.end(), is_digit))
+        {
+            continue;
+        }
+
+        std::ifstream file(entry.path() / "cpulist");
+        std::string list;
+        std::getline(file, list);
+
+        std::vector<size_t> cpus;
+        for (size_t cpu : ParseCpuList(list))
+        {
+            if (std::find(allowed.begin(), allowed.end(), cpu) != allowed.end())
+            {
+                cpus.push_back(cpu);
+            }
+        }
+        if (!cpus.empty())
+        {
+            numbered.emplace_back(std::stoul(name.substr(4)), std::move(cpus));
+        }
+    }
+    std::sort(numbered.begin(), numbered.end());
+
+    CpuTopology topology;
+    for (auto& [number, cpus] : numbered)
+    {
+        topology.nodes.push_back(std::move(cpus));
+    }
+    if (topology.nodes.empty())
+    {
+        topology.nodes.push_back(allowed);
+    }
+    return topology;
+}
+
+// "compact", "scatter", "none", or a CPU list for an explicit placement; nullopt for anything else.
+inline auto ParseAffinity(std::string const& text, std::vector<size_t>& cpus) -> std::optional<AffinityPolicy>
+{
+    if (text == "none")
+    {
+        return AffinityPolicy::None;
+    }
+    if (text == "compact")
+    {
+        return AffinityPolicy::Compact;
+    }
+    if (text == "scatter")
+    {
+        return AffinityPolicy::Scatter;
+    }
+    cpus = ParseCpuList(text);
+    return cpus.empty() ? std::nullopt : std::optional<AffinityPolicy>(AffinityPolicy::Explicit);
+}
+
+// CPU of each of count workers, empty under AffinityPolicy::None. More workers than CPUs wrap around.
+inline auto PlaceWorkers(CpuTopology const& topology, AffinityPolicy policy, std::vector<size_t> const& cpus, size_t count) -> std::vector<size_t>
+{
+    std::vector<size_t> order;
+    switch (policy)
+    {
+    case AffinityPolicy::None:
+        return {};
+    case AffinityPolicy::Compact:
+        for (auto const& node : topology.nodes)
+        {
+            order.insert(order.end(), node.begin(), node.end());
+        }
+        break;
+    case AffinityPolicy::Scatter:
+        for (size_t i = 0; order.size() < topology.CpuCount(); ++i)
+        {
+            for (auto const& node : topology.nodes)
+            {
+                if (i < node.size())
+                {
+                    order.push_back(node[i]);
+                }
+            }
+        }
+        break;
+    case AffinityPolicy::Explicit:
+        order = cpus;
+        break;
+    }
+
+    std::vector<size_t> placement;
+    for (size_t i = 0; i < count && !order.empty(); ++i)
+    {
+        placement.push_back(order[i % order.size()]);
+    }
+    return placement;
+}
+
+// Pins the calling thread to one CPU. Returns false where pinning is unsupported or refused, the
+// thread then keeps running unpinned.
+inline auto PinCurrentThread(size_t cpu) -> bool
+{
+#if defined(__linux__)
+    if (cpu >= CPU_SETSIZE)
+    {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
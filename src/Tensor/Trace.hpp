@@ -0,0 +1,293 @@
+#pragma once
+
+#include <Expect.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Tracing compiles away entirely unless the build defines MATRIX_ENABLE_TRACING.
+#if defined(MATRIX_ENABLE_TRACING)
+inline constexpr bool TracingEnabled = true;
+#else
+inline constexpr bool TracingEnabled = false;
+#endif
+
+// Text as the contents of a JSON string, with quotes, backslashes and control characters escaped.
+inline auto JsonEscape(std::string_view text) -> std::string
+{
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char c : text)
+    {
+        switch (c)
+        {
+        case '"':
+            escaped += "\\\"";
+            break;
+        case '\\':
+            escaped += "\\\\";
+            break;
+        case '\n':
+            escaped += "\\n";
+            break;
+        case '\t':
+            escaped += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char code[7];
+                std::snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned>(static_cast<unsigned char>(c)));
+                escaped += code;
+            }
+            else
+            {
+                escaped += c;
+            }
+        }
+    }
+    return escaped;
+}
+
+struct TraceEvent
+{
+    static constexpr uint32_t NoWorker = std::numeric_limits<uint32_t>::max();
+    static constexpr uint32_t NoTile   = std::numeric_limits<uint32_t>::max();
+
+    const char* name = "task";
+
+    uint64_t enqueue_ns = 0;
+    uint64_t start_ns   = 0;
+    uint64_t end_ns     = 0;
+
+    uint32_t worker = NoWorker; // ThreadPool worker index, NoWorker for the dispatching thread
+    uint32_t tile_y = NoTile;
+    uint32_t tile_x = NoTile;
+
+    bool stolen = false; // taken from another worker group's queue
+};
+
+struct TraceSummary
+{
+    size_t tasks   = 0;
+    size_t workers = 0;
+
+    double span_seconds       = 0.0; // first enqueue to last task end
+    double busy_seconds       = 0.0; // summed task run time
+    double queue_wait_seconds = 0.0; // summed time between enqueue and start
+    double idle_seconds       = 0.0; // worker time inside the span not spent running tasks
+    double tail_seconds       = 0.0; // last task start to last task end, the straggler time
+    double utilization        = 0.0; // busy / (workers * span)
+
+    size_t steals = 0; // tasks a worker took from another group's queue
+
+    std::vector<size_t> tasks_per_worker;
+    std::vector<double> busy_per_worker;
+};
+
+class Tracer
+{
+private:
+
+    std::mutex mutex_;
+    std::vector<TraceEvent> events_;
+
+    static inline thread_local const char* region_ = "task";
+
+public:
+
+    static auto Instance() -> Tracer&
+    {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    static auto Now() -> uint64_t
+    {
+        auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+    }
+
+    // Name given to tasks dispatched from this thread, see TraceRegion.
+    static auto CurrentRegion() -> const char*
+    {
+        return region_;
+    }
+
+    static auto SetCurrentRegion(const char* name) -> const char*
+    {
+        return std::exchange(region_, name);
+    }
+
+    void Record(TraceEvent const& event)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        events_.push_back(event);
+    }
+
+    auto Events() -> std::vector<TraceEvent>
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return events_;
+    }
+
+    void Clear()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        events_.clear();
+    }
+
+    // Aggregates over worker tasks only, dispatch-level events on the calling thread are skipped.
+    auto Summary() -> TraceSummary
+    {
+        auto events = Events();
+
+        TraceSummary summary;
+        uint64_t first_enqueue = std::numeric_limits<uint64_t>::max();
+        uint64_t last_start    = 0;
+        uint64_t last_end      = 0;
+
+        for (auto const& event : events)
+        {
+            if (event.worker == TraceEvent::NoWorker)
+            {
+                continue;
+            }
+
+            if (event.worker >= summary.tasks_per_worker.size())
+            {
+                summary.tasks_per_worker.resize(event.worker + 1, 0);
+                summary.busy_per_worker.resize(event.worker + 1, 0.0);
+            }
+
+            double busy = (event.end_ns - event.start_ns) * 1e-9;
+
+            ++summary.tasks;
+            ++summary.tasks_per_worker[event.worker];
+            summary.steals += event.stolen ? 1 : 0;
+            summary.busy_per_worker[event.worker] += busy;
+            summary.busy_seconds += busy;
+            summary.queue_wait_seconds += (event.start_ns - event.enqueue_ns) * 1e-9;
+
+            first_enqueue = std::min(first_enqueue, event.enqueue_ns);
+            last_start    = std::max(last_start, event.start_ns);
+            last_end      = std::max(last_end, event.end_ns);
+        }
+
+        if (summary.tasks == 0)
+        {
+            return summary;
+        }
+
+        summary.workers      = summary.tasks_per_worker.size();
+        summary.span_seconds = (last_end - first_enqueue) * 1e-9;
+        summary.tail_seconds = (last_end - last_start) * 1e-9;
+
+        double capacity      = summary.workers * summary.span_seconds;
+        summary.idle_seconds = std::max(capacity - summary.busy_seconds, 0.0);
+        summary.utilization  = capacity > 0.0 ? summary.busy_seconds / capacity : 0.0;
+
+        return summary;
+    }
+
+    // Chrome trace-event JSON, loadable in chrome://tracing and ui.perfetto.dev. One track per worker.
+    void WriteChromeTrace(std::string const& filename)
+    {
+        auto events = Events();
+
+        std::ofstream outfile(filename);
+        Expect(static_cast<bool>(outfile), "error: unable to open " + filename + " for writing");
+
+        uint64_t origin = std::numeric_limits<uint64_t>::max();
+        uint32_t tracks = 0;
+        for (auto const& event : events)
+        {
+            origin = std::min(origin, event.enqueue_ns);
+            if (event.worker != TraceEvent::NoWorker)
+            {
+                tracks = std::max(tracks, event.worker + 1);
+            }
+        }
+
+        auto micros = [origin](uint64_t ns)
+        {
+            return (ns - origin) / 1000.0;
+        };
+
+        // the dispatching thread gets the track after the workers
+        auto track = [tracks](uint32_t worker)
+        {
+            return worker == TraceEvent::NoWorker ? tracks : worker;
+        };
+
+        outfile << std::fixed << std::setprecision(3);
+        outfile << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+        const char* separator = "\n";
+
+        for (uint32_t worker = 0; worker <= tracks; ++worker)
+        {
+            std::string name = worker == tracks ? "dispatch" : "worker " + std::to_string(worker);
+            outfile << separator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << worker << ",\"args\":{\"name\":\"" << JsonEscape(name) << "\"}}";
+            separator = ",\n";
+        }
+
+        for (auto const& event : events)
+        {
+            outfile << separator << "{\"name\":\"" << JsonEscape(event.name) << "\",\"cat\":\"" << (event.worker == TraceEvent::NoWorker ? "dispatch" : "tile") << "\""
+                    << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << track(event.worker)
+                    << ",\"ts\":" << micros(event.start_ns) << ",\"dur\":" << (event.end_ns - event.start_ns) / 1000.0
+                    << ",\"args\":{\"queue_wait_us\":" << (event.start_ns - event.enqueue_ns) / 1000.0;
+            if (event.tile_y != TraceEvent::NoTile)
+            {
+                outfile << ",\"tile_y\":" << event.tile_y << ",\"tile_x\":" << event.tile_x;
+            }
+            if (event.stolen)
+            {
+                outfile << ",\"stolen\":true";
+            }
+            outfile << "}}";
+        }
+
+        outfile << "\n]}\n";
+    }
+};
+
+// Names every task dispatched from this thread while in scope, e.g. TraceRegion region("Colorize").
+class TraceRegion
+{
+private:
+
+    const char* previous_ = nullptr;
+
+public:
+
+    explicit TraceRegion(const char* name)
+    {
+        if constexpr (TracingEnabled)
+        {
+            previous_ = Tracer::SetCurrentRegion(name);
+        }
+    }
+
+    TraceRegion(TraceRegion const&)            = delete;
+    TraceRegion& operator=(TraceRegion const&) = delete;
+
+    ~TraceRegion()
+    {
+        if constexpr (TracingEnabled)
+        {
+            Tracer::SetCurrentRegion(previous_);
+        }
+    }
+};
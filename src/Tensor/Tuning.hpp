@@ -0,0 +1,393 @@
+#pragma once
+
+#include <Dispatcher.hpp>
+#include <Number.hpp>
+#include <ThreadPool.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Block shapes for DispatchBlocks and block sizes for DispatchRange, measured per kernel, shape class
+// and element type. Results stay in memory unless a cache file is named, which later runs then load
+// on first use, so a program only writes one where it asked to. Environment:
+//   MATRIX_DISPATCH_BLOCK  <height>x<width>, or one number for square blocks, fixes every tuned
+//                          dispatch to that shape for reproducible runs (a range uses the width)
+//   MATRIX_TUNING_CACHE    cache file to load and keep results in, none by default (see SetPath)
+//   MATRIX_TUNING          off to stop measuring on first use, unknown keys then use the defaults
+
+struct TileShape
+{
+    size_t block_height = 256;
+    size_t block_width  = 256;
+
+    auto operator==(TileShape const&) const -> bool = default;
+};
+
+// "64x256", or "128" for 128x128. Zero extents and anything unparsable give nullopt.
+inline auto ParseTileShape(std::string const& text) -> std::optional<TileShape>
+{
+    std::istringstream stream(text);
+    size_t height = 0, width = 0;
+    char separator = 0;
+
+    if (!(stream >> height) || height == 0)
+    {
+        return std::nullopt;
+    }
+    if (!(stream >> separator))
+    {
+        return TileShape{height, height};
+    }
+    if (separator != 'x' || !(stream >> width) || width == 0 || (stream >> separator))
+    {
+        return std::nullopt;
+    }
+    return TileShape{height, width};
+}
+
+// Extents rounded up to powers of two, so a 1000x1900 and a 1024x2048 tensor share their tuning.
+inline auto ShapeClass(size_t height, size_t width) -> std::string
+{
+    return std::to_string(std::bit_ceil(std::max<size_t>(height, 1))) + "x" + std::to_string(std::bit_ceil(std::max<size_t>(width, 1)));
+}
+
+// f32, i16, u8 and so on. Float16 and BFloat16 share f16, their kernels cost the same.
+template <Number T>
+auto TypeTag() -> std::string
+{
+    char kind = Real<T> ? 'f' : Signed<T> ? 'i' : 'u';
+    return kind + std::to_string(sizeof(T) * 8);
+}
+
+// Kernel names must not contain spaces, the cache file is one "kernel class type height width" per line.
+inline auto TuningKey(std::string const& kernel, std::string const& shape_class, std::string const& type) -> std::string
+{
+    return kernel + " " + shape_class + " " + type;
+}
+
+class DispatchTuning
+{
+private:
+
+    mutable std::mutex mutex_;
+    std::map<std::string, TileShape> entries_;
+    std::optional<TileShape> fixed_;
+    std::string path_;
+    bool tune_on_first_use_ = true;
+
+    DispatchTuning()
+    {
+        if (const char* block = std::getenv("MATRIX_DISPATCH_BLOCK"))
+        {
+            fixed_ = ParseTileShape(block);
+        }
+        if (const char* path = std::getenv("MATRIX_TUNING_CACHE"))
+        {
+            path_ = path;
+        }
+        if (const char* tuning = std::getenv("MATRIX_TUNING"))
+        {
+            tune_on_first_use_ = std::string(tuning) != "off";
+        }
+        Load(path_);
+    }
+
+    auto SaveLocked(std::string const& path) const -> bool
+    {
+        if (path.empty())
+        {
+            return false;
+        }
+
+        // written aside and renamed over the file, so another process reading it never sees half of it
+        std::string temporary = path + ".tmp" + std::to_string(std::random_device{}());
+        std::error_code error;
+        std::ofstream stream(temporary);
+        stream << "# kernel shape-class type block-height block-width\n";
+        for (auto const& [key, shape] : entries_)
+        {
+            stream << key << " " << shape.block_height << " " << shape.block_width << "\n";
+        }
+        stream.close();
+        if (!stream)
+        {
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+
+        std::filesystem::rename(temporary, path, error);
+        if (error)
+        {
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+        return true;
+    }
+
+public:
+
+    static auto Instance() -> DispatchTuning&
+    {
+        static DispatchTuning tuning;
+        return tuning;
+    }
+
+    // Shape every tuned dispatch uses instead of its cached or measured one, nullopt to tune again.
+    auto Fixed() const -> std::optional<TileShape>
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return fixed_;
+    }
+
+    auto SetFixed(std::optional<TileShape> shape) -> void
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        fixed_ = shape;
+    }
+
+    auto TuneOnFirstUse() const -> bool
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return tune_on_first_use_;
+    }
+
+    auto SetTuneOnFirstUse(bool enabled) -> void
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        tune_on_first_use_ = enabled;
+    }
+
+    auto Path() const -> std::string
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return path_;
+    }
+
+    // File every new result is written back to, empty for none. Entries already in memory are kept.
+    auto SetPath(std::string path) -> void
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        path_ = std::move(path);
+    }
+
+    auto Find(std::string const& key) const -> std::optional<TileShape>
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto entry = entries_.find(key);
+        return entry != entries_.end() ? std::optional<TileShape>(entry->second) : std::nullopt;
+    }
+
+    // Remembers a result and rewrites the cache file. A file that cannot be written only loses
+    // persistence, the result still applies to this run.
+    auto Store(std::string const& key, TileShape shape) -> void
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        entries_[key] = shape;
+        SaveLocked(path_);
+    }
+
+    auto Save(std::string const& path) const -> bool
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return SaveLocked(path);
+    }
+
+    // Merges the entries of a cache file over the ones in memory, returns how many were read.
+    // Comment lines and malformed lines are skipped.
+    auto Load(std::string const& path) -> size_t
+    {
+        std::ifstream stream(path);
+        std::string line;
+        size_t loaded = 0;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (std::getline(stream, line))
+        {
+            std::istringstream fields(line);
+            std::string kernel, shape_class, type;
+            TileShape shape;
+            if (line.starts_with("#") || !(fields >> kernel >> shape_class >> type >> shape.block_height >> shape.block_width))
+            {
+                continue;
+            }
+            if (shape.block_height > 0 && shape.block_width > 0)
+            {
+                entries_[TuningKey(kernel, shape_class, type)] = shape;
+                ++loaded;
+            }
+        }
+        return loaded;
+    }
+
+    auto Clear() -> void
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        entries_.clear();
+    }
+};
+
+// Short wide blocks suit cheap row-wise kernels, square ones kernels that read neighbouring rows and
+// small ones tensors too small to keep every worker busy with 256x256 blocks.
+inline auto BlockCandidates(size_t height, size_t width) -> std::vector<TileShape>
+{
+    std::vector<TileShape> candidates;
+    for (size_t block_height : {8, 32, 128, 512})
+    {
+        for (size_t block_width : {64, 256, 1024})
+        {
+            TileShape shape{std::clamp<size_t>(block_height, 1, std::max<size_t>(height, 1)), std::clamp<size_t>(block_width, 1, std::max<size_t>(width, 1))};
+            if (std::find(candidates.begin(), candidates.end(), shape) == candidates.end())
+            {
+                candidates.push_back(shape);
+            }
+        }
+    }
+    return candidates;
+}
+
+inline auto GrainCandidates(size_t size) -> std::vector<size_t>
+{
+    std::vector<size_t> candidates;
+    for (size_t grain = size_t(1) << 10; grain <= size_t(1) << 20; grain <<= 2)
+    {
+        size_t clamped = std::clamp<size_t>(grain, 1, std::max<size_t>(size, 1));
+        if (std::find(candidates.begin(), candidates.end(), clamped) == candidates.end())
+        {
+            candidates.push_back(clamped);
+        }
+    }
+    return candidates;
+}
+
+// Runs dispatch(candidate) once to page in the operands, then times each candidate by its fastest
+// run, repeating short ones for up to a millisecond to see past scheduling noise. The kernel runs
+// many times and must give the same result every time.
+template <typename Candidate, typename Dispatch>
+auto FastestCandidate(std::vector<Candidate> const& candidates, Dispatch&& dispatch) -> Candidate
+{
+    using Clock = std::chrono::steady_clock;
+
+    dispatch(candidates.front());
+
+    Candidate best   = candidates.front();
+    double best_time = std::numeric_limits<double>::infinity();
+    for (auto const& candidate : candidates)
+    {
+        double fastest = std::numeric_limits<double>::infinity();
+        double spent   = 0.0;
+        for (size_t run = 0; run < 16 && (run == 0 || spent < 1e-3); ++run)
+        {
+            auto start = Clock::now();
+            dispatch(candidate);
+            double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+            fastest        = std::min(fastest, elapsed);
+            spent += elapsed;
+        }
+        if (fastest < best_time)
+        {
+            best      = candidate;
+            best_time = fastest;
+        }
+    }
+    return best;
+}
+
+// Explicit tuning run: measures every block shape for this kernel, shape class and type, stores the
+// winner and returns it. The output of the callable is complete afterwards.
+template <Number T, typename Callable>
+auto TuneDispatchBlocks(std::string const& kernel, size_t height, size_t width, Callable&& callable) -> TileShape
+{
+    TileShape best = FastestCandidate(BlockCandidates(height, width), [&](TileShape shape)
+    {
+        DispatchBlocks(height, width, shape.block_height, shape.block_width, callable);
+    });
+    DispatchTuning::Instance().Store(TuningKey(kernel, ShapeClass(height, width), TypeTag<T>()), best);
+    return best;
+}
+
+template <Number T, typename Callable>
+auto TuneDispatchRange(std::string const& kernel, size_t size, Callable&& callable) -> size_t
+{
+    size_t best = FastestCandidate(GrainCandidates(size), [&](size_t grain)
+    {
+        DispatchRange(size, grain, callable);
+    });
+    DispatchTuning::Instance().Store(TuningKey(kernel, ShapeClass(1, size), TypeTag<T>()), TileShape{1, best});
+    return best;
+}
+
+// DispatchBlocks with the fixed shape, else the cached one, else a tuning run on first use, else
+// 256x256 blocks. Nested dispatches run inline and are never tuned.
+template <Number T, typename Callable>
+auto TunedDispatchBlocks(std::string const& kernel, size_t height, size_t width, Callable&& callable) -> void
+{
+    auto& tuning = DispatchTuning::Instance();
+
+    TileShape shape;
+    if (auto fixed = tuning.Fixed())
+    {
+        shape = *fixed;
+    }
+    else if (auto cached = tuning.Find(TuningKey(kernel, ShapeClass(height, width), TypeTag<T>())))
+    {
+        shape = *cached;
+    }
+    else if (tuning.TuneOnFirstUse() && !ThreadPool::IsWorkerThread() && BlockCandidates(height, width).size() > 1)
+    {
+        TuneDispatchBlocks<T>(kernel, height, width, callable);
+        return;
+    }
+
+    DispatchBlocks(height, width, shape.block_height, shape.block_width, callable);
+}
+
+template <Number T, typename Callable>
+auto TunedDispatch2d(std::string const& kernel, size_t height, size_t width, Callable&& callable) -> void
+{
+    TunedDispatchBlocks<T>(kernel, height, width, [&](size_t y_start, size_t y_stop, size_t x_start, size_t x_stop)
+    {
+        for (size_t y = y_start; y < y_stop; ++y)
+        {
+            for (size_t x = x_start; x < x_stop; ++x)
+            {
+                callable(y, x);
+            }
+        }
+    });
+}
+
+// DispatchRange with a tuned block size, chosen the same way, default_grain when nothing applies.
+template <Number T, typename Callable>
+auto TunedDispatchRange(std::string const& kernel, size_t size, size_t default_grain, Callable&& callable) -> void
+{
+    auto& tuning = DispatchTuning::Instance();
+
+    size_t grain = default_grain;
+    if (auto fixed = tuning.Fixed())
+    {
+        grain = fixed->block_width;
+    }
+    else if (auto cached = tuning.Find(TuningKey(kernel, ShapeClass(1, size), TypeTag<T>())))
+    {
+        grain = cached->block_width;
+    }
+    else if (tuning.TuneOnFirstUse() && !ThreadPool::IsWorkerThread() && GrainCandidates(size).size() > 1)
+    {
+        TuneDispatchRange<T>(kernel, size, callable);
+        return;
+    }
+
+    DispatchRange(size, grain, callable);
+}
@@ -0,0 +1,525 @@
+#include <ColorSpace.hpp>
+#include <Filter.hpp>
+#include <Histogram.hpp>
+#include <ImageLoader.hpp>
+#include <Morphology.hpp>
+#include <PNG.hpp>
+#include <PPM.hpp>
+#include <Pyramid.hpp>
+#include <Tensor.hpp>
+#include <Warp.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <limits>
+#include <span>
+#include <string>
+#include <vector>
+
+// Frame sizes as {height, width}.
+static void FrameSizes(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->Args({512, 512});
+    benchmark->Args({1080, 1920});
+}
+
+// 4K, 8K and 16K frames for the per-frame tone passes.
+static void LargeFrameSizes(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->Args({2160, 3840});
+    benchmark->Args({4320, 7680});
+    benchmark->Args({8640, 15360});
+}
+
+// Smooth gradient with some texture so the PNG compressor has realistic work.
+static auto TestImage(size_t height, size_t width) -> Tensor<uint8_t, 3>
+{
+    Tensor<uint8_t, 3> rgb({height, width, 3});
+    for (size_t y = 0; y < height; ++y)
+    {
+        for (size_t x = 0; x < width; ++x)
+        {
+            rgb(y, x, 0) = static_cast<uint8_t>(x * 255 / width);
+            rgb(y, x, 1) = static_cast<uint8_t>(y * 255 / height);
+            rgb(y, x, 2) = static_cast<uint8_t>((x * y) & 0xff);
+        }
+    }
+    return rgb;
+}
+
+// {height, width, radius}, a 1080p frame with radii growing 64x; the cost should stay flat.
+static void RadiusSweep(benchmark::internal::Benchmark* benchmark)
+{
+    for (int64_t radius : {1, 4, 16, 64})
+    {
+        benchmark->Args({1080, 1920, radius});
+    }
+}
+
+static auto TemporaryPath(std::string const& name) -> std::string
+{
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+static void BM_EncodePpm(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    auto rgb      = TestImage(height, width);
+    auto path     = TemporaryPath("matrix_benchmark.ppm");
+    for (auto _ : state)
+    {
+        EncodePpm(path, rgb);
+    }
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(rgb.Size()));
+}
+BENCHMARK(BM_EncodePpm)->Apply(FrameSizes)->Unit(benchmark::kMillisecond);
+
+static void BM_EncodePng(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    auto rgb      = TestImage(height, width);
+    auto path     = TemporaryPath("matrix_benchmark.png");
+    for (auto _ : state)
+    {
+        EncodePng(path, rgb);
+    }
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(rgb.Size()));
+}
+BENCHMARK(BM_EncodePng)->Apply(FrameSizes)->Unit(benchmark::kMillisecond);
+
+static void BM_Histogram(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    auto rgb      = TestImage(height, width);
+    for (auto _ : state)
+    {
+        auto histogram = Histogram(rgb);
+        benchmark::DoNotOptimize(histogram.Data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(rgb.Size()));
+}
+BENCHMARK(BM_Histogram)->Apply(LargeFrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// The serial per-frame pass the parallel histogram and vector lookup replace.
+static void BM_AutoLevelsSerial(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    auto rgb      = TestImage(height, width);
+    for (auto _ : state)
+    {
+        Tensor<uint64_t, 2> histogram({3, 256}, 0);
+        for (size_t i = 0; i < rgb.Size(); ++i)
+        {
+            ++histogram.Data()[(i % 3) * 256 + rgb.Data()[i]];
+        }
+        auto luts = AutoLevelsLut(histogram);
+        for (size_t i = 0; i < rgb.Size(); ++i)
+        {
+            rgb.Data()[i] = luts.Data()[(i % 3) * 256 + rgb.Data()[i]];
+        }
+        benchmark::DoNotOptimize(rgb.Data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(rgb.Size()));
+}
+BENCHMARK(BM_AutoLevelsSerial)->Apply(LargeFrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_AutoLevels(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    auto rgb      = TestImage(height, width);
+    for (auto _ : state)
+    {
+        ApplyLut(rgb, AutoLevelsLut(Histogram(rgb)), rgb);
+        benchmark::DoNotOptimize(rgb.Data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(rgb.Size()));
+}
+BENCHMARK(BM_AutoLevels)->Apply(LargeFrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+template <size_t Channels>
+static void BM_ApplyLut(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    Tensor<uint8_t, 3> image({height, width, Channels});
+    for (size_t i = 0; i < image.Size(); ++i)
+    {
+        image.Data()[i] = static_cast<uint8_t>(i * 7);
+    }
+    Tensor<uint8_t, 2> luts({Channels, 256});
+    for (size_t i = 0; i < luts.Size(); ++i)
+    {
+        luts.Data()[i] = static_cast<uint8_t>(255 - i);
+    }
+    for (auto _ : state)
+    {
+        ApplyLut(image, luts, image);
+        benchmark::DoNotOptimize(image.Data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(image.Size()));
+}
+BENCHMARK_TEMPLATE(BM_ApplyLut, 1)->Apply(LargeFrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ApplyLut, 3)->Apply(LargeFrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_IntegralImage(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    auto rgb      = TestImage(height, width);
+    for (auto _ : state)
+    {
+        auto integral = IntegralImage(rgb);
+        benchmark::DoNotOptimize(integral.Data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+}
+BENCHMARK(BM_IntegralImage)->Apply(FrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_BoxFilter(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    size_t radius = state.range(2);
+    auto rgb      = TestImage(height, width);
+    for (auto _ : state)
+    {
+        auto blurred = BoxFilter(rgb, radius);
+        benchmark::DoNotOptimize(blurred.Data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+}
+BENCHMARK(BM_BoxFilter)->Apply(RadiusSweep)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_Erode(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    size_t radius = state.range(2);
+    auto rgb      = TestImage(height, width);
+    for (auto _ : state)
+    {
+        auto eroded = Erode(rgb, radius);
+        benchmark::DoNotOptimize(eroded.Data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+}
+BENCHMARK(BM_Erode)->Apply(RadiusSweep)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_Open(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    size_t radius = state.range(2);
+    auto rgb      = TestImage(height, width);
+    for (auto _ : state)
+    {
+        auto opened = Open(rgb, radius);
+        benchmark::DoNotOptimize(opened.Data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+}
+BENCHMARK(BM_Open)->Apply(RadiusSweep)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// {height, width, tile}. Items are output pixels, so items_per_second reads as megapixels per second.
+// The 4096 tile covers whole rows, the untiled order where a rotated row strides across the source.
+static void RotationSizes(benchmark::internal::Benchmark* benchmark)
+{
+    for (int64_t tile : {64, 4096})
+    {
+        benchmark->Args({1080, 1920, tile});
+        benchmark->Args({2160, 3840, tile});
+    }
+}
+
+template <Interpolation Mode>
+static void BM_Rotate(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    auto rgb      = TestImage(height, width);
+
+    WarpOptions options{Mode, BorderMode::Constant, 0.0, static_cast<size_t>(state.range(2))};
+    for (auto _ : state)
+    {
+        auto rotated = Rotate(rgb, 37.5, options);
+        benchmark::DoNotOptimize(rotated.Data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+}
+BENCHMARK_TEMPLATE(BM_Rotate, Interpolation::Nearest)->Apply(RotationSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Rotate, Interpolation::Bilinear)->Apply(RotationSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_WarpPerspective(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    auto rgb      = TestImage(height, width);
+
+    PerspectiveMatrix homography({{0.9, 0.1, 40.0}, {-0.05, 1.05, 10.0}, {1e-5, 2e-5, 1.0}});
+    for (auto _ : state)
+    {
+        auto warped = WarpPerspective(rgb, homography, {height, width});
+        benchmark::DoNotOptimize(warped.Data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+}
+BENCHMARK(BM_WarpPerspective)->Apply(FrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_RgbToGray(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    auto rgb      = TestImage(height, width);
+    for (auto _ : state)
+    {
+        auto gray = RgbToGray(rgb);
+        benchmark::DoNotOptimize(gray.Data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(rgb.Size()));
+}
+BENCHMARK(BM_RgbToGray)->Apply(FrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// The y4m path of the batch renderer, into planes reused across frames.
+static void BM_RgbToYCbCr420(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    auto rgb      = TestImage(height, width);
+    YCbCr420 yuv(height, width);
+    for (auto _ : state)
+    {
+        RgbToYCbCr420(rgb, yuv);
+        benchmark::DoNotOptimize(yuv.y.Data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(rgb.Size()));
+}
+BENCHMARK(BM_RgbToYCbCr420)->Apply(FrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_YCbCr420ToRgb(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    auto yuv      = RgbToYCbCr420(TestImage(height, width));
+    Tensor<uint8_t, 3> rgb({height, width, 3});
+    for (auto _ : state)
+    {
+        YCbCr420ToRgb(yuv, rgb);
+        benchmark::DoNotOptimize(rgb.Data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(rgb.Size()));
+}
+BENCHMARK(BM_YCbCr420ToRgb)->Apply(FrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Decoding from memory at the file's own depth, 8-bit samples copy straight into the image and
+// 16-bit ones are byte-swapped.
+template <typename T>
+static void BM_DecodePpm(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+
+    std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n" + std::to_string(std::numeric_limits<T>::max()) + "\n";
+    std::vector<uint8_t> bytes(header.begin(), header.end());
+    bytes.resize(header.size() + height * width * 3 * sizeof(T), 0x5a);
+
+    Tensor<T, 3> image({height, width, 3});
+    for (auto _ : state)
+    {
+        DecodePpm(std::span<uint8_t const>(bytes), image);
+        benchmark::DoNotOptimize(image.Data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(bytes.size()));
+}
+BENCHMARK_TEMPLATE(BM_DecodePpm, uint8_t)->Apply(FrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_DecodePpm, uint16_t)->Apply(FrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// {io_threads, lookahead} over 32 PPM frames of 512x512 in the temporary directory, reporting the
+// loader's own frames per second and MB/s.
+static void BM_LoadImages(benchmark::State& state)
+{
+    std::vector<std::string> paths;
+    auto rgb = TestImage(512, 512);
+    for (size_t i = 0; i < 32; ++i)
+    {
+        paths.push_back(TemporaryPath("matrix_benchmark_load_" + std::to_string(i) + ".ppm"));
+        EncodePpm(paths.back(), rgb);
+    }
+
+    LoaderOptions options;
+    options.io_threads = state.range(0);
+    options.lookahead  = state.range(1);
+
+    LoaderStats stats;
+    for (auto _ : state)
+    {
+        stats = LoadImages<uint8_t>(paths, options, [](size_t, Tensor<uint8_t, 3> const& image)
+        {
+            benchmark::DoNotOptimize(image.Data());
+        });
+    }
+    for (auto const& path : paths)
+    {
+        std::remove(path.c_str());
+    }
+    state.counters["fps"]  = stats.FramesPerSecond();
+    state.counters["MB/s"] = stats.MegabytesPerSecond();
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(paths.size()));
+}
+BENCHMARK(BM_LoadImages)->Args({1, 1})->Args({2, 8})->Args({4, 16})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Levels built by every pyramid benchmark, the 16K frame's coarsest being 68x120.
+static constexpr size_t PyramidLevels = 8;
+
+// The unfused level the pyramid replaces: 1 4 6 4 1 at every pixel, horizontally then vertically,
+// then the even rows and columns kept in a pass of their own.
+static auto BlurThenSubsample(Tensor<uint8_t, 3> const& image) -> Tensor<uint8_t, 3>
+{
+    auto shape      = image.Shape();
+    size_t height   = shape[0];
+    size_t width    = shape[1];
+    size_t channels = shape[2];
+    size_t stride   = width * channels;
+
+    Tensor<uint16_t, 3> rows(shape);
+    Tensor<uint8_t, 3> blurred(shape);
+    Tensor<uint8_t, 3> result({(height + 1) / 2, (width + 1) / 2, channels});
+
+    DispatchRange(height, 16, [&](size_t start, size_t stop)
+    {
+        for (size_t y = start; y < stop; ++y)
+        {
+            uint8_t const* in = image.Data() + y * stride;
+            uint16_t* out     = rows.Data() + y * stride;
+            for (size_t x = 0; x < width; ++x)
+            {
+                std::ptrdiff_t column = static_cast<std::ptrdiff_t>(x);
+                bool inside           = x >= 2 && x + 2 < width;
+                for (size_t c = 0; c < channels; ++c)
+                {
+                    auto at = [&](std::ptrdiff_t offset)
+                    {
+                        size_t u = inside ? static_cast<size_t>(column + offset) : ReflectIndex(column + offset, width);
+                        return static_cast<uint16_t>(in[u * channels + c]);
+                    };
+                    out[x * channels + c] = static_cast<uint16_t>(at(-2) + 4 * at(-1) + 6 * at(0) + 4 * at(1) + at(2));
+                }
+            }
+        }
+    });
+
+    DispatchRange(height, 16, [&](size_t start, size_t stop)
+    {
+        for (size_t y = start; y < stop; ++y)
+        {
+            std::ptrdiff_t row = static_cast<std::ptrdiff_t>(y);
+            uint16_t const* r0 = rows.Data() + ReflectIndex(row - 2, height) * stride;
+            uint16_t const* r1 = rows.Data() + ReflectIndex(row - 1, height) * stride;
+            uint16_t const* r2 = rows.Data() + y * stride;
+            uint16_t const* r3 = rows.Data() + ReflectIndex(row + 1, height) * stride;
+            uint16_t const* r4 = rows.Data() + ReflectIndex(row + 2, height) * stride;
+            uint8_t* out       = blurred.Data() + y * stride;
+            for (size_t i = 0; i < stride; ++i)
+            {
+                out[i] = static_cast<uint8_t>((r0[i] + 4 * r1[i] + 6 * r2[i] + 4 * r3[i] + r4[i] + 128) >> 8);
+            }
+        }
+    });
+
+    DispatchRange(result.Shape()[0], 16, [&](size_t start, size_t stop)
+    {
+        for (size_t y = start; y < stop; ++y)
+        {
+            uint8_t const* in = blurred.Data() + 2 * y * stride;
+            uint8_t* out      = result.Data() + y * result.Shape()[1] * channels;
+            for (size_t x = 0; x < result.Shape()[1]; ++x)
+            {
+                std::copy_n(in + 2 * x * channels, channels, out + x * channels);
+            }
+        }
+    });
+    return result;
+}
+
+// Items are source pixels, so items_per_second reads as frame pixels per second.
+static void BM_PyramidBlurThenSubsample(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    auto rgb      = TestImage(height, width);
+    for (auto _ : state)
+    {
+        Tensor<uint8_t, 3> level = BlurThenSubsample(rgb);
+        for (size_t k = 2; k < PyramidLevels; ++k)
+        {
+            level = BlurThenSubsample(level);
+        }
+        benchmark::DoNotOptimize(level.Data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(rgb.Size()));
+}
+BENCHMARK(BM_PyramidBlurThenSubsample)->Apply(LargeFrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_GaussianPyramid(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    auto rgb      = TestImage(height, width);
+    for (auto _ : state)
+    {
+        auto pyramid = GaussianPyramid(rgb, PyramidLevels);
+        benchmark::DoNotOptimize(pyramid.Data(PyramidLevels - 1));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(rgb.Size()));
+}
+BENCHMARK(BM_GaussianPyramid)->Apply(LargeFrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_LaplacianPyramid(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    auto rgb      = TestImage(height, width);
+    for (auto _ : state)
+    {
+        auto pyramid = LaplacianPyramid(rgb, PyramidLevels);
+        benchmark::DoNotOptimize(pyramid.Data(0));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(rgb.Size()));
+}
+BENCHMARK(BM_LaplacianPyramid)->Apply(LargeFrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_ReconstructLaplacian(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    auto pyramid  = LaplacianPyramid(TestImage(height, width), PyramidLevels);
+    for (auto _ : state)
+    {
+        auto image = ReconstructLaplacian<uint8_t>(pyramid);
+        benchmark::DoNotOptimize(image.Data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+}
+BENCHMARK(BM_ReconstructLaplacian)->Apply(LargeFrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
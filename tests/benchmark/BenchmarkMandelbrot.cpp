@@ -0,0 +1,189 @@
+#include <Distributed.hpp>
+#include <Mandelbrot.hpp>
+#include <Progressive.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+// Frame sizes as {height, width}.
+static void FrameSizes(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->Args({270, 480});
+    benchmark->Args({1080, 1920});
+}
+
+template <Real T>
+static void BM_GenerateMandelbrot(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    for (auto _ : state)
+    {
+        auto intensity = GenerateMandelbrot<T>(height, width);
+        benchmark::DoNotOptimize(intensity.Data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(height * width * sizeof(T)));
+}
+BENCHMARK_TEMPLATE(BM_GenerateMandelbrot, float)->Apply(FrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_GenerateMandelbrot, Float16)->Apply(FrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_GenerateMandelbrotImage(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    for (auto _ : state)
+    {
+        auto rgb = GenerateMandelbrotImage(height, width, Colormap::Plasma);
+        benchmark::DoNotOptimize(rgb.Data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(height * width * 3));
+}
+BENCHMARK(BM_GenerateMandelbrotImage)->Apply(FrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// The same image as two full-frame passes with a barrier between them, what the per-tile task graph replaces.
+static void BM_GenerateMandelbrotImageBarrier(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    for (auto _ : state)
+    {
+        auto rgb = ColorizeMandelbrot(GenerateMandelbrot(height, width), Colormap::Plasma);
+        benchmark::DoNotOptimize(rgb.Data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(height * width * 3));
+}
+BENCHMARK(BM_GenerateMandelbrotImageBarrier)->Apply(FrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+template <Real T>
+static void BM_ColorizeMandelbrot(benchmark::State& state)
+{
+    size_t height  = state.range(0);
+    size_t width   = state.range(1);
+    auto intensity = GenerateMandelbrot<T>(height, width);
+    Tensor<uint8_t, 3> rgb({height, width, 3});
+    for (auto _ : state)
+    {
+        ColorizeMandelbrot(intensity, rgb, Colormap::Plasma);
+        benchmark::DoNotOptimize(rgb.Data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(height * width * (sizeof(T) + 3)));
+}
+BENCHMARK_TEMPLATE(BM_ColorizeMandelbrot, float)->Apply(FrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ColorizeMandelbrot, Float16)->Apply(FrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_GenerateMandelbrotImageAdaptive(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    for (auto _ : state)
+    {
+        auto rgb = GenerateMandelbrotImageAdaptive(height, width, Colormap::Plasma);
+        benchmark::DoNotOptimize(rgb.Data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(height * width * 3));
+}
+BENCHMARK(BM_GenerateMandelbrotImageAdaptive)->Apply(FrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Level 0 of the progressive benchmarks spans the default view's 3.5 units across the frame.
+static auto ProgressiveFrameOptions(size_t width) -> ProgressiveOptions
+{
+    ProgressiveOptions options;
+    options.step = 3.5 / static_cast<double>(width);
+    return options;
+}
+
+// A frame with nothing cached, compare with BM_GenerateMandelbrot; first_preview_ms is the
+// coarsest pass, what an interactive view shows first.
+static void BM_ProgressiveColdFrame(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    Tensor<float, 2> intensity({height, width});
+    double first_preview = 0.0;
+    for (auto _ : state)
+    {
+        ProgressiveRenderer renderer(ProgressiveFrameOptions(width));
+        first_preview += renderer.Render({}, intensity).first_preview_seconds;
+        benchmark::DoNotOptimize(intensity.Data());
+    }
+    state.counters["first_preview_ms"] = benchmark::Counter(first_preview * 1e3, benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+}
+BENCHMARK(BM_ProgressiveColdFrame)->Apply(FrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Each frame panned 64 pixels right of the last, only the uncovered columns are iterated.
+static void BM_ProgressivePan(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    auto options  = ProgressiveFrameOptions(width);
+    ProgressiveRenderer renderer(options);
+    ProgressiveView view;
+    Tensor<float, 2> intensity({height, width});
+    renderer.Render(view, intensity);
+
+    double first_preview = 0.0, hit_rate = 0.0;
+    for (auto _ : state)
+    {
+        view.centerReal += 64 * options.step;
+        auto stats = renderer.Render(view, intensity);
+        first_preview += stats.first_preview_seconds;
+        hit_rate += stats.HitRate();
+        benchmark::DoNotOptimize(intensity.Data());
+    }
+    state.counters["first_preview_ms"] = benchmark::Counter(first_preview * 1e3, benchmark::Counter::kAvgIterations);
+    state.counters["hit_rate"]         = benchmark::Counter(hit_rate, benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+}
+BENCHMARK(BM_ProgressivePan)->Apply(FrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Raising the budget from 200 to 400 on a cached frame, only the orbits still bounded at 200 go on.
+static void BM_ProgressiveRaiseIterations(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    Tensor<float, 2> intensity({height, width});
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        ProgressiveRenderer renderer(ProgressiveFrameOptions(width));
+        renderer.Render({}, intensity);
+        state.ResumeTiming();
+
+        renderer.Render({-0.75, 0.0, 0, 400}, intensity);
+        benchmark::DoNotOptimize(intensity.Data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+}
+BENCHMARK(BM_ProgressiveRaiseIterations)->Apply(FrameSizes)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+#if defined(MATRIX_DISTRIBUTED_RENDER)
+// {height, width, workers}, worker start-up included; compare with BM_GenerateMandelbrotImage.
+static void BM_RenderDistributed(benchmark::State& state)
+{
+    size_t height = state.range(0);
+    size_t width  = state.range(1);
+    auto path     = (std::filesystem::temp_directory_path() / "matrix_benchmark_distributed.rgb").string();
+
+    DistributedOptions options;
+    options.workers = state.range(2);
+    for (auto _ : state)
+    {
+        auto render = RenderDistributed(path, height, width, Colormap::Plasma, {}, options);
+        benchmark::DoNotOptimize(render.image.Data());
+    }
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(height * width));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(height * width * 3));
+}
+BENCHMARK(BM_RenderDistributed)->Args({1080, 1920, 1})->Args({1080, 1920, 4})->Unit(benchmark::kMillisecond)->UseRealTime();
+#endif
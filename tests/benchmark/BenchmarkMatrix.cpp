@@ -1,43 +1,612 @@
-#include "Matrix.hpp"
+#include <Algorithm.hpp>
+#include <Arithmetic.hpp>
+#include <Conversion.hpp>
+#include <Dispatcher.hpp>
+#include <Saturating.hpp>
+#include <StaticTensor.hpp>
+#include <Tensor.hpp>
+#include <ThreadPool.hpp>
+#include <Tiling.hpp>
+#include <Tuning.hpp>
+
 #include <benchmark/benchmark.h>
 
-// // Benchmark for sequential matrix addition.
-// static void BM_SequentialAddition(benchmark::State& state)
-// {
-//     // Matrix dimensions provided via benchmark arguments.
-//     const usize rows = state.range(0);
-//     const usize cols = state.range(1);
-
-//     // Define a sequential matrix (using Naive arithmetic).
-//     using MatrixSequential = Matrix<double, ThreadingPolicy::Sequential, ArithmeticPolicy::Naive>;
-//     MatrixSequential A(rows, cols, 1.0);
-//     MatrixSequential B(rows, cols, 2.0);
-
-//     for (auto _ : state)
-//     {
-//         // Perform addition and prevent the result from being optimized away.
-//         auto C = A + B;
-//         benchmark::DoNotOptimize(C);
-//     }
-// }
-// BENCHMARK(BM_SequentialAddition)->Args({1000, 1000});
-
-// // Benchmark for threaded matrix addition.
-// static void BM_ThreadedAddition(benchmark::State& state)
-// {
-//     const usize rows = state.range(0);
-//     const usize cols = state.range(1);
-
-//     // Define a threaded matrix (using Naive arithmetic).
-//     using MatrixThreaded = Matrix<double, ThreadingPolicy::Threaded, ArithmeticPolicy::Naive>;
-//     MatrixThreaded A(rows, cols, 1.0);
-//     MatrixThreaded B(rows, cols, 2.0);
-
-//     for (auto _ : state)
-//     {
-//         // Perform addition and prevent the result from being optimized away.
-//         auto C = A + B;
-//         benchmark::DoNotOptimize(C);
-//     }
-// }
-// BENCHMARK(BM_ThreadedAddition)->Args({1000, 1000});
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <latch>
+
+// Square side lengths shared by the tensor benchmarks, timed on the wall clock since work runs on pool threads.
+static void SquareSizes(benchmark::internal::Benchmark* benchmark)
+{
+    for (int64_t size : {64, 512, 2048})
+    {
+        benchmark->Arg(size);
+    }
+    benchmark->UseRealTime();
+}
+
+static void SetThroughput(benchmark::State& state, size_t elements, size_t bytes_per_element)
+{
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(elements));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(elements * bytes_per_element));
+}
+
+// ----- Tensor construction, copy and move -----
+
+template <typename T>
+static void BM_TensorConstruct(benchmark::State& state)
+{
+    size_t size = state.range(0);
+    for (auto _ : state)
+    {
+        Tensor<T, 2> tensor({size, size});
+        benchmark::DoNotOptimize(tensor.Data());
+    }
+    SetThroughput(state, size * size, sizeof(T));
+}
+
+template <typename T>
+static void BM_TensorConstructFilled(benchmark::State& state)
+{
+    size_t size = state.range(0);
+    for (auto _ : state)
+    {
+        Tensor<T, 2> tensor({size, size}, T(1));
+        benchmark::DoNotOptimize(tensor.Data());
+    }
+    SetThroughput(state, size * size, sizeof(T));
+}
+
+template <typename T>
+static void BM_TensorCopy(benchmark::State& state)
+{
+    size_t size = state.range(0);
+    Tensor<T, 2> source({size, size}, T(1));
+    for (auto _ : state)
+    {
+        Tensor<T, 2> copy = source;
+        benchmark::DoNotOptimize(copy.Data());
+    }
+    SetThroughput(state, size * size, 2 * sizeof(T));
+}
+
+template <typename T>
+static void BM_TensorMove(benchmark::State& state)
+{
+    size_t size = state.range(0);
+    Tensor<T, 2> source({size, size}, T(1));
+    for (auto _ : state)
+    {
+        Tensor<T, 2> moved = std::move(source);
+        benchmark::DoNotOptimize(moved.Data());
+        source = std::move(moved);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_TensorConstruct, uint8_t)->Apply(SquareSizes);
+BENCHMARK_TEMPLATE(BM_TensorConstruct, float)->Apply(SquareSizes);
+BENCHMARK_TEMPLATE(BM_TensorConstructFilled, uint8_t)->Apply(SquareSizes);
+BENCHMARK_TEMPLATE(BM_TensorConstructFilled, float)->Apply(SquareSizes);
+BENCHMARK_TEMPLATE(BM_TensorCopy, uint8_t)->Apply(SquareSizes);
+BENCHMARK_TEMPLATE(BM_TensorCopy, float)->Apply(SquareSizes);
+BENCHMARK_TEMPLATE(BM_TensorMove, float)->Arg(2048)->UseRealTime();
+
+// ----- Arithmetic operators -----
+
+template <typename T, typename Operation>
+static void BM_TensorTensor(benchmark::State& state)
+{
+    size_t size = state.range(0);
+    Tensor<T, 2> left({size, size}, T(6));
+    Tensor<T, 2> right({size, size}, T(3));
+    Operation operation;
+    for (auto _ : state)
+    {
+        auto result = operation(left, right);
+        benchmark::DoNotOptimize(result.Data());
+    }
+    SetThroughput(state, size * size, 3 * sizeof(T));
+}
+
+template <typename T, typename Operation>
+static void BM_TensorScalar(benchmark::State& state)
+{
+    size_t size = state.range(0);
+    Tensor<T, 2> left({size, size}, T(6));
+    Operation operation;
+    for (auto _ : state)
+    {
+        auto result = operation(left, T(3));
+        benchmark::DoNotOptimize(result.Data());
+    }
+    SetThroughput(state, size * size, 2 * sizeof(T));
+}
+
+template <typename T, typename Operation>
+static void BM_ScalarTensor(benchmark::State& state)
+{
+    size_t size = state.range(0);
+    Tensor<T, 2> right({size, size}, T(3));
+    Operation operation;
+    for (auto _ : state)
+    {
+        auto result = operation(T(6), right);
+        benchmark::DoNotOptimize(result.Data());
+    }
+    SetThroughput(state, size * size, 2 * sizeof(T));
+}
+
+#define MATRIX_ARITHMETIC_BENCHMARKS(T)                                           \
+    BENCHMARK_TEMPLATE(BM_TensorTensor, T, std::plus<>)->Apply(SquareSizes);       \
+    BENCHMARK_TEMPLATE(BM_TensorTensor, T, std::minus<>)->Apply(SquareSizes);      \
+    BENCHMARK_TEMPLATE(BM_TensorTensor, T, std::multiplies<>)->Apply(SquareSizes); \
+    BENCHMARK_TEMPLATE(BM_TensorTensor, T, std::divides<>)->Apply(SquareSizes);    \
+    BENCHMARK_TEMPLATE(BM_TensorScalar, T, std::plus<>)->Apply(SquareSizes);       \
+    BENCHMARK_TEMPLATE(BM_TensorScalar, T, std::minus<>)->Apply(SquareSizes);      \
+    BENCHMARK_TEMPLATE(BM_TensorScalar, T, std::multiplies<>)->Apply(SquareSizes); \
+    BENCHMARK_TEMPLATE(BM_TensorScalar, T, std::divides<>)->Apply(SquareSizes);    \
+    BENCHMARK_TEMPLATE(BM_ScalarTensor, T, std::plus<>)->Apply(SquareSizes);       \
+    BENCHMARK_TEMPLATE(BM_ScalarTensor, T, std::minus<>)->Apply(SquareSizes);      \
+    BENCHMARK_TEMPLATE(BM_ScalarTensor, T, std::multiplies<>)->Apply(SquareSizes); \
+    BENCHMARK_TEMPLATE(BM_ScalarTensor, T, std::divides<>)->Apply(SquareSizes)
+
+MATRIX_ARITHMETIC_BENCHMARKS(uint8_t);
+MATRIX_ARITHMETIC_BENCHMARKS(int32_t);
+MATRIX_ARITHMETIC_BENCHMARKS(float);
+MATRIX_ARITHMETIC_BENCHMARKS(double);
+
+// ----- Parallel algorithms with user kernels -----
+
+// a * x + y through Transform, to set against BM_TensorTensor's built-in operators.
+template <typename T, Execution Policy>
+static void BM_TransformAxpy(benchmark::State& state)
+{
+    size_t size = state.range(0);
+    Tensor<T, 2> x({size, size}, T(6));
+    Tensor<T, 2> y({size, size}, T(3));
+    Tensor<T, 2> result({size, size});
+    for (auto _ : state)
+    {
+        Transform(Policy, x, y, result, [](T a, T b)
+        {
+            return static_cast<T>(T(2) * a + b);
+        });
+        benchmark::DoNotOptimize(result.Data());
+    }
+    SetThroughput(state, size * size, 3 * sizeof(T));
+}
+BENCHMARK_TEMPLATE(BM_TransformAxpy, float, Execution::Serial)->Apply(SquareSizes);
+BENCHMARK_TEMPLATE(BM_TransformAxpy, float, Execution::Parallel)->Apply(SquareSizes);
+BENCHMARK_TEMPLATE(BM_TransformAxpy, float, Execution::ParallelSimd)->Apply(SquareSizes);
+BENCHMARK_TEMPLATE(BM_TransformAxpy, uint8_t, Execution::Parallel)->Apply(SquareSizes);
+BENCHMARK_TEMPLATE(BM_TransformAxpy, uint8_t, Execution::ParallelSimd)->Apply(SquareSizes);
+
+// Sum of squares, ParallelSimd's running values break the dependency chain of one accumulator.
+template <Execution Policy>
+static void BM_TransformReduce(benchmark::State& state)
+{
+    size_t size = state.range(0);
+    Tensor<float, 2> values({size, size}, 0.5f);
+    for (auto _ : state)
+    {
+        float sum = TransformReduce(Policy, values, 0.0f, std::plus<float>(), [](float v)
+        {
+            return v * v;
+        });
+        benchmark::DoNotOptimize(sum);
+    }
+    SetThroughput(state, size * size, sizeof(float));
+}
+BENCHMARK_TEMPLATE(BM_TransformReduce, Execution::Serial)->Apply(SquareSizes);
+BENCHMARK_TEMPLATE(BM_TransformReduce, Execution::Parallel)->Apply(SquareSizes);
+BENCHMARK_TEMPLATE(BM_TransformReduce, Execution::ParallelSimd)->Apply(SquareSizes);
+
+// ----- Small per-pixel tensors, heap-backed against inline storage -----
+
+static void BM_SmallTensorDynamic(benchmark::State& state)
+{
+    float pixel = 0.5f;
+    for (auto _ : state)
+    {
+        Tensor<float, 2> colour({3, 3}, pixel);
+        Tensor<float, 2> weights({{0.2f, 0.7f, 0.1f}, {0.3f, 0.4f, 0.3f}, {0.1f, 0.1f, 0.8f}});
+        auto mixed = colour * weights + 0.5f;
+        benchmark::DoNotOptimize(mixed(1, 1));
+        pixel += 1.0f;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SmallTensorDynamic);
+
+static void BM_SmallTensorStatic(benchmark::State& state)
+{
+    float pixel = 0.5f;
+    for (auto _ : state)
+    {
+        StaticTensor<float, Extents<3, 3>> colour(pixel);
+        StaticTensor<float, Extents<3, 3>> weights = {{0.2f, 0.7f, 0.1f}, {0.3f, 0.4f, 0.3f}, {0.1f, 0.1f, 0.8f}};
+        auto mixed = colour * weights + 0.5f;
+        benchmark::DoNotOptimize(mixed(1, 1));
+        pixel += 1.0f;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SmallTensorStatic);
+
+// ----- Saturating narrow-type arithmetic -----
+
+// Interleaved RGB frame sizes as {height, width}.
+static void FrameSizes(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->Args({1080, 1920});
+    benchmark->Args({2160, 3840});
+    benchmark->UseRealTime();
+}
+
+template <SaturatingUnsigned T>
+static void BM_AddSaturate(benchmark::State& state)
+{
+    std::array<size_t, 3> shape = {size_t(state.range(0)), size_t(state.range(1)), 3};
+    Tensor<T, 3> left(shape, T(200));
+    Tensor<T, 3> right(shape, T(100));
+    for (auto _ : state)
+    {
+        auto result = AddSaturate(left, right);
+        benchmark::DoNotOptimize(result.Data());
+    }
+    SetThroughput(state, left.Size(), 3 * sizeof(T));
+}
+
+template <SaturatingUnsigned T>
+static void BM_MultiplySaturate(benchmark::State& state)
+{
+    std::array<size_t, 3> shape = {size_t(state.range(0)), size_t(state.range(1)), 3};
+    Tensor<T, 3> left(shape, T(20));
+    Tensor<T, 3> right(shape, T(30));
+    for (auto _ : state)
+    {
+        auto result = MultiplySaturate(left, right);
+        benchmark::DoNotOptimize(result.Data());
+    }
+    SetThroughput(state, left.Size(), 3 * sizeof(T));
+}
+
+template <SaturatingUnsigned T>
+static void BM_Blend(benchmark::State& state)
+{
+    std::array<size_t, 3> shape = {size_t(state.range(0)), size_t(state.range(1)), 3};
+    Tensor<T, 3> left(shape, T(200));
+    Tensor<T, 3> right(shape, T(100));
+    for (auto _ : state)
+    {
+        auto result = Blend(left, right, 0.3);
+        benchmark::DoNotOptimize(result.Data());
+    }
+    SetThroughput(state, left.Size(), 3 * sizeof(T));
+}
+
+// The same blend through promoting float arithmetic, the path saturating ops replace.
+static void BM_BlendPromoted(benchmark::State& state)
+{
+    std::array<size_t, 2> shape = {size_t(state.range(0)), size_t(state.range(1)) * 3};
+    Tensor<float, 2> left(shape, 200.0f);
+    Tensor<float, 2> right(shape, 100.0f);
+    for (auto _ : state)
+    {
+        auto result = left * 0.3f + right * 0.7f;
+        benchmark::DoNotOptimize(result.Data());
+    }
+    SetThroughput(state, shape[0] * shape[1], 3 * sizeof(float));
+}
+
+BENCHMARK_TEMPLATE(BM_AddSaturate, uint8_t)->Apply(FrameSizes);
+BENCHMARK_TEMPLATE(BM_AddSaturate, uint16_t)->Apply(FrameSizes);
+BENCHMARK_TEMPLATE(BM_MultiplySaturate, uint8_t)->Apply(FrameSizes);
+BENCHMARK_TEMPLATE(BM_MultiplySaturate, uint16_t)->Apply(FrameSizes);
+BENCHMARK_TEMPLATE(BM_Blend, uint8_t)->Apply(FrameSizes);
+BENCHMARK_TEMPLATE(BM_Blend, uint16_t)->Apply(FrameSizes);
+BENCHMARK(BM_BlendPromoted)->Apply(FrameSizes);
+
+// ----- Half precision conversion -----
+
+template <typename T>
+static void BM_ConvertToFloat(benchmark::State& state)
+{
+    size_t size = state.range(0);
+    Tensor<T, 2> source({size, size}, T(0.75f));
+    for (auto _ : state)
+    {
+        auto result = TensorCast<float>(source);
+        benchmark::DoNotOptimize(result.Data());
+    }
+    SetThroughput(state, size * size, sizeof(T) + sizeof(float));
+}
+
+template <typename T>
+static void BM_ConvertFromFloat(benchmark::State& state)
+{
+    size_t size = state.range(0);
+    Tensor<float, 2> source({size, size}, 0.75f);
+    for (auto _ : state)
+    {
+        auto result = TensorCast<T>(source);
+        benchmark::DoNotOptimize(result.Data());
+    }
+    SetThroughput(state, size * size, sizeof(T) + sizeof(float));
+}
+
+BENCHMARK_TEMPLATE(BM_ConvertToFloat, Float16)->Apply(SquareSizes);
+BENCHMARK_TEMPLATE(BM_ConvertToFloat, BFloat16)->Apply(SquareSizes);
+BENCHMARK_TEMPLATE(BM_ConvertFromFloat, Float16)->Apply(SquareSizes);
+BENCHMARK_TEMPLATE(BM_ConvertFromFloat, BFloat16)->Apply(SquareSizes);
+BENCHMARK_TEMPLATE(BM_TensorTensor, Float16, std::plus<>)->Apply(SquareSizes);
+
+// ----- Tiled layout, access patterns that cross rows -----
+
+// Side lengths where a float row spans many pages, so row-major column walks miss the TLB.
+static void LargeSquareSizes(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->Arg(1024)->Arg(4096);
+    benchmark->UseRealTime();
+}
+
+static void BM_TransposeRowMajor(benchmark::State& state)
+{
+    size_t size = state.range(0);
+    Tensor<float, 2> input({size, size}, 1.0f);
+    Tensor<float, 2> output({size, size});
+    for (auto _ : state)
+    {
+        Dispatch2d(size, size, [&](size_t y, size_t x)
+        {
+            output(x, y) = input(y, x);
+        });
+        benchmark::DoNotOptimize(output.Data());
+    }
+    SetThroughput(state, size * size, 2 * sizeof(float));
+}
+
+template <size_t TileSize>
+static void BM_TransposeTiled(benchmark::State& state)
+{
+    size_t size = state.range(0);
+    Tensor<float, 2, Tiled<TileSize>> input({size, size}, 1.0f);
+    Tensor<float, 2, Tiled<TileSize>> output({size, size});
+    for (auto _ : state)
+    {
+        DispatchTiles(input, [&](size_t y, size_t x)
+        {
+            output(x, y) = input(y, x);
+        });
+        benchmark::DoNotOptimize(output.Data());
+    }
+    SetThroughput(state, size * size, 2 * sizeof(float));
+}
+
+// 5-tap binomial filter down each column, walked column by column as a vertical pass is.
+template <typename Layout>
+static void VerticalBlur(Tensor<float, 2, Layout> const& input, Tensor<float, 2, Layout>& output, size_t y, size_t x)
+{
+    size_t last = input.Shape()[0] - 1;
+    float sum   = 6.0f * input(y, x);
+    sum += 4.0f * (input(y > 0 ? y - 1 : 0, x) + input(std::min(y + 1, last), x));
+    sum += input(y > 1 ? y - 2 : 0, x) + input(std::min(y + 2, last), x);
+    output(y, x) = sum * (1.0f / 16.0f);
+}
+
+static void BM_VerticalBlurRowMajor(benchmark::State& state)
+{
+    size_t size = state.range(0);
+    Tensor<float, 2> input({size, size}, 1.0f);
+    Tensor<float, 2> output({size, size});
+    for (auto _ : state)
+    {
+        Dispatch2d(size, size, [&](size_t x, size_t y)
+        {
+            VerticalBlur(input, output, y, x);
+        });
+        benchmark::DoNotOptimize(output.Data());
+    }
+    SetThroughput(state, size * size, 2 * sizeof(float));
+}
+
+template <size_t TileSize>
+static void BM_VerticalBlurTiled(benchmark::State& state)
+{
+    size_t size = state.range(0);
+    Tensor<float, 2, Tiled<TileSize>> input({size, size}, 1.0f);
+    Tensor<float, 2, Tiled<TileSize>> output({size, size});
+    for (auto _ : state)
+    {
+        DispatchTiles(input, [&](size_t y, size_t x)
+        {
+            VerticalBlur(input, output, y, x);
+        });
+        benchmark::DoNotOptimize(output.Data());
+    }
+    SetThroughput(state, size * size, 2 * sizeof(float));
+}
+
+template <size_t TileSize>
+static void BM_ToTiled(benchmark::State& state)
+{
+    size_t size = state.range(0);
+    Tensor<float, 2> input({size, size}, 1.0f);
+    for (auto _ : state)
+    {
+        auto tiled = ToTiled<TileSize>(input);
+        benchmark::DoNotOptimize(tiled.Data());
+    }
+    SetThroughput(state, size * size, 2 * sizeof(float));
+}
+
+BENCHMARK(BM_TransposeRowMajor)->Apply(LargeSquareSizes);
+BENCHMARK_TEMPLATE(BM_TransposeTiled, 32)->Apply(LargeSquareSizes);
+BENCHMARK_TEMPLATE(BM_TransposeTiled, 64)->Apply(LargeSquareSizes);
+BENCHMARK(BM_VerticalBlurRowMajor)->Apply(LargeSquareSizes);
+BENCHMARK_TEMPLATE(BM_VerticalBlurTiled, 32)->Apply(LargeSquareSizes);
+BENCHMARK_TEMPLATE(BM_VerticalBlurTiled, 64)->Apply(LargeSquareSizes);
+BENCHMARK_TEMPLATE(BM_ToTiled, 32)->Apply(LargeSquareSizes);
+
+// ----- File-backed storage -----
+
+// Fills an RGB image through a file mapping with banded prefetch and release, against the same fill on the heap.
+#if defined(MATRIX_MAPPED_STORAGE)
+static void BM_StreamingFillMapped(benchmark::State& state)
+{
+    size_t size = state.range(0);
+    auto image  = Tensor<uint8_t, 3>::Mapped("benchmark_mapped.rgb", {size, size, 3});
+    for (auto _ : state)
+    {
+        DispatchStreaming(size, size, [&](size_t y, size_t x)
+        {
+            image(y, x, 0) = static_cast<uint8_t>(x);
+            image(y, x, 1) = static_cast<uint8_t>(y);
+            image(y, x, 2) = static_cast<uint8_t>(x ^ y);
+        }, image);
+        image.Flush();
+    }
+    SetThroughput(state, size * size, 3);
+    std::remove("benchmark_mapped.rgb");
+}
+BENCHMARK(BM_StreamingFillMapped)->Arg(4096)->Unit(benchmark::kMillisecond)->UseRealTime();
+#endif
+
+static void BM_StreamingFillHeap(benchmark::State& state)
+{
+    size_t size = state.range(0);
+    Tensor<uint8_t, 3> image({size, size, 3});
+    for (auto _ : state)
+    {
+        DispatchStreaming(size, size, [&](size_t y, size_t x)
+        {
+            image(y, x, 0) = static_cast<uint8_t>(x);
+            image(y, x, 1) = static_cast<uint8_t>(y);
+            image(y, x, 2) = static_cast<uint8_t>(x ^ y);
+        }, image);
+        benchmark::DoNotOptimize(image.Data());
+    }
+    SetThroughput(state, size * size, 3);
+}
+
+BENCHMARK(BM_StreamingFillHeap)->Arg(4096)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// ----- Dispatcher -----
+
+// Cost of a dispatch whose per-element work is empty, i.e. pure tiling and scheduling overhead.
+static void BM_Dispatch2dOverhead(benchmark::State& state)
+{
+    size_t size = state.range(0);
+    for (auto _ : state)
+    {
+        Dispatch2d(size, size, [](size_t y, size_t x)
+        {
+            benchmark::DoNotOptimize(y + x);
+        });
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(size * size));
+}
+BENCHMARK(BM_Dispatch2dOverhead)->Arg(1)->Arg(256)->Arg(1024)->Arg(4096)->UseRealTime();
+
+static void BM_Dispatch1dOverhead(benchmark::State& state)
+{
+    size_t size = state.range(0);
+    for (auto _ : state)
+    {
+        Dispatch1d(size, [](size_t i)
+        {
+            benchmark::DoNotOptimize(i);
+        });
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(size));
+}
+BENCHMARK(BM_Dispatch1dOverhead)->Arg(1)->Arg(1 << 16)->Arg(1 << 22)->UseRealTime();
+
+// Tensor addition with every dispatch fixed to the old 256x256 blocks, against the shape tuned on first use.
+template <bool Tuned>
+static void BM_AddBlockShape(benchmark::State& state)
+{
+    size_t size  = state.range(0);
+    auto& tuning = DispatchTuning::Instance();
+    tuning.SetFixed(Tuned ? std::nullopt : std::optional<TileShape>(TileShape{256, 256}));
+
+    Tensor<float, 2> a({size, size}, 1.0f);
+    Tensor<float, 2> b({size, size}, 2.0f);
+    auto warm_up = a + b;
+    for (auto _ : state)
+    {
+        auto sum = a + b;
+        benchmark::DoNotOptimize(sum.Data());
+    }
+    tuning.SetFixed(std::nullopt);
+    SetThroughput(state, size * size, 3 * sizeof(float));
+}
+BENCHMARK_TEMPLATE(BM_AddBlockShape, false)->Arg(64)->Arg(512)->Arg(2048)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_AddBlockShape, true)->Arg(64)->Arg(512)->Arg(2048)->UseRealTime();
+
+// Two outer blocks each running a nested dispatch. Inline leaves all but two workers idle, Join
+// spreads the inner blocks over the pool.
+template <NestedDispatch Policy>
+static void BM_NestedDispatch(benchmark::State& state)
+{
+    size_t size = state.range(0);
+    Tensor<float, 2> output({2 * size, size});
+    SetNestedDispatch(Policy);
+    for (auto _ : state)
+    {
+        DispatchRange(2, 1, [&](size_t start, size_t stop)
+        {
+            for (size_t outer = start; outer < stop; ++outer)
+            {
+                Dispatch2d(size, size, [&](size_t y, size_t x)
+                {
+                    output(outer * size + y, x) = std::sqrt(static_cast<float>(y * x));
+                });
+            }
+        });
+        benchmark::DoNotOptimize(output.Data());
+    }
+    SetNestedDispatch(NestedDispatch::Inline);
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(2 * size * size));
+}
+BENCHMARK_TEMPLATE(BM_NestedDispatch, NestedDispatch::Inline)->Arg(1024)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_NestedDispatch, NestedDispatch::Join)->Arg(1024)->UseRealTime();
+
+// ----- ThreadPool -----
+
+// Empty tasks pushed through the shared dispatch pool, measures queue throughput.
+static void BM_ThreadPoolThroughput(benchmark::State& state)
+{
+    size_t tasks            = state.range(0);
+    ThreadPool& thread_pool = DispatchThreadPool();
+    for (auto _ : state)
+    {
+        std::latch done(tasks);
+        for (size_t i = 0; i < tasks; ++i)
+        {
+            thread_pool.Enqueue([&done]()
+            {
+                done.count_down();
+            });
+        }
+        done.wait();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(tasks));
+}
+BENCHMARK(BM_ThreadPoolThroughput)->Arg(64)->Arg(4096)->UseRealTime();
+
+// Spawning and joining a full pool, the cost paid per call before dispatch reused one pool.
+static void BM_ThreadPoolSpawn(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        ThreadPool thread_pool;
+        thread_pool.Wait();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ThreadPoolSpawn)->UseRealTime();
@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+"""Compare a Google Benchmark JSON run against a stored baseline.
+
+Usage:
+    compare.py BASELINE.json CURRENT.json [--threshold 0.10] [--metric real_time]
+
+Benchmarks present in both files are matched by name. A benchmark regresses when
+its time grows by more than the threshold (a fraction, 0.10 = 10%). The script
+prints a table of every matched benchmark and exits with status 1 if any regressed.
+
+To store a new baseline, build the benchmark_baseline target, which copies the JSON
+written by benchmark_json over tests/benchmark/baseline.json (or the file named by
+MATRIX_BENCHMARK_BASELINE). Without a baseline there is nothing to compare, so the
+script says so and exits with status 0.
+"""
+
+import argparse
+import json
+import os
+import sys
+
+UNIT_SCALE = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load(path, metric):
+    with open(path) as handle:
+        report = json.load(handle)
+
+    results = {}
+    for entry in report.get("benchmarks", []):
+        # with repetitions only compare the aggregate mean
+        if entry.get("run_type") == "aggregate" and entry.get("aggregate_name") != "mean":
+            continue
+        if entry.get("error_occurred"):
+            continue
+        name = entry.get("run_name", entry["name"])
+        results[name] = entry[metric] * UNIT_SCALE[entry.get("time_unit", "ns")]
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=0.10)
+    parser.add_argument("--metric", choices=["real_time", "cpu_time"], default="real_time")
+    args = parser.parse_args()
+
+    if not os.path.exists(args.baseline):
+        print(f"no baseline at {args.baseline}, skipping the comparison")
+        print("build the benchmark_baseline target to record the current run as the baseline")
+        return 0
+
+    baseline = load(args.baseline, args.metric)
+    current = load(args.current, args.metric)
+
+    matched = sorted(set(baseline) & set(current))
+    if not matched:
+        print("no benchmarks in common between baseline and current run")
+        return 1
+
+    width = max(len(name) for name in matched)
+    regressions = []
+
+    print(f"{'benchmark':<{width}}  {'baseline':>12}  {'current':>12}  {'change':>8}")
+    for name in matched:
+        before, after = baseline[name], current[name]
+        change = (after - before) / before if before > 0 else 0.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            regressions.append(name)
+        print(f"{name:<{width}}  {before:>10.0f}ns  {after:>10.0f}ns  {change:>+7.1%}{flag}")
+
+    for name in sorted(set(baseline) - set(current)):
+        print(f"missing from current run: {name}")
+
+    if regressions:
+        print(f"\n{len(regressions)} of {len(matched)} benchmarks regressed by more than {args.threshold:.0%}")
+        return 1
+
+    print(f"\nno regressions beyond {args.threshold:.0%} across {len(matched)} benchmarks")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,22 +1,54 @@
 // clang-format off
 
+#include <algorithm>
 #include <atomic>
+#include <cmath>
 #include <cstdio>
+#include <filesystem>
 #include <fstream>
 #include <gtest/gtest.h>
+#include <latch>
+#include <numeric>
+#include <ranges>
+#include <sstream>
+#include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 #include <stdexcept>
 
+#include <Algorithm.hpp>
 #include <Arithmetic.hpp>
+#include <Async.hpp>
+#include <ColorSpace.hpp>
+#include <Conversion.hpp>
 #include <Dispatcher.hpp>
 #include <Expect.hpp>
+#include <Filter.hpp>
+#include <Half.hpp>
+#include <Histogram.hpp>
+#include <ImageLoader.hpp>
+#include <Morphology.hpp>
 #include <Number.hpp>
 #include <PNG.hpp>
 #include <PPM.hpp>
+#include <Pyramid.hpp>
+#include <Saturating.hpp>
+#include <StaticTensor.hpp>
+#include <TaskGraph.hpp>
 #include <Tensor.hpp>
 #include <TensorInitializer.hpp>
 #include <ThreadPool.hpp>
+#include <Topology.hpp>
+#include <Tiling.hpp>
+#include <Trace.hpp>
+#include <Tuning.hpp>
+#include <Warp.hpp>
+
+#include <Animation.hpp>
+#include <Distributed.hpp>
+#include <Mandelbrot.hpp>
+#include <Progressive.hpp>
 
 static const Tensor<int, 1> v1 = { 1, 2 };
 
@@ -162,6 +194,32 @@ TEST(TensorTest, DifferentNumericTypesAndInteractions)
     EXPECT_FLOAT_EQ(result(0, 0), 4.5f);
 }
 
+TEST(TensorTest, IteratorsAndRowSpans)
+{
+    static_assert(std::ranges::contiguous_range<Tensor<float, 2>>);
+    static_assert(std::ranges::contiguous_range<Tensor<uint8_t, 3> const>);
+
+    Tensor<int, 2> t({3, 4});
+    std::iota(t.begin(), t.end(), 0);
+    EXPECT_EQ(t(2, 1), 9);
+    EXPECT_EQ(std::ranges::distance(t), 12);
+
+    auto row = t.Row(1);
+    EXPECT_EQ(row.size(), 4u);
+    EXPECT_EQ(row[2], 6);
+    std::ranges::reverse(row);
+    EXPECT_EQ(t(1, 0), 7);
+
+    // a pixel row holds every channel, a plane one channel of a planar image
+    Tensor<uint8_t, 3> image({2, 5, 3}, 1);
+    EXPECT_EQ(image.Row(1).size(), 15u);
+    auto planar = ToPlanar(image);
+    std::ranges::fill(planar.Plane(2), uint8_t(9));
+    EXPECT_EQ(planar(2, 1, 4), 9);
+    EXPECT_EQ(planar(1, 1, 4), 1);
+    EXPECT_EQ(std::ranges::count(std::as_const(planar), 9), 10);
+}
+
 // ----- Arithmetic (Tensor operator overloads) tests -----
 TEST(ArithmeticTest, TensorAddition)
 {
@@ -174,56 +232,2002 @@ TEST(ArithmeticTest, TensorAddition)
     EXPECT_EQ(c(1, 1), 3);
 }
 
-// ----- Dispatcher tests -----
-TEST(DispatcherTest, Dispatch2dCallsCorrectly)
+TEST(ArithmeticTest, ScalarOperators)
 {
-    std::vector<std::pair<size_t, size_t>> indices;
-    // Use a 3x3 area so we expect 9 calls.
-    Dispatch2d(3, 3, [&indices](size_t y, size_t x)
+    Tensor<int, 2> a({2, 3}, 6);
+
+    auto filled = [](int value)
     {
-        indices.emplace_back(y, x);
+        return Tensor<int, 2>({2, 3}, value);
+    };
+
+    EXPECT_EQ(a + 2, filled(8));
+    EXPECT_EQ(2 + a, filled(8));
+    EXPECT_EQ(a - 2, filled(4));
+    EXPECT_EQ(2 - a, filled(-4));
+    EXPECT_EQ(a * 2, filled(12));
+    EXPECT_EQ(2 * a, filled(12));
+    EXPECT_EQ(a / 2, filled(3));
+    EXPECT_EQ(12 / a, filled(2));
+
+    auto promoted = a * 0.5;
+    EXPECT_DOUBLE_EQ(promoted(1, 2), 3.0);
+}
+
+// ----- Algorithm tests -----
+TEST(AlgorithmTest, PoliciesAgreeOnTransformForEachAndGenerate)
+{
+    // 300 x 251 is not a multiple of the block size, so every policy has a ragged last block
+    for (Execution policy : {Execution::Serial, Execution::Parallel, Execution::ParallelSimd})
+    {
+        Tensor<float, 2> field({300, 251});
+        Generate(policy, field, [](size_t y, size_t x)
+        {
+            return static_cast<float>(y) - 0.5f * static_cast<float>(x);
+        });
+        EXPECT_EQ(field(299, 250), 299.0f - 125.0f);
+
+        Tensor<int16_t, 2> clamped({300, 251});
+        Transform(policy, field, clamped, [](float v)
+        {
+            return std::clamp(v, -100.0f, 100.0f);
+        });
+        EXPECT_EQ(clamped(0, 250), -100);
+        EXPECT_EQ(clamped(150, 100), 100);
+
+        Tensor<float, 2> sum({300, 251});
+        Transform(policy, field, clamped, sum, [](float a, int16_t b)
+        {
+            return a - b;
+        });
+        EXPECT_EQ(sum(10, 10), 0.0f);
+        EXPECT_EQ(sum(299, 0), 199.0f);
+
+        ForEach(policy, sum, [](float& v)
+        {
+            v *= 2.0f;
+        });
+        EXPECT_EQ(sum(299, 0), 398.0f);
+
+        Tensor<uint8_t, 3> rgb({7, 9, 3});
+        Generate(policy, rgb, [](size_t y, size_t x, size_t c)
+        {
+            return static_cast<uint8_t>(y * 100 + x * 10 + c);
+        });
+        EXPECT_EQ(rgb(6, 8, 2), 682 % 256);
+    }
+}
+
+TEST(AlgorithmTest, TransformReduceIsReproducible)
+{
+    Tensor<float, 1> values(std::array<size_t, 1>{100003});
+    Generate(Execution::Parallel, values, [](size_t i)
+    {
+        return 1.0f / static_cast<float>(i + 1);
     });
-    EXPECT_EQ(indices.size(), 9);
-    // Optionally check that certain indices were covered.
-    bool found00 = false, found11 = false, found22 = false;
-    for (auto& idx : indices)
+
+    auto plus = [](double a, double b)
     {
-        if (idx.first == 0 && idx.second == 0)
+        return a + b;
+    };
+    auto square = [](float v)
+    {
+        return static_cast<double>(v) * v;
+    };
+
+    // blocks are fixed and combined in order, so serial and parallel agree exactly
+    double serial   = TransformReduce(Execution::Serial, values, 0.0, plus, square);
+    double parallel = TransformReduce(Execution::Parallel, values, 0.0, plus, square);
+    double simd     = TransformReduce(Execution::ParallelSimd, values, 0.0, plus, square);
+    EXPECT_EQ(serial, parallel);
+    EXPECT_NEAR(simd, serial, 1e-12);
+    EXPECT_NEAR(serial, 1.6449240671982304, 1e-7); // the float reciprocals round
+
+    Tensor<uint8_t, 2> bytes({123, 457}, 3);
+    auto count = TransformReduce(Execution::ParallelSimd, bytes, uint64_t(7), std::plus<uint64_t>(), [](uint8_t v)
+    {
+        return uint64_t(v);
+    });
+    EXPECT_EQ(count, 7u + 3u * 123u * 457u);
+    EXPECT_EQ(TransformReduce(Execution::Parallel, Tensor<int, 1>(std::array<size_t, 1>{0}), 5, std::plus<int>(), [](int v)
+    {
+        return v;
+    }), 5);
+}
+
+// ----- Tiled layout tests -----
+TEST(TiledLayoutTest, IndexesTilesInStorageOrder)
+{
+    // 10x10 in 4x4 tiles pads to 12x12, three tiles across
+    Tensor<int, 2, Tiled<4>> tiled({10, 10}, 0);
+    EXPECT_EQ(tiled.Size(), 100);
+    EXPECT_EQ(tiled.StorageSize(), 144);
+
+    tiled(0, 5) = 1; // second tile, row 0, column 1
+    tiled(5, 0) = 2; // fourth tile, row 1, column 0
+    EXPECT_EQ(tiled.Data()[16 + 1], 1);
+    EXPECT_EQ(tiled.Data()[48 + 4], 2);
+
+    Tensor<int, 3, Tiled<4>> image({5, 6, 3}, 0);
+    image(4, 5, 2) = 9; // tile (1, 1), channels innermost
+    EXPECT_EQ(image.Data()[(3 * 16 + 0 * 4 + 1) * 3 + 2], 9);
+}
+
+TEST(TiledLayoutTest, ConvertsToAndFromRowMajor)
+{
+    Tensor<int, 2> matrix({37, 70});
+    Tensor<uint8_t, 3> image({19, 33, 3});
+    for (size_t i = 0; i < matrix.Size(); ++i)
+    {
+        matrix.Data()[i] = static_cast<int>(i);
+    }
+    for (size_t i = 0; i < image.Size(); ++i)
+    {
+        image.Data()[i] = static_cast<uint8_t>(i * 7);
+    }
+
+    auto tiled = ToTiled<16>(matrix);
+    EXPECT_EQ(tiled(36, 69), matrix(36, 69));
+    EXPECT_EQ(tiled(17, 3), matrix(17, 3));
+    EXPECT_EQ(ToRowMajor(tiled), matrix);
+
+    auto tiled_image = ToTiled<8>(image);
+    EXPECT_EQ(tiled_image(18, 32, 1), image(18, 32, 1));
+    EXPECT_EQ(ToRowMajor(tiled_image), image);
+
+    Tensor<int, 2, Tiled<4>> listed = { { 1, 2, 3, 4, 5 }, { 6, 7, 8, 9, 10 } };
+    EXPECT_EQ(ToRowMajor(listed), (Tensor<int, 2>{ { 1, 2, 3, 4, 5 }, { 6, 7, 8, 9, 10 } }));
+}
+
+TEST(TiledLayoutTest, TileIteratorAndDispatchCoverEveryElement)
+{
+    Tensor<int, 2, Tiled<8>> tiled({20, 27}, 0);
+
+    size_t tiles    = 0;
+    size_t elements = 0;
+    for (auto tile : Tiles(tiled))
+    {
+        EXPECT_EQ(tile.y_start, tile.tile_y * 8);
+        for (size_t y = 0; y < tile.height; ++y)
         {
-            found00 = true;
+            for (size_t x = 0; x < tile.width; ++x)
+            {
+                tile(y, x) += 1;
+                ++elements;
+            }
         }
-        if (idx.first == 1 && idx.second == 1)
+        ++tiles;
+    }
+    EXPECT_EQ(tiles, 3 * 4);
+    EXPECT_EQ(elements, tiled.Size());
+    EXPECT_EQ(tiled, (Tensor<int, 2, Tiled<8>>({20, 27}, 1)));
+
+    std::vector<std::atomic<int>> visits(tiled.Size());
+    DispatchTiles(tiled, [&](size_t y, size_t x)
+    {
+        visits[y * 27 + x]++;
+    });
+    for (auto const& count : visits)
+    {
+        EXPECT_EQ(count.load(), 1);
+    }
+}
+
+// ----- Mapped storage tests -----
+#if defined(MATRIX_MAPPED_STORAGE)
+TEST(MappedTensorTest, PersistsThroughTheFile)
+{
+    {
+        auto mapped = Tensor<uint16_t, 2>::Mapped("mapped_test.bin", {300, 500});
+        EXPECT_TRUE(mapped.IsMapped());
+        EXPECT_EQ(mapped(299, 499), 0); // a created file reads as zeros
+
+        DispatchStreaming(300, 500, [&](size_t y, size_t x)
         {
-            found11 = true;
+            mapped(y, x) = static_cast<uint16_t>(y * 500 + x);
+        }, mapped);
+        mapped.Flush();
+
+        Tensor<uint16_t, 2> copy = mapped;
+        EXPECT_FALSE(copy.IsMapped());
+        EXPECT_EQ(copy, mapped);
+    }
+
+    std::ifstream infile("mapped_test.bin", std::ios::binary | std::ios::ate);
+    EXPECT_EQ(static_cast<size_t>(infile.tellg()), 300 * 500 * sizeof(uint16_t));
+    infile.close();
+
+    auto reopened = Tensor<uint16_t, 2>::Mapped("mapped_test.bin", {300, 500}, MapMode::Open);
+    EXPECT_EQ(reopened(123, 456), static_cast<uint16_t>(123 * 500 + 456));
+    EXPECT_THROW((Tensor<uint16_t, 2>::Mapped("mapped_test.bin", {10, 10}, MapMode::Open)), std::runtime_error);
+
+    std::remove("mapped_test.bin");
+}
+
+TEST(MappedTensorTest, PosterMatchesInMemoryRender)
+{
+    auto poster = GenerateMandelbrotPoster("poster_test.rgb", 40, 70, Colormap::Magma);
+    EXPECT_EQ(poster, GenerateMandelbrotImage(40, 70, Colormap::Magma));
+    std::remove("poster_test.rgb");
+}
+#endif
+
+// ----- StaticTensor tests -----
+TEST(StaticTensorTest, ConstexprConstructionAndArithmetic)
+{
+    constexpr StaticTensor<int, Extents<2, 3>> a =
+    {
+        { 1, 2, 3 },
+        { 4, 5, 6 },
+    };
+    constexpr StaticTensor<int, Extents<2, 3>> b(10);
+
+    static_assert(sizeof(a) == 6 * sizeof(int)); // stored inline
+    static_assert(a(1, 2) == 6);
+    static_assert((a + b)(0, 1) == 12);
+    static_assert((b - a)(1, 0) == 6);
+    static_assert((a * 2)(1, 1) == 10);
+    static_assert((12 / a)(0, 2) == 4);
+
+    constexpr StaticTensor<float, Extents<3>> kernel = { 0.25f, 0.5f, 0.25f };
+    constexpr auto mixed = kernel * StaticTensor<int, Extents<3>>(4);
+    static_assert(std::is_same_v<decltype(mixed), const StaticTensor<float, Extents<3>>>);
+    static_assert(mixed == StaticTensor<float, Extents<3>>{ 1.0f, 2.0f, 1.0f });
+
+    EXPECT_EQ(a.ToTensor(), m2);
+    EXPECT_EQ(a.ToTensor() + b.ToTensor(), (a + b).ToTensor());
+}
+
+TEST(StaticTensorTest, InitializerMustMatchExtents)
+{
+    auto make = [](TensorInitializer<int, 2> const& initializer)
+    {
+        return StaticTensor<int, Extents<2, 2>>(initializer);
+    };
+    EXPECT_NO_THROW(make({ { 1, 2 }, { 3, 4 } }));
+    EXPECT_THROW(make({ { 1, 2, 3 }, { 4, 5, 6 } }), std::runtime_error);
+    EXPECT_THROW(make({ { 1, 2 } }), std::runtime_error);
+
+    StaticTensor<int, Extents<2, 2, 2>> cube(1);
+    cube(1, 0, 1) = 7;
+    EXPECT_EQ(cube.Data()[5], 7);
+}
+
+// ----- Saturating arithmetic tests -----
+TEST(SaturatingTest, Uint8AddSubtractMultiplyClamp)
+{
+    // 40 elements so both the vector body and the scalar tail are exercised
+    Tensor<uint8_t, 2> a({2, 20}, 200);
+    Tensor<uint8_t, 2> b({2, 20}, 100);
+    a(1, 19) = 10;
+
+    auto sum = AddSaturate(a, b);
+    EXPECT_EQ(sum(0, 0), 255);
+    EXPECT_EQ(sum(1, 19), 110);
+
+    auto difference = SubtractSaturate(b, a);
+    EXPECT_EQ(difference(0, 0), 0);
+    EXPECT_EQ(difference(1, 19), 90);
+
+    Tensor<uint8_t, 2> small({2, 20}, 3);
+    auto product = MultiplySaturate(a, small);
+    EXPECT_EQ(product(0, 0), 255);
+    EXPECT_EQ(product(1, 19), 30);
+}
+
+TEST(SaturatingTest, Uint16AddSubtractMultiplyClamp)
+{
+    Tensor<uint16_t, 1> a({19}, 60000);
+    Tensor<uint16_t, 1> b({19}, 10000);
+    a(18) = 300;
+
+    EXPECT_EQ(AddSaturate(a, b)(0), 65535);
+    EXPECT_EQ(AddSaturate(a, b)(18), 10300);
+    EXPECT_EQ(SubtractSaturate(b, a)(0), 0);
+    EXPECT_EQ(SubtractSaturate(b, a)(18), 9700);
+    EXPECT_EQ(MultiplySaturate(a, b)(0), 65535);
+
+    Tensor<uint16_t, 1> c({19}, 200);
+    EXPECT_EQ(MultiplySaturate(a, c)(18), 60000);
+}
+
+TEST(SaturatingTest, FixedPointScaleAndBlendMatchRoundedReference)
+{
+    Tensor<uint8_t, 3> a({4, 5, 3}, 0);
+    Tensor<uint8_t, 3> b({4, 5, 3}, 0);
+    for (size_t i = 0; i < a.Size(); ++i)
+    {
+        a.Data()[i] = static_cast<uint8_t>(i * 17);
+        b.Data()[i] = static_cast<uint8_t>(255 - i * 5);
+    }
+
+    auto scaled  = Scale(a, 1.5);
+    auto blended = Blend(a, b, 0.25);
+    for (size_t i = 0; i < a.Size(); ++i)
+    {
+        EXPECT_EQ(scaled.Data()[i], std::min(255, (a.Data()[i] * 384 + 128) >> 8));
+        EXPECT_EQ(blended.Data()[i], (a.Data()[i] * 64 + b.Data()[i] * 192 + 128) >> 8);
+    }
+
+    EXPECT_EQ(Blend(a, b, 1.0), a);
+    EXPECT_EQ(Blend(a, b, 0.0), b);
+
+    Tensor<uint16_t, 2> c({3, 3}, 40000);
+    Tensor<uint16_t, 2> d({3, 3}, 20000);
+    EXPECT_EQ(Blend(c, d, 0.5)(1, 1), 30000);
+    EXPECT_EQ(Scale(c, 1.9)(2, 2), 65535);
+
+    // factors of 2.0 and above keep their integer part rather than capping near 2.0
+    Tensor<uint16_t, 1> e({4}, 10000);
+    EXPECT_EQ(Scale(e, 4.0), (Tensor<uint16_t, 1>({4}, 40000)));
+    EXPECT_EQ(Scale(e, 2.5)(3), 25000);
+    EXPECT_EQ(Scale(e, 1e9)(0), 65535);
+    EXPECT_EQ(Scale(Tensor<uint8_t, 1>({20}, 1), 300.0), (Tensor<uint8_t, 1>({20}, 255)));
+}
+
+// ----- Histogram tests -----
+TEST(HistogramTest, ParallelCountsMatchSerialCount)
+{
+    // more pixels than one private histogram block, so several partial histograms are merged
+    Tensor<uint8_t, 3> rgb({1031, 1025, 3});
+    for (size_t i = 0; i < rgb.Size(); ++i)
+    {
+        rgb.Data()[i] = static_cast<uint8_t>((i * 2654435761u) >> 13);
+    }
+
+    std::vector<uint64_t> expected(3 * 256, 0);
+    for (size_t i = 0; i < rgb.Size(); ++i)
+    {
+        ++expected[(i % 3) * 256 + rgb.Data()[i]];
+    }
+
+    auto histogram = Histogram(rgb);
+    EXPECT_EQ(histogram.Shape(), (std::array<size_t, 2>{3, 256}));
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+        EXPECT_EQ(histogram.Data()[i], expected[i]);
+    }
+
+    Tensor<float, 2> values({{-1.0f, 0.0f, 0.49f, 0.5f, 1.0f, NAN}});
+    auto binned = Histogram(values, 2, 0.0, 1.0);
+    EXPECT_EQ(binned(0, 0), 3u);
+    EXPECT_EQ(binned(0, 1), 2u);
+
+    // infinities and values far past the range clamp into the end bins
+    Tensor<float, 2> extremes({{INFINITY, 1e30f, 3.4e38f, -INFINITY, -1e30f}});
+    auto clamped = Histogram(extremes, 4, 0.0, 1.0);
+    EXPECT_EQ(clamped(0, 0), 2u);
+    EXPECT_EQ(clamped(0, 3), 3u);
+
+    Tensor<double, 2> wide({{1e300, -1e300, 0.3}});
+    auto clamped_wide = Histogram(wide, 10, 0.0, 1.0);
+    EXPECT_EQ(clamped_wide(0, 0), 1u);
+    EXPECT_EQ(clamped_wide(0, 3), 1u);
+    EXPECT_EQ(clamped_wide(0, 9), 1u);
+}
+
+TEST(HistogramTest, ApplyLutMatchesScalarLookup)
+{
+    // odd pixel counts exercise the vector body and the scalar tail
+    for (size_t channels : {1, 3})
+    {
+        Tensor<uint8_t, 3> image({37, 61, channels});
+        for (size_t i = 0; i < image.Size(); ++i)
+        {
+            image.Data()[i] = static_cast<uint8_t>(i * 7 + i / 5);
         }
-        if (idx.first == 2 && idx.second == 2)
+
+        Tensor<uint8_t, 2> luts({channels, 256});
+        for (size_t i = 0; i < luts.Size(); ++i)
         {
-            found22 = true;
+            luts.Data()[i] = static_cast<uint8_t>(i * 13 + 5);
+        }
+
+        auto mapped = ApplyLut(image, luts);
+        for (size_t i = 0; i < image.Size(); ++i)
+        {
+            ASSERT_EQ(mapped.Data()[i], luts.Data()[(i % channels) * 256 + image.Data()[i]]);
         }
+
+        ApplyLut(image, luts, image);
+        EXPECT_EQ(image, mapped);
     }
-    EXPECT_TRUE(found00);
-    EXPECT_TRUE(found11);
-    EXPECT_TRUE(found22);
 }
 
-// ----- ThreadPool tests -----
-TEST(ThreadPoolTest, EnqueueAndExecute)
+TEST(HistogramTest, EqualizeAndAutoLevelsStretchToFullRange)
 {
-    std::atomic<int> counter(0);
+    Tensor<uint8_t, 2> gray({4, 25});
+    for (size_t i = 0; i < gray.Size(); ++i)
     {
-        // Create a thread pool with 4 threads.
-        ThreadPool pool(4);
-        for (int i = 0; i < 100; ++i)
+        gray.Data()[i] = static_cast<uint8_t>(100 + i / 2);
+    }
+
+    auto stretched = AutoLevels(gray, 0.0);
+    EXPECT_EQ(stretched(0, 0), 0);
+    EXPECT_EQ(stretched(3, 24), 255);
+    EXPECT_EQ(stretched(2, 0), 130); // level 125 of [100, 149]
+
+    auto equalized = EqualizeHistogram(gray);
+    EXPECT_EQ(equalized(0, 0), 0);
+    EXPECT_EQ(equalized(3, 24), 255);
+    for (size_t i = 1; i < gray.Size(); ++i)
+    {
+        EXPECT_LE(equalized.Data()[i - 1], equalized.Data()[i]);
+    }
+
+    // a flat channel has nothing to spread and is left alone
+    Tensor<uint8_t, 3> flat({3, 3, 3}, 42);
+    EXPECT_EQ(EqualizeHistogram(flat), flat);
+    EXPECT_EQ(AutoLevels(flat), flat);
+}
+
+// ----- Filter and morphology tests -----
+TEST(FilterTest, IntegralImageRegionSumsMatchDirectSums)
+{
+    Tensor<uint8_t, 3> image({23, 17, 2});
+    for (size_t i = 0; i < image.Size(); ++i)
+    {
+        image.Data()[i] = static_cast<uint8_t>(i * 31 + 7);
+    }
+
+    auto integral = IntegralImage(image);
+    EXPECT_EQ(integral.Shape(), (std::array<size_t, 3>{24, 18, 2}));
+
+    for (auto [y0, x0, y1, x1] : {std::array<size_t, 4>{0, 0, 23, 17}, {3, 5, 4, 6}, {10, 0, 23, 9}, {7, 7, 7, 12}})
+    {
+        for (size_t c = 0; c < 2; ++c)
         {
-            pool.Enqueue([&counter]()
+            uint64_t expected = 0;
+            for (size_t y = y0; y < y1; ++y)
             {
-                counter.fetch_add(1);
-            });
+                for (size_t x = x0; x < x1; ++x)
+                {
+                    expected += image(y, x, c);
+                }
+            }
+            EXPECT_EQ(RegionSum(integral, y0, x0, y1, x1, c), expected);
         }
-        // Wait for all tasks to finish.
-        pool.Wait();
     }
-    EXPECT_EQ(counter.load(), 100);
 }
 
-// clang-format on
+TEST(FilterTest, BoxFilterMatchesClippedWindowMean)
+{
+    Tensor<uint8_t, 3> image({19, 29, 3});
+    Tensor<float, 2> values({19, 29});
+    for (size_t i = 0; i < image.Size(); ++i)
+    {
+        image.Data()[i] = static_cast<uint8_t>((i * 2654435761u) >> 11);
+    }
+    for (size_t i = 0; i < values.Size(); ++i)
+    {
+        values.Data()[i] = static_cast<float>(i % 13) - 6.0f;
+    }
+
+    for (size_t radius : {0, 1, 4, 40})
+    {
+        auto box      = BoxFilter(image, radius);
+        auto smoothed = BoxFilter(values, radius);
+        for (size_t y = 0; y < 19; ++y)
+        {
+            for (size_t x = 0; x < 29; ++x)
+            {
+                size_t y0 = y >= radius ? y - radius : 0, y1 = std::min<size_t>(y + radius, 18);
+                size_t x0 = x >= radius ? x - radius : 0, x1 = std::min<size_t>(x + radius, 28);
+                size_t count = (y1 - y0 + 1) * (x1 - x0 + 1);
+
+                double value_sum = 0.0;
+                for (size_t c = 0; c < 3; ++c)
+                {
+                    uint64_t sum = 0;
+                    for (size_t v = y0; v <= y1; ++v)
+                    {
+                        for (size_t u = x0; u <= x1; ++u)
+                        {
+                            sum += image(v, u, c);
+                            value_sum += c == 0 ? values(v, u) : 0.0f;
+                        }
+                    }
+                    ASSERT_EQ(box(y, x, c), (sum + count / 2) / count);
+                }
+                ASSERT_NEAR(smoothed(y, x), value_sum / count, 1e-5);
+            }
+        }
+    }
+}
+
+TEST(MorphologyTest, ErodeAndDilateMatchWindowExtrema)
+{
+    Tensor<uint8_t, 3> image({21, 26, 2});
+    Tensor<float, 2> values({21, 26});
+    for (size_t i = 0; i < image.Size(); ++i)
+    {
+        image.Data()[i] = static_cast<uint8_t>((i * 2654435761u) >> 9);
+    }
+    for (size_t i = 0; i < values.Size(); ++i)
+    {
+        values.Data()[i] = static_cast<float>((i * 37) % 101) - 50.0f;
+    }
+
+    for (size_t radius : {0, 1, 2, 5, 30})
+    {
+        auto eroded   = Erode(image, radius);
+        auto dilated  = Dilate(image, radius);
+        auto maximums = Dilate(values, radius);
+        for (size_t y = 0; y < 21; ++y)
+        {
+            for (size_t x = 0; x < 26; ++x)
+            {
+                size_t y0 = y >= radius ? y - radius : 0, y1 = std::min<size_t>(y + radius, 20);
+                size_t x0 = x >= radius ? x - radius : 0, x1 = std::min<size_t>(x + radius, 25);
+                for (size_t c = 0; c < 2; ++c)
+                {
+                    uint8_t low = 255, high = 0;
+                    float top   = -1000.0f;
+                    for (size_t v = y0; v <= y1; ++v)
+                    {
+                        for (size_t u = x0; u <= x1; ++u)
+                        {
+                            low  = std::min(low, image(v, u, c));
+                            high = std::max(high, image(v, u, c));
+                            top  = std::max(top, values(v, u));
+                        }
+                    }
+                    ASSERT_EQ(eroded(y, x, c), low);
+                    ASSERT_EQ(dilated(y, x, c), high);
+                    ASSERT_EQ(maximums(y, x), top);
+                }
+            }
+        }
+    }
+}
+
+TEST(MorphologyTest, OpenAndCloseBracketTheImage)
+{
+    Tensor<uint8_t, 2> image({32, 32}, 100);
+    image(10, 10) = 255; // bright speck
+    image(20, 20) = 0;   // dark speck
+
+    auto opened = Open(image, 1);
+    auto closed = Close(image, 1);
+    EXPECT_EQ(opened(10, 10), 100);
+    EXPECT_EQ(opened(20, 20), 0);
+    EXPECT_EQ(closed(20, 20), 100);
+    EXPECT_EQ(closed(10, 10), 255);
+
+    for (size_t i = 0; i < image.Size(); ++i)
+    {
+        EXPECT_LE(opened.Data()[i], image.Data()[i]);
+        EXPECT_GE(closed.Data()[i], image.Data()[i]);
+    }
+}
+
+// ----- Pyramid tests -----
+// Blur with 1 4 6 4 1 at every pixel, edges mirrored, then keep the even rows and columns.
+static auto ReferencePyramidDown(Tensor<uint8_t, 3> const& image) -> Tensor<uint8_t, 3>
+{
+    auto shape = image.Shape();
+    Tensor<uint8_t, 3> result({(shape[0] + 1) / 2, (shape[1] + 1) / 2, shape[2]});
+    int weights[5] = {1, 4, 6, 4, 1};
+    for (size_t y = 0; y < result.Shape()[0]; ++y)
+    {
+        for (size_t x = 0; x < result.Shape()[1]; ++x)
+        {
+            for (size_t c = 0; c < shape[2]; ++c)
+            {
+                int sum = 0;
+                for (int i = 0; i < 5; ++i)
+                {
+                    for (int j = 0; j < 5; ++j)
+                    {
+                        size_t v = ReflectIndex(2 * static_cast<std::ptrdiff_t>(y) + i - 2, shape[0]);
+                        size_t u = ReflectIndex(2 * static_cast<std::ptrdiff_t>(x) + j - 2, shape[1]);
+                        sum += weights[i] * weights[j] * image(v, u, c);
+                    }
+                }
+                result(y, x, c) = static_cast<uint8_t>((sum + 128) / 256);
+            }
+        }
+    }
+    return result;
+}
+
+TEST(PyramidTest, PyramidDownMatchesBlurThenSubsample)
+{
+    for (auto shape : {std::array<size_t, 3>{1, 1, 3}, {2, 5, 1}, {9, 4, 3}, {37, 50, 3}, {11, 13, 2}})
+    {
+        Tensor<uint8_t, 3> image(shape);
+        for (size_t i = 0; i < image.Size(); ++i)
+        {
+            image.Data()[i] = static_cast<uint8_t>((i * 2654435761u) >> 13);
+        }
+
+        auto down     = PyramidDown(image);
+        auto expected = ReferencePyramidDown(image);
+        ASSERT_EQ(down.Shape(), expected.Shape());
+        for (size_t i = 0; i < down.Size(); ++i)
+        {
+            EXPECT_EQ(down.Data()[i], expected.Data()[i]) << "shape " << shape[0] << "x" << shape[1] << "x" << shape[2] << " at " << i;
+        }
+    }
+}
+
+TEST(PyramidTest, GaussianLevelsShareOneAllocation)
+{
+    Tensor<uint8_t, 2> image({300, 201});
+    for (size_t i = 0; i < image.Size(); ++i)
+    {
+        image.Data()[i] = static_cast<uint8_t>((i * 2654435761u) >> 11);
+    }
+
+    auto pyramid = GaussianPyramid(image, 20);
+    ASSERT_EQ(pyramid.Levels(), 10u);
+    EXPECT_EQ(pyramid.Shape(1), (std::array<size_t, 2>{150, 101}));
+    EXPECT_EQ(pyramid.Shape(9), (std::array<size_t, 2>{1, 1}));
+    EXPECT_EQ(GaussianPyramid(image, 3).Levels(), 3u);
+
+    // levels follow each other inside one span, each on a cache line
+    auto storage = pyramid.Storage();
+    for (size_t level = 0; level < pyramid.Levels(); ++level)
+    {
+        EXPECT_GE(pyramid.Data(level), storage.data());
+        EXPECT_LE(pyramid.Data(level) + pyramid.Size(level), storage.data() + storage.size());
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(pyramid.Data(level)) % 64, reinterpret_cast<uintptr_t>(storage.data()) % 64);
+        if (level > 0)
+        {
+            EXPECT_GE(pyramid.Data(level), pyramid.Data(level - 1) + pyramid.Size(level - 1));
+        }
+    }
+
+    // the banded graph gives the same levels as one level at a time
+    Tensor<uint8_t, 2> expected = image;
+    for (size_t level = 0; level < pyramid.Levels(); ++level)
+    {
+        auto copy = pyramid.Level(level);
+        ASSERT_EQ(copy.Shape(), expected.Shape());
+        EXPECT_TRUE(std::equal(copy.begin(), copy.end(), expected.begin())) << "level " << level;
+        expected = PyramidDown(expected);
+    }
+}
+
+TEST(PyramidTest, LaplacianReconstructsTheImage)
+{
+    Tensor<uint8_t, 3> image({77, 130, 3});
+    for (size_t i = 0; i < image.Size(); ++i)
+    {
+        image.Data()[i] = static_cast<uint8_t>((i * 2654435761u) >> 9);
+    }
+
+    auto laplacian = LaplacianPyramid(image, 6);
+    static_assert(std::is_same_v<decltype(laplacian), Pyramid<int16_t, 3>>);
+    ASSERT_EQ(laplacian.Levels(), 6u);
+
+    // the coarsest level is the Gaussian one, every other level its difference from the next
+    auto gaussian = GaussianPyramid(image, 6);
+    for (size_t i = 0; i < laplacian.Size(5); ++i)
+    {
+        EXPECT_EQ(laplacian.Data(5)[i], gaussian.Data(5)[i]);
+    }
+
+    auto restored = ReconstructLaplacian<uint8_t>(laplacian);
+    ASSERT_EQ(restored.Shape(), image.Shape());
+    EXPECT_TRUE(std::equal(restored.begin(), restored.end(), image.begin()));
+
+    Tensor<float, 2> values({45, 61});
+    for (size_t i = 0; i < values.Size(); ++i)
+    {
+        values.Data()[i] = std::sin(0.1f * static_cast<float>(i));
+    }
+    auto restored_values = ReconstructLaplacian<float>(LaplacianPyramid(values, 4));
+    for (size_t i = 0; i < values.Size(); ++i)
+    {
+        EXPECT_NEAR(restored_values.Data()[i], values.Data()[i], 1e-5f);
+    }
+
+    // zeroed detail levels leave a smooth image, clamped to the element range
+    for (size_t level = 0; level + 1 < laplacian.Levels(); ++level)
+    {
+        std::fill_n(laplacian.Data(level), laplacian.Size(level), int16_t(level == 0 ? 300 : 0));
+    }
+    auto saturated = ReconstructLaplacian<uint8_t>(laplacian);
+    EXPECT_TRUE(std::all_of(saturated.begin(), saturated.end(), [](uint8_t value)
+    {
+        return value == 255;
+    }));
+}
+
+// ----- Warp tests -----
+TEST(WarpTest, BorderModesFoldOutsideIndices)
+{
+    EXPECT_EQ(BorderIndex(-2, 5, BorderMode::Constant), -1);
+    EXPECT_EQ(BorderIndex(7, 5, BorderMode::Replicate), 4);
+    EXPECT_EQ(BorderIndex(-2, 5, BorderMode::Reflect), 2);
+    EXPECT_EQ(BorderIndex(6, 5, BorderMode::Reflect), 2);
+    EXPECT_EQ(BorderIndex(-1, 5, BorderMode::Wrap), 4);
+    EXPECT_EQ(BorderIndex(11, 5, BorderMode::Wrap), 1);
+    EXPECT_EQ(BorderIndex(3, 1, BorderMode::Reflect), 0);
+}
+
+TEST(WarpTest, RotateQuarterTurnsMovePixelsExactly)
+{
+    Tensor<uint8_t, 3> image({9, 9, 3});
+    for (size_t i = 0; i < image.Size(); ++i)
+    {
+        image.Data()[i] = static_cast<uint8_t>(i * 11 + 3);
+    }
+
+    EXPECT_EQ(Rotate(image, 0.0), image);
+
+    // counter-clockwise on screen: the top-right corner moves to the top-left
+    WarpOptions nearest{Interpolation::Nearest};
+    auto turned = Rotate(image, 90.0, nearest);
+    for (size_t y = 0; y < 9; ++y)
+    {
+        for (size_t x = 0; x < 9; ++x)
+        {
+            for (size_t c = 0; c < 3; ++c)
+            {
+                ASSERT_EQ(turned(y, x, c), image(x, 8 - y, c));
+            }
+        }
+    }
+    EXPECT_EQ(Rotate(turned, -90.0, nearest), image);
+}
+
+TEST(WarpTest, FixedPointBilinearMatchesFloatingPoint)
+{
+    Tensor<uint8_t, 3> image({40, 53, 3});
+    Tensor<float, 3> values({40, 53, 3});
+    for (size_t i = 0; i < image.Size(); ++i)
+    {
+        image.Data()[i]  = static_cast<uint8_t>((i * 2654435761u) >> 7);
+        values.Data()[i] = image.Data()[i];
+    }
+
+    AffineMatrix matrix = RotationMatrix(20.0, 17.0, 33.0, 1.3);
+    matrix(0, 2) += 2.25;
+
+    for (auto border : {BorderMode::Constant, BorderMode::Replicate, BorderMode::Reflect, BorderMode::Wrap})
+    {
+        WarpOptions options{Interpolation::Bilinear, border, 77.0, 16};
+        auto fixed     = WarpAffine(image, matrix, {45, 61}, options);
+        auto reference = WarpAffine(values, matrix, {45, 61}, options);
+        ASSERT_EQ(fixed.Shape(), (std::array<size_t, 3>{45, 61, 3}));
+        for (size_t i = 0; i < fixed.Size(); ++i)
+        {
+            // positions round to 1/128 pixel, up to 1 level per axis on this noise plus the output rounding
+            ASSERT_NEAR(fixed.Data()[i], reference.Data()[i], 2.5);
+        }
+    }
+}
+
+TEST(WarpTest, PerspectiveMatchesAffineAndMapsThroughHomography)
+{
+    Tensor<float, 2> image({30, 40});
+    for (size_t i = 0; i < image.Size(); ++i)
+    {
+        image.Data()[i] = static_cast<float>(i % 97);
+    }
+
+    AffineMatrix affine = RotationMatrix(19.5, 14.5, -21.0, 0.8);
+    PerspectiveMatrix lifted({
+        {affine(0, 0), affine(0, 1), affine(0, 2)},
+        {affine(1, 0), affine(1, 1), affine(1, 2)},
+        {0.0, 0.0, 1.0},
+    });
+    auto expected = WarpAffine(image, affine, {30, 40});
+    auto actual   = WarpPerspective(image, lifted, {30, 40});
+    for (size_t i = 0; i < image.Size(); ++i)
+    {
+        ASSERT_NEAR(actual.Data()[i], expected.Data()[i], 1e-3);
+    }
+
+    PerspectiveMatrix homography({{1.1, 0.05, 2.0}, {-0.03, 0.95, 1.0}, {0.002, 0.001, 1.0}});
+    auto inverse = InvertTransform(homography);
+    auto warped  = WarpPerspective(image, homography, {30, 40}, {Interpolation::Nearest});
+    for (size_t y = 0; y < 30; y += 7)
+    {
+        for (size_t x = 0; x < 40; x += 9)
+        {
+            double w  = inverse(2, 0) * x + inverse(2, 1) * y + inverse(2, 2);
+            double sx = (inverse(0, 0) * x + inverse(0, 1) * y + inverse(0, 2)) / w;
+            double sy = (inverse(1, 0) * x + inverse(1, 1) * y + inverse(1, 2)) / w;
+            auto ix   = static_cast<ptrdiff_t>(std::floor(sx + 0.5));
+            auto iy   = static_cast<ptrdiff_t>(std::floor(sy + 0.5));
+            float value = ix >= 0 && ix < 40 && iy >= 0 && iy < 30 ? image(iy, ix) : 0.0f;
+            EXPECT_EQ(warped(y, x), value);
+        }
+    }
+}
+
+// ----- Color space tests -----
+
+static auto ColorTestImage(size_t height, size_t width) -> Tensor<uint8_t, 3>
+{
+    Tensor<uint8_t, 3> image({height, width, 3});
+    for (size_t i = 0; i < image.Size(); ++i)
+    {
+        image.Data()[i] = static_cast<uint8_t>((i * 2654435761u) >> 7);
+    }
+    return image;
+}
+
+TEST(ColorSpaceTest, YCbCrMatchesMatrixAndRoundTrips)
+{
+    // 53 columns run the 16-pixel SIMD steps and the scalar tail
+    auto rgb = ColorTestImage(37, 53);
+    for (auto standard : {ColorStandard::Bt601, ColorStandard::Bt709})
+    {
+        for (auto range : {ColorRange::Limited, ColorRange::Full})
+        {
+            ColorMatrix forward = RgbToYCbCrMatrix(standard, range);
+            auto ycbcr          = RgbToYCbCr(rgb, standard, range);
+            auto back           = YCbCrToRgb(ycbcr, standard, range);
+            for (size_t p = 0; p < rgb.Size() / 3; ++p)
+            {
+                uint8_t const* in = rgb.Data() + p * 3;
+                for (size_t c = 0; c < 3; ++c)
+                {
+                    double expected = forward(c, 0) * in[0] + forward(c, 1) * in[1] + forward(c, 2) * in[2] + forward(c, 3);
+                    ASSERT_NEAR(ycbcr.Data()[p * 3 + c], std::clamp(expected, 0.0, 255.0), 1.0);
+                    // limited range has fewer levels, one step of Y is 1.16 levels of RGB
+                    ASSERT_NEAR(back.Data()[p * 3 + c], in[c], 3.0);
+                }
+            }
+        }
+    }
+}
+
+TEST(ColorSpaceTest, FloatYCbCrMatchesEightBitAndRoundTrips)
+{
+    auto rgb = ColorTestImage(11, 29);
+    Tensor<float, 3> unit(rgb.Shape());
+    for (size_t i = 0; i < rgb.Size(); ++i)
+    {
+        unit.Data()[i] = rgb.Data()[i] / 255.0f;
+    }
+
+    for (auto range : {ColorRange::Limited, ColorRange::Full})
+    {
+        auto ycbcr       = RgbToYCbCr(rgb, ColorStandard::Bt601, range);
+        auto ycbcr_float = RgbToYCbCr(unit, ColorStandard::Bt601, range);
+        auto back        = YCbCrToRgb(ycbcr_float, ColorStandard::Bt601, range);
+        for (size_t i = 0; i < rgb.Size(); ++i)
+        {
+            // the 8-bit result is the float one rounded, unless it clamped
+            ASSERT_NEAR(ycbcr.Data()[i], std::clamp(ycbcr_float.Data()[i] * 255.0f, 0.0f, 255.0f), 1.0f);
+            ASSERT_NEAR(back.Data()[i], unit.Data()[i], 1e-5f);
+        }
+    }
+
+    // neutral grey has centred chroma
+    auto grey = RgbToYCbCr(Tensor<float, 3>({1, 1, 3}, 0.5f), ColorStandard::Bt709, ColorRange::Full);
+    EXPECT_NEAR(grey(0, 0, 0), 0.5f, 1e-6f);
+    EXPECT_NEAR(grey(0, 0, 1), 128.0f / 255.0f, 1e-6f);
+    EXPECT_NEAR(grey(0, 0, 2), 128.0f / 255.0f, 1e-6f);
+}
+
+TEST(ColorSpaceTest, YCbCr420SubsamplesInOnePass)
+{
+    auto rgb  = ColorTestImage(21, 45);
+    auto full = RgbToYCbCr(rgb);
+    auto yuv  = RgbToYCbCr420(rgb);
+
+    ASSERT_EQ(yuv.cb.Shape()[0], 11u);
+    ASSERT_EQ(yuv.cb.Shape()[1], 23u);
+    for (size_t y = 0; y < 21; ++y)
+    {
+        for (size_t x = 0; x < 45; ++x)
+        {
+            ASSERT_EQ(yuv.y(y, x), full(y, x, 0));
+        }
+    }
+
+    // each chroma sample is the chroma of its 2x2 block's mean, odd edges repeat their last row or column
+    ColorMatrix forward = RgbToYCbCrMatrix(ColorStandard::Bt709, ColorRange::Limited);
+    for (size_t by = 0; by < 11; ++by)
+    {
+        for (size_t bx = 0; bx < 23; ++bx)
+        {
+            double mean[3] = {};
+            for (size_t y : {2 * by, std::min<size_t>(2 * by + 1, 20)})
+            {
+                for (size_t x : {2 * bx, std::min<size_t>(2 * bx + 1, 44)})
+                {
+                    for (size_t c = 0; c < 3; ++c)
+                    {
+                        mean[c] += rgb(y, x, c) / 4.0;
+                    }
+                }
+            }
+            double cb = forward(1, 0) * mean[0] + forward(1, 1) * mean[1] + forward(1, 2) * mean[2] + forward(1, 3);
+            double cr = forward(2, 0) * mean[0] + forward(2, 1) * mean[1] + forward(2, 2) * mean[2] + forward(2, 3);
+            ASSERT_NEAR(yuv.cb(by, bx), cb, 1.0);
+            ASSERT_NEAR(yuv.cr(by, bx), cr, 1.0);
+        }
+    }
+
+    // chroma constant over each block survives the round trip
+    Tensor<uint8_t, 3> blocks({21, 45, 3});
+    for (size_t y = 0; y < 21; ++y)
+    {
+        for (size_t x = 0; x < 45; ++x)
+        {
+            for (size_t c = 0; c < 3; ++c)
+            {
+                blocks(y, x, c) = rgb(y / 2 * 2, x / 2 * 2, c);
+            }
+        }
+    }
+    auto back = YCbCr420ToRgb(RgbToYCbCr420(blocks));
+    for (size_t i = 0; i < blocks.Size(); ++i)
+    {
+        ASSERT_NEAR(back.Data()[i], blocks.Data()[i], 3.0);
+    }
+}
+
+TEST(ColorSpaceTest, GrayHsvAndPlanarLayouts)
+{
+    auto rgb = ColorTestImage(9, 35);
+    Tensor<float, 3> unit(rgb.Shape());
+    for (size_t i = 0; i < rgb.Size(); ++i)
+    {
+        unit.Data()[i] = rgb.Data()[i] / 255.0f;
+    }
+
+    auto gray       = RgbToGray(rgb, ColorStandard::Bt601);
+    auto gray_float = RgbToGray(unit, ColorStandard::Bt601);
+    for (size_t i = 0; i < gray.Size(); ++i)
+    {
+        ASSERT_NEAR(gray.Data()[i], gray_float.Data()[i] * 255.0f, 0.51f);
+    }
+    EXPECT_EQ(GrayToRgb(gray)(4, 7, 2), gray(4, 7));
+
+    Tensor<float, 3> primaries({1, 3, 3}, 0.0f);
+    primaries(0, 0, 0) = 1.0f;
+    primaries(0, 1, 1) = 0.5f;
+    primaries(0, 2, 0) = primaries(0, 2, 2) = 1.0f;
+    auto hsv = RgbToHsv(primaries);
+    EXPECT_FLOAT_EQ(hsv(0, 0, 0), 0.0f);
+    EXPECT_FLOAT_EQ(hsv(0, 1, 0), 120.0f);
+    EXPECT_FLOAT_EQ(hsv(0, 1, 2), 0.5f);
+    EXPECT_FLOAT_EQ(hsv(0, 2, 0), 300.0f);
+    EXPECT_FLOAT_EQ(hsv(0, 2, 1), 1.0f);
+
+    auto back = HsvToRgb(RgbToHsv(unit));
+    for (size_t i = 0; i < unit.Size(); ++i)
+    {
+        ASSERT_NEAR(back.Data()[i], unit.Data()[i], 1e-5f);
+    }
+
+    auto planar = ToPlanar(rgb);
+    EXPECT_EQ(planar.Shape()[0], 3u);
+    EXPECT_EQ(planar(2, 5, 11), rgb(5, 11, 2));
+    auto interleaved = ToInterleaved(planar);
+    for (size_t i = 0; i < rgb.Size(); ++i)
+    {
+        ASSERT_EQ(interleaved.Data()[i], rgb.Data()[i]);
+    }
+}
+
+// ----- Image decoding tests -----
+static auto WriteBytes(std::string const& path, std::string const& bytes) -> void
+{
+    std::ofstream outfile(path, std::ios::binary);
+    outfile.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+TEST(DecodeTest, PpmHeadersDepthsAndGrayExpansion)
+{
+    // 8-bit P6 with comments, rescaled from maxval 100
+    std::string p6 = "P6 # comment\n2 1\n# another\n100\n";
+    p6 += std::string({char(0), char(50), char(100), char(100), char(0), char(25)});
+    auto rgb = Tensor<uint8_t, 3>({1, 2, 3});
+    DecodePpm(std::span<uint8_t const>(reinterpret_cast<uint8_t const*>(p6.data()), p6.size()), rgb);
+    EXPECT_EQ(rgb(0, 0, 1), 128);
+    EXPECT_EQ(rgb(0, 0, 2), 255);
+    EXPECT_EQ(rgb(0, 1, 2), 64);
+
+    // 16-bit P5 is big-endian, a gray file fills all three channels
+    WriteBytes("decode_test.pgm", std::string("P5\n2 1\n65535\n") + std::string({char(0x12), char(0x34), char(0xff), char(0xfe)}));
+    auto gray = DecodePpm<uint16_t>("decode_test.pgm");
+    EXPECT_EQ(gray.Shape(), (std::array<size_t, 3>{1, 2, 1}));
+    EXPECT_EQ(gray(0, 0, 0), 0x1234);
+    EXPECT_EQ(gray(0, 1, 0), 0xfffe);
+
+    auto expanded = Tensor<uint16_t, 3>({1, 2, 3});
+    DecodePpm("decode_test.pgm", expanded);
+    EXPECT_EQ(expanded(0, 1, 0), 0xfffe);
+    EXPECT_EQ(expanded(0, 1, 2), 0xfffe);
+
+    // 8-bit samples widen to the full 16-bit range
+    auto wide = Tensor<uint16_t, 3>({1, 2, 3});
+    DecodePpm(std::span<uint8_t const>(reinterpret_cast<uint8_t const*>(p6.data()), p6.size()), wide);
+    EXPECT_EQ(wide(0, 0, 2), 65535);
+
+    WriteBytes("decode_test.pgm", "P6\n4 4\n255\n" + std::string(10, 'x'));
+    EXPECT_THROW(DecodePpm<uint8_t>("decode_test.pgm"), std::runtime_error);
+    EXPECT_THROW(DecodePpm(std::span<uint8_t const>(reinterpret_cast<uint8_t const*>(p6.data()), p6.size()), gray), std::runtime_error);
+    std::remove("decode_test.pgm");
+}
+
+TEST(DecodeTest, PngRoundTripsThroughEncoder)
+{
+    auto rgb = Tensor<uint8_t, 3>({17, 23, 3});
+    for (size_t i = 0; i < rgb.Size(); ++i)
+    {
+        rgb.Data()[i] = static_cast<uint8_t>(i * 7);
+    }
+    EncodePng("decode_test.png", rgb);
+
+    std::vector<uint8_t> bytes;
+    ReadFileBytes("decode_test.png", bytes);
+    EXPECT_EQ(PngShape(bytes), (std::array<size_t, 3>{17, 23, 3}));
+    EXPECT_EQ(DecodePng<uint8_t>("decode_test.png"), rgb);
+
+    auto wide = Tensor<uint16_t, 3>({17, 23, 3});
+    DecodePng("decode_test.png", wide);
+    EXPECT_EQ(wide(4, 5, 1), rgb(4, 5, 1) * 257);
+
+    auto small = Tensor<uint8_t, 3>({16, 23, 3});
+    EXPECT_THROW(DecodePng("decode_test.png", small), std::runtime_error);
+    std::remove("decode_test.png");
+}
+
+TEST(DecodeTest, LoaderCallsBackInOrderAndRethrows)
+{
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < 12; ++i)
+    {
+        // sizes and formats vary so slots reallocate and both decoders run
+        auto rgb = Tensor<uint8_t, 3>({4 + i % 3, 5, 3}, static_cast<uint8_t>(i));
+        paths.push_back("loader_test_" + std::to_string(i) + (i % 2 ? ".png" : ".ppm"));
+        if (i % 2)
+        {
+            EncodePng(paths.back(), rgb);
+        }
+        else
+        {
+            EncodePpm(paths.back(), rgb);
+        }
+    }
+
+    LoaderOptions options;
+    options.io_threads = 3;
+    options.lookahead  = 2;
+
+    std::vector<size_t> order;
+    auto stats = LoadImages<uint8_t>(paths, options, [&](size_t index, Tensor<uint8_t, 3> const& image)
+    {
+        order.push_back(index);
+        EXPECT_EQ(image.Shape()[0], 4 + index % 3);
+        EXPECT_EQ(image(3, 4, 2), index);
+    });
+    EXPECT_EQ(order.size(), 12u);
+    EXPECT_TRUE(std::is_sorted(order.begin(), order.end()));
+    EXPECT_EQ(stats.frames, 12u);
+    EXPECT_GT(stats.bytes, 12u * 60u);
+    EXPECT_GE(stats.MegabytesPerSecond(), 0.0);
+
+    std::vector<std::string> missing = paths;
+    missing[5] = "loader_test_missing.ppm";
+    size_t calls = 0;
+    EXPECT_THROW(LoadImages<uint8_t>(missing, options, [&](size_t, Tensor<uint8_t, 3> const&)
+    {
+        ++calls;
+    }), std::runtime_error);
+    EXPECT_LE(calls, 5u);
+
+    for (auto const& path : paths)
+    {
+        std::remove(path.c_str());
+    }
+}
+
+TEST(DecodeTest, LoaderInsideEveryWorkerDoesNotDeadlock)
+{
+    // large enough that the sample conversion splits into blocks queued on the pool
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < 3; ++i)
+    {
+        paths.push_back("loader_worker_test_" + std::to_string(i) + ".ppm");
+        EncodePpm(paths.back(), Tensor<uint8_t, 3>({300, 400, 3}, static_cast<uint8_t>(i + 1)));
+    }
+
+    // every worker is held inside a loader at once, as with a pool of one thread
+    ThreadPool& pool = DispatchThreadPool();
+    size_t workers   = pool.ThreadCount();
+    std::atomic<size_t> started{0};
+    std::atomic<size_t> frames{0};
+    std::latch done(workers);
+    for (size_t w = 0; w < workers; ++w)
+    {
+        pool.Enqueue([&]()
+        {
+            ++started;
+            while (started.load() < workers)
+            {
+                std::this_thread::yield();
+            }
+            LoadImages<uint8_t>(paths, LoaderOptions{}, [&](size_t index, Tensor<uint8_t, 3> const& image)
+            {
+                EXPECT_EQ(image(299, 399, 2), index + 1);
+                ++frames;
+            });
+            done.count_down();
+        });
+    }
+    done.wait();
+    EXPECT_EQ(frames.load(), 3 * workers);
+
+    for (auto const& path : paths)
+    {
+        std::remove(path.c_str());
+    }
+}
+
+// ----- Half precision tests -----
+TEST(HalfTest, Float16RoundsToNearestEvenAndRoundTrips)
+{
+    EXPECT_EQ(Float16(1.0f).Bits(), 0x3c00);
+    EXPECT_EQ(Float16(-2.0f).Bits(), 0xc000);
+    EXPECT_EQ(Float16(65504.0f).Bits(), 0x7bff);
+    EXPECT_EQ(Float16(65520.0f).Bits(), 0x7c00);           // rounds up past the largest finite half
+    EXPECT_EQ(Float16(0x1p-24f).Bits(), 0x0001);           // smallest subnormal
+    EXPECT_EQ(Float16(1.0f + 0x1p-11f).Bits(), 0x3c00);    // tie rounds to the even mantissa
+    EXPECT_EQ(Float16(1.0f + 3 * 0x1p-11f).Bits(), 0x3c02);
+    EXPECT_TRUE(std::isnan(float(Float16(NAN))));
+
+    for (uint32_t bits = 0; bits <= 0xffff; ++bits)
+    {
+        auto half = Float16::FromBits(static_cast<uint16_t>(bits));
+        if (!std::isnan(float(half)))
+        {
+            EXPECT_EQ(Float16(float(half)).Bits(), bits);
+        }
+    }
+}
+
+TEST(HalfTest, BFloat16KeepsTheFloatExponent)
+{
+    EXPECT_EQ(BFloat16(1.0f).Bits(), 0x3f80);
+    EXPECT_EQ(BFloat16(std::bit_cast<float>(0x3f808000u)).Bits(), 0x3f80); // tie to even
+    EXPECT_EQ(BFloat16(std::bit_cast<float>(0x3f818000u)).Bits(), 0x3f82);
+    EXPECT_NEAR(float(BFloat16(1e30f)) / 1e30f, 1.0f, 1.0f / 256); // range far beyond Float16, 8 bits of precision
+    EXPECT_TRUE(std::isnan(float(BFloat16(NAN))));
+}
+
+TEST(HalfTest, BulkConversionMatchesScalar)
+{
+    // 37 elements so every vector width leaves a scalar tail
+    Tensor<float, 1> values({37});
+    for (size_t i = 0; i < values.Size(); ++i)
+    {
+        values(i) = std::ldexp(1.0f + i / 37.0f, static_cast<int>(i) - 26) * (i % 2 ? -1.0f : 1.0f);
+    }
+
+    auto halves  = TensorCast<Float16>(values);
+    auto bfloats = TensorCast<BFloat16>(values);
+    auto widened = TensorCast<float>(halves);
+    for (size_t i = 0; i < values.Size(); ++i)
+    {
+        EXPECT_EQ(halves(i).Bits(), FloatToHalfBits(values(i)));
+        EXPECT_EQ(bfloats(i).Bits(), FloatToBFloatBits(values(i)));
+        EXPECT_EQ(widened(i), HalfBitsToFloat(halves(i).Bits()));
+        EXPECT_EQ(TensorCast<float>(bfloats)(i), BFloatBitsToFloat(bfloats(i).Bits()));
+    }
+}
+
+TEST(HalfTest, HalfTensorsComputeThroughFloat)
+{
+    static_assert(Real<Float16> && Real<BFloat16>);
+
+    Tensor<Float16, 2> a({2, 3}, Float16(1.5f));
+    Tensor<Float16, 2> b({2, 3}, Float16(0.25f));
+
+    auto sum = a + b;
+    static_assert(std::is_same_v<decltype(sum), Tensor<Float16, 2>>);
+    EXPECT_EQ(float(sum(1, 2)), 1.75f);
+
+    auto scaled = a * 2.0f;
+    static_assert(std::is_same_v<decltype(scaled), Tensor<float, 2>>);
+    EXPECT_EQ(scaled(0, 0), 3.0f);
+
+    Tensor<BFloat16, 2> c({2, 3}, BFloat16(2.0f));
+    EXPECT_EQ((a * c)(0, 1), 3.0f);
+    EXPECT_EQ(TensorCast<int>(a + a)(1, 1), 3);
+}
+
+// ----- Dispatcher tests -----
+TEST(DispatcherTest, Dispatch2dCallsCorrectly)
+{
+    std::vector<std::pair<size_t, size_t>> indices;
+    // Use a 3x3 area so we expect 9 calls.
+    Dispatch2d(3, 3, [&indices](size_t y, size_t x)
+    {
+        indices.emplace_back(y, x);
+    });
+    EXPECT_EQ(indices.size(), 9);
+    // Optionally check that certain indices were covered.
+    bool found00 = false, found11 = false, found22 = false;
+    for (auto& idx : indices)
+    {
+        if (idx.first == 0 && idx.second == 0)
+        {
+            found00 = true;
+        }
+        if (idx.first == 1 && idx.second == 1)
+        {
+            found11 = true;
+        }
+        if (idx.first == 2 && idx.second == 2)
+        {
+            found22 = true;
+        }
+    }
+    EXPECT_TRUE(found00);
+    EXPECT_TRUE(found11);
+    EXPECT_TRUE(found22);
+}
+
+TEST(DispatcherTest, Dispatch1dVisitsEveryIndexOnce)
+{
+    std::vector<std::atomic<int>> visits(1000);
+    Dispatch1d(visits.size(), [&visits](size_t i)
+    {
+        visits[i].fetch_add(1);
+    });
+    for (auto& count : visits)
+    {
+        EXPECT_EQ(count.load(), 1);
+    }
+}
+
+TEST(DispatcherTest, DispatchRangeCoversRangeInBlocks)
+{
+    std::vector<std::atomic<int>> visits(1000);
+    std::atomic<size_t> blocks(0);
+    DispatchRange(visits.size(), 300, [&](size_t start, size_t stop)
+    {
+        blocks.fetch_add(1);
+        for (size_t i = start; i < stop; ++i)
+        {
+            visits[i].fetch_add(1);
+        }
+    });
+    EXPECT_EQ(blocks.load(), 4);
+    for (auto& count : visits)
+    {
+        EXPECT_EQ(count.load(), 1);
+    }
+}
+
+// ----- Dispatch tuning tests -----
+TEST(TuningTest, ParsesShapesAndBuildsKeys)
+{
+    EXPECT_EQ(ParseTileShape("64x256"), (TileShape{64, 256}));
+    EXPECT_EQ(ParseTileShape("128"), (TileShape{128, 128}));
+    EXPECT_FALSE(ParseTileShape("0x64").has_value());
+    EXPECT_FALSE(ParseTileShape("64y32").has_value());
+    EXPECT_FALSE(ParseTileShape("64x32x2").has_value());
+    EXPECT_FALSE(ParseTileShape("").has_value());
+
+    EXPECT_EQ(ShapeClass(1000, 1900), "1024x2048");
+    EXPECT_EQ(ShapeClass(1024, 1), "1024x1");
+    EXPECT_EQ(TypeTag<float>(), "f32");
+    EXPECT_EQ(TypeTag<int16_t>(), "i16");
+    EXPECT_EQ(TypeTag<uint8_t>(), "u8");
+}
+
+TEST(TuningTest, CacheRoundTripsThroughFile)
+{
+    auto& tuning = DispatchTuning::Instance();
+    std::string path = "test_tuning.cache";
+    std::string previous = tuning.Path();
+    tuning.SetPath("");
+
+    tuning.Store(TuningKey("blur", "1024x1024", "f32"), {32, 1024});
+    tuning.Store(TuningKey("add_tensor", "4x8", "u8"), {4, 8});
+    ASSERT_TRUE(tuning.Save(path));
+    ASSERT_TRUE(tuning.Save(path)); // replaces the file, leaving no temporary beside it
+    for (auto const& entry : std::filesystem::directory_iterator("."))
+    {
+        EXPECT_FALSE(entry.path().filename().string().starts_with(path + ".tmp"));
+    }
+    {
+        std::ofstream append(path, std::ios::app);
+        append << "malformed line\n";
+    }
+
+    tuning.Clear();
+    EXPECT_FALSE(tuning.Find(TuningKey("blur", "1024x1024", "f32")).has_value());
+    EXPECT_EQ(tuning.Load(path), 2u);
+    EXPECT_EQ(tuning.Find(TuningKey("blur", "1024x1024", "f32")), (TileShape{32, 1024}));
+    EXPECT_EQ(tuning.Find(TuningKey("add_tensor", "4x8", "u8")), (TileShape{4, 8}));
+
+    tuning.Clear();
+    tuning.SetPath(previous);
+    std::remove(path.c_str());
+}
+
+TEST(TuningTest, ResultsStayInMemoryUnlessACacheIsNamed)
+{
+    if (std::getenv("MATRIX_TUNING_CACHE") || std::getenv("MATRIX_TUNING") || std::getenv("MATRIX_DISPATCH_BLOCK"))
+    {
+        GTEST_SKIP() << "tuning configured through the environment";
+    }
+
+    // a plain addition tunes on first use, with no file to write the result to
+    auto& tuning = DispatchTuning::Instance();
+    EXPECT_EQ(tuning.Path(), "");
+    auto sum = Tensor<float, 2>({300, 300}, 1.0f) + Tensor<float, 2>({300, 300}, 2.0f);
+    EXPECT_EQ(sum(299, 299), 3.0f);
+    EXPECT_TRUE(tuning.Find(TuningKey("add_tensor", "512x512", "f32")).has_value());
+}
+
+TEST(TuningTest, TunesOnFirstUseAndHonoursFixedShape)
+{
+    auto& tuning = DispatchTuning::Instance();
+    std::string previous = tuning.Path();
+    tuning.SetPath("");
+    tuning.Clear();
+
+    // first use measures every candidate, each run writes the same values
+    Tensor<float, 2> output({300, 520});
+    TunedDispatch2d<float>("test_fill", 300, 520, [&](size_t y, size_t x)
+    {
+        output(y, x) = static_cast<float>(y * 520 + x);
+    });
+    for (size_t i = 0; i < output.Size(); ++i)
+    {
+        ASSERT_EQ(output.Data()[i], static_cast<float>(i));
+    }
+    auto tuned      = tuning.Find(TuningKey("test_fill", "512x1024", "f32"));
+    auto candidates = BlockCandidates(300, 520);
+    ASSERT_TRUE(tuned.has_value());
+    EXPECT_NE(std::find(candidates.begin(), candidates.end(), *tuned), candidates.end());
+
+    // later uses dispatch once with the cached shape, a fixed shape overrides it
+    std::atomic<size_t> blocks(0);
+    auto count_blocks = [&](size_t, size_t, size_t, size_t)
+    {
+        blocks.fetch_add(1);
+    };
+    TunedDispatchBlocks<float>("test_fill", 300, 520, count_blocks);
+    EXPECT_EQ(blocks.load(), ((300 + tuned->block_height - 1) / tuned->block_height) * ((520 + tuned->block_width - 1) / tuned->block_width));
+
+    tuning.SetFixed(TileShape{7, 9});
+    blocks = 0;
+    TunedDispatchBlocks<float>("test_fill", 300, 520, count_blocks);
+    EXPECT_EQ(blocks.load(), 43u * 58u);
+
+    blocks = 0;
+    TunedDispatchRange<float>("test_range", 1000, 256, [&](size_t, size_t)
+    {
+        blocks.fetch_add(1);
+    });
+    EXPECT_EQ(blocks.load(), 112u);
+
+    tuning.SetFixed(std::nullopt);
+    tuning.Clear();
+    tuning.SetPath(previous);
+}
+
+// ----- Async dispatch and task graph tests -----
+TEST(AsyncTest, HandleWaitsForEveryTileAndRethrows)
+{
+    std::vector<std::atomic<int>> visits(300 * 520);
+    auto handle = Dispatch2dAsync(300, 520, [&visits](size_t y, size_t x)
+    {
+        visits[y * 520 + x]++;
+    });
+    handle.Wait();
+    EXPECT_TRUE(handle.Ready());
+    for (auto const& count : visits)
+    {
+        EXPECT_EQ(count.load(), 1);
+    }
+
+    auto failing = DispatchRangeAsync(1000, 100, [](size_t start, size_t)
+    {
+        if (start == 500)
+        {
+            throw std::runtime_error("block failed");
+        }
+    });
+    EXPECT_THROW(failing.Wait(), std::runtime_error);
+
+    EXPECT_EQ(DispatchThreadPool().Submit([]() { return 6 * 7; }).get(), 42);
+}
+
+TEST(AsyncTest, AssigningOverAPendingHandleWaitsForIt)
+{
+    std::array<std::atomic<int>, 4> finished = {0, 0, 0, 0};
+    DispatchHandle handle;
+    for (size_t round = 0; round < finished.size(); ++round)
+    {
+        handle = DispatchRangeAsync(8, 1, [&finished, round](size_t start, size_t)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            if (round == 1 && start == 0)
+            {
+                throw std::runtime_error("dropped with its handle");
+            }
+            finished[round]++;
+        });
+        // the previous round is complete, its error dropped as if the handle had been destroyed
+        if (round > 0)
+        {
+            EXPECT_EQ(finished[round - 1].load(), round == 2 ? 7 : 8);
+        }
+    }
+    handle.Wait();
+    EXPECT_EQ(finished.back().load(), 8);
+}
+
+TEST(TaskGraphTest, RunsTasksAfterTheirDependencies)
+{
+    std::mutex mutex;
+    std::vector<int> order;
+    auto record = [&](int value)
+    {
+        return [&, value]()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            order.push_back(value);
+        };
+    };
+
+    // diamond: 0 -> {1, 2} -> 3, and 4 independent
+    TaskGraph graph;
+    auto a = graph.Add("a", record(0));
+    auto b = graph.Add("b", record(1), {a});
+    auto c = graph.Add("c", record(2), {a});
+    graph.Add("d", record(3), {b, c});
+    graph.Add("e", record(4));
+    EXPECT_THROW(graph.Add("f", record(5), {7}), std::runtime_error);
+
+    for (int run = 0; run < 2; ++run)
+    {
+        order.clear();
+        graph.Run();
+
+        ASSERT_EQ(order.size(), 5);
+        auto position = [&](int value)
+        {
+            return std::find(order.begin(), order.end(), value) - order.begin();
+        };
+        EXPECT_LT(position(0), position(1));
+        EXPECT_LT(position(0), position(2));
+        EXPECT_LT(position(1), position(3));
+        EXPECT_LT(position(2), position(3));
+    }
+}
+
+TEST(TaskGraphTest, FailureSkipsRemainingTasks)
+{
+    std::atomic<int> ran = 0;
+
+    TaskGraph graph;
+    auto first = graph.Add("fail", []()
+    {
+        throw std::runtime_error("stage failed");
+    });
+    graph.Add("after", [&ran]()
+    {
+        ++ran;
+    }, {first});
+
+    EXPECT_THROW(graph.Run(), std::runtime_error);
+    EXPECT_EQ(ran.load(), 0);
+}
+
+// ----- ThreadPool tests -----
+TEST(ThreadPoolTest, EnqueueAndExecute)
+{
+    std::atomic<int> counter(0);
+    {
+        // Create a thread pool with 4 threads.
+        ThreadPool pool(4);
+        for (int i = 0; i < 100; ++i)
+        {
+            pool.Enqueue([&counter]()
+            {
+                counter.fetch_add(1);
+            });
+        }
+        // Wait for all tasks to finish.
+        pool.Wait();
+    }
+    EXPECT_EQ(counter.load(), 100);
+}
+
+TEST(ThreadPoolTest, PlacesWorkersOnNumaNodes)
+{
+    EXPECT_EQ(ParseCpuList("0-3,8,10-11"), (std::vector<size_t>{0, 1, 2, 3, 8, 10, 11}));
+    EXPECT_EQ(ParseCpuList("2,x,5-"), (std::vector<size_t>{2}));
+
+    std::vector<size_t> cpus;
+    EXPECT_EQ(ParseAffinity("scatter", cpus), AffinityPolicy::Scatter);
+    EXPECT_EQ(ParseAffinity("4-5,9", cpus), AffinityPolicy::Explicit);
+    EXPECT_EQ(cpus, (std::vector<size_t>{4, 5, 9}));
+    EXPECT_FALSE(ParseAffinity("spread", cpus).has_value());
+
+    CpuTopology topology{{{0, 1, 2, 3}, {4, 5, 6, 7}}};
+    EXPECT_EQ(PlaceWorkers(topology, AffinityPolicy::Compact, {}, 5), (std::vector<size_t>{0, 1, 2, 3, 4}));
+    EXPECT_EQ(PlaceWorkers(topology, AffinityPolicy::Scatter, {}, 5), (std::vector<size_t>{0, 4, 1, 5, 2}));
+    EXPECT_EQ(PlaceWorkers(topology, AffinityPolicy::Explicit, {6, 2}, 3), (std::vector<size_t>{6, 2, 6}));
+    EXPECT_TRUE(PlaceWorkers(topology, AffinityPolicy::None, {}, 3).empty());
+
+    // a fake sysfs tree, node2 has no allowed CPUs and is dropped
+    std::filesystem::path root = "test_topology";
+    for (auto [node, list] : {std::pair{"node0", "0-1"}, std::pair{"node1", "2-3"}, std::pair{"node2", "8"}})
+    {
+        std::filesystem::create_directories(root / node);
+        std::ofstream(root / node / "cpulist") << list << "\n";
+    }
+    std::filesystem::create_directories(root / "possible");
+    auto read = ReadCpuTopology(root.string(), {0, 1, 3});
+    std::filesystem::remove_all(root);
+    EXPECT_EQ(read.nodes, (std::vector<std::vector<size_t>>{{0, 1}, {3}}));
+    EXPECT_EQ(read.NodeOf(3), std::optional<size_t>(1));
+}
+
+TEST(ThreadPoolTest, WorkersStealAcrossGroups)
+{
+    ThreadPoolOptions options;
+    options.threads  = 2;
+    options.affinity = AffinityPolicy::Scatter;
+    options.topology = CpuTopology{{{0}, {1}}};
+
+    std::vector<std::atomic<int>> ran_on(2);
+    std::atomic<int> flagged_stolen{0};
+    {
+        ThreadPool pool(options);
+        EXPECT_EQ(pool.GroupCount(), 2u);
+        EXPECT_EQ(pool.WorkerGroup(1), 1u);
+        EXPECT_EQ(pool.GroupFor(0, 10), 0u);
+        EXPECT_EQ(pool.GroupFor(9, 10), 1u);
+
+        // everything is queued for group 1, whatever worker 0 runs it took from another group
+        for (int i = 0; i < 200; ++i)
+        {
+            pool.EnqueueOnGroup(1, [&ran_on, &flagged_stolen]()
+            {
+                ran_on[ThreadPool::WorkerIndex()].fetch_add(1);
+                flagged_stolen.fetch_add(ThreadPool::RunningStolenTask() ? 1 : 0);
+            });
+        }
+        pool.Wait();
+        EXPECT_EQ(pool.Steals(), static_cast<size_t>(ran_on[0].load()));
+        EXPECT_EQ(flagged_stolen.load(), ran_on[0].load());
+    }
+    EXPECT_EQ(ran_on[0].load() + ran_on[1].load(), 200);
+}
+
+TEST(ThreadPoolTest, NestedDispatchRunsInlineOrJoinsThePool)
+{
+    for (auto policy : {NestedDispatch::Inline, NestedDispatch::Join})
+    {
+        SetNestedDispatch(policy);
+        std::vector<std::atomic<int>> visits(8 * 300 * 300);
+        DispatchRange(8, 1, [&](size_t start, size_t stop)
+        {
+            for (size_t outer = start; outer < stop; ++outer)
+            {
+                Dispatch2d(300, 300, [&](size_t y, size_t x)
+                {
+                    visits[(outer * 300 + y) * 300 + x]++;
+                });
+            }
+        });
+        for (auto const& count : visits)
+        {
+            ASSERT_EQ(count.load(), 1);
+        }
+    }
+    SetNestedDispatch(NestedDispatch::Inline);
+}
+
+// ----- Trace tests -----
+TEST(TraceTest, SummaryAggregatesWorkerTasks)
+{
+    Tracer tracer;
+    tracer.Record({"tile", 0, 1000, 5000, 0, 0, 0});
+    tracer.Record({"tile", 0, 2000, 4000, 1, 0, 1});
+    tracer.Record({"tile", 0, 5000, 10000, 0, 1, 0, true});
+    tracer.Record({"tile", 0, 0, 10000}); // dispatch-level event, not a worker task
+
+    auto summary = tracer.Summary();
+    EXPECT_EQ(summary.tasks, 3);
+    EXPECT_EQ(summary.workers, 2);
+    EXPECT_EQ(summary.tasks_per_worker, (std::vector<size_t>{2, 1}));
+    EXPECT_NEAR(summary.span_seconds, 10e-6, 1e-12);
+    EXPECT_NEAR(summary.busy_seconds, 11e-6, 1e-12);
+    EXPECT_NEAR(summary.queue_wait_seconds, 8e-6, 1e-12);
+    EXPECT_NEAR(summary.idle_seconds, 9e-6, 1e-12);
+    EXPECT_NEAR(summary.tail_seconds, 5e-6, 1e-12);
+    EXPECT_NEAR(summary.utilization, 0.55, 1e-9);
+    EXPECT_EQ(summary.steals, 1u);
+}
+
+TEST(TraceTest, WritesChromeTraceEvents)
+{
+    Tracer tracer;
+    tracer.Record({"GenerateMandelbrot", 0, 1000, 3000, 0, 2, 5});
+
+    tracer.WriteChromeTrace("trace_test.json");
+    std::ifstream infile("trace_test.json");
+    std::string json((std::istreambuf_iterator<char>(infile)), std::istreambuf_iterator<char>());
+    infile.close();
+    std::remove("trace_test.json");
+
+    EXPECT_NE(json.find("\"traceEvents\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"GenerateMandelbrot\""), std::string::npos);
+    EXPECT_NE(json.find("\"ph\":\"X\""), std::string::npos);
+    EXPECT_NE(json.find("\"tile_y\":2,\"tile_x\":5"), std::string::npos);
+
+    // region names are escaped, a quote or backslash in one must not end the string early
+    Tracer quoted;
+    quoted.Record({"say \"hi\" C:\\tmp\n", 0, 1000, 3000, 0});
+    quoted.WriteChromeTrace("trace_test.json");
+    std::ifstream quoted_file("trace_test.json");
+    std::string quoted_json((std::istreambuf_iterator<char>(quoted_file)), std::istreambuf_iterator<char>());
+    quoted_file.close();
+    std::remove("trace_test.json");
+
+    EXPECT_NE(quoted_json.find("\"name\":\"say \\\"hi\\\" C:\\\\tmp\\n\""), std::string::npos);
+    EXPECT_EQ(JsonEscape(std::string("\x01", 1)), "\\u0001");
+}
+
+TEST(TraceTest, DispatchRecordsOneEventPerTile)
+{
+    if constexpr (!TracingEnabled)
+    {
+        GTEST_SKIP() << "built without MATRIX_ENABLE_TRACING";
+    }
+
+    Tracer::Instance().Clear();
+    {
+        TraceRegion region("traced");
+        Dispatch2d(300, 600, [](size_t, size_t) {});
+    }
+
+    auto events = Tracer::Instance().Events();
+    EXPECT_EQ(Tracer::Instance().Summary().tasks, 2 * 3);
+    for (auto const& event : events)
+    {
+        EXPECT_STREQ(event.name, "traced");
+        EXPECT_LE(event.enqueue_ns, event.start_ns);
+        EXPECT_LE(event.start_ns, event.end_ns);
+    }
+}
+
+// ----- Mandelbrot tests -----
+TEST(MandelbrotTest, TiledTaskGraphMatchesSeparatePasses)
+{
+    // 600 wide spans three task tiles, so colorize tiles finish out of order
+    auto separate = ColorizeMandelbrot(GenerateMandelbrot(300, 600), Colormap::Inferno);
+    EXPECT_EQ(GenerateMandelbrotImage(300, 600, Colormap::Inferno), separate);
+}
+
+TEST(MandelbrotTest, TasksKeepTheirViewUntilTheGraphRuns)
+{
+    // the default view is a temporary gone by the time the graph runs
+    Tensor<float, 2> intensity({40, 60});
+    Tensor<uint8_t, 3> rgb({40, 60, 3});
+    TaskGraph graph;
+    AddMandelbrotTasks(graph, intensity, rgb, Colormap::Magma);
+    graph.Run();
+
+    EXPECT_EQ(intensity, GenerateMandelbrot(40, 60));
+    EXPECT_EQ(rgb, GenerateMandelbrotImage(40, 60, Colormap::Magma));
+}
+
+TEST(MandelbrotTest, AdaptiveWithoutEdgesMatchesPlainRender)
+{
+    AntialiasOptions options;
+    options.threshold = 2.0f; // intensities are in [0, 1], so no pixel is an edge
+
+    auto plain    = GenerateMandelbrotImage(48, 64, Colormap::Plasma);
+    auto adaptive = GenerateMandelbrotImageAdaptive(48, 64, Colormap::Plasma, options);
+
+    EXPECT_EQ(plain, adaptive);
+}
+
+TEST(MandelbrotTest, AdaptiveOnlyTouchesEdgePixels)
+{
+    auto plain    = GenerateMandelbrotImage(48, 64, Colormap::Plasma);
+    auto adaptive = GenerateMandelbrotImageAdaptive(48, 64, Colormap::Plasma);
+
+    size_t changed = 0;
+    for (size_t i = 0; i < plain.Size(); ++i)
+    {
+        changed += plain.Data()[i] != adaptive.Data()[i];
+    }
+    EXPECT_GT(changed, 0);
+    EXPECT_LT(changed, plain.Size() / 2);
+
+    // far corner of the view is smooth, far from the set boundary
+    EXPECT_EQ(plain(0, 0, 0), adaptive(0, 0, 0));
+}
+
+TEST(MandelbrotTest, KeyframeInterpolationZoomsGeometrically)
+{
+    std::vector<Keyframe> keyframes = {
+        {0, 0.0, 0.0, 1.0, 100},
+        {10, 1.0, -1.0, 100.0, 300},
+    };
+
+    auto middle = InterpolateKeyframes(keyframes, 5);
+    EXPECT_NEAR(middle.zoom, 10.0, 1e-9);
+    EXPECT_EQ(middle.maxIterations, 200);
+
+    // the centre has covered (1 - 1/10) / (1 - 1/100) of the way once the view has shrunk tenfold
+    EXPECT_NEAR(middle.centerReal, 0.9 / 0.99, 1e-9);
+    EXPECT_NEAR(middle.centerImag, -0.9 / 0.99, 1e-9);
+
+    EXPECT_EQ(InterpolateKeyframes(keyframes, 20).zoom, 100.0);
+}
+
+TEST(MandelbrotTest, ZoomSequenceWritesFramesInOrder)
+{
+    std::vector<Keyframe> keyframes = {
+        {0, -0.75, 0.0, 1.0, 50},
+        {5, -0.75, 0.1, 4.0, 80},
+    };
+
+    BatchOptions options;
+    options.height = 12;
+    options.width  = 16;
+    options.format = FrameFormat::Raw;
+    options.output = "zoom_sequence.raw";
+
+    auto stats = RenderZoomSequence(keyframes, options);
+    EXPECT_EQ(stats.frames, 6);
+
+    std::ifstream stream(options.output, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    ASSERT_EQ(bytes.size(), 6 * 12 * 16 * 3);
+
+    for (size_t frame = 0; frame < 6; ++frame)
+    {
+        auto keyframe = InterpolateKeyframes(keyframes, frame);
+        auto view     = MandelbrotView::FromCenter(keyframe.centerReal, keyframe.centerImag, keyframe.zoom, keyframe.maxIterations, 12, 16);
+        auto expected = ColorizeMandelbrot(GenerateMandelbrot(12, 16, view), Colormap::Plasma);
+        EXPECT_TRUE(std::equal(expected.Data(), expected.Data() + expected.Size(), reinterpret_cast<uint8_t*>(bytes.data()) + frame * expected.Size()));
+    }
+
+    stream.close();
+    std::remove(options.output.c_str());
+}
+
+// clang-format on
+
+// ----- Progressive render tests -----
+// Intensity of frame pixel (y, x) computed directly from its lattice point.
+static auto LatticeIntensity(ProgressiveOptions const& options, ProgressiveView const& view, size_t height, size_t width, size_t y, size_t x) -> float
+{
+    double step     = std::ldexp(options.step, -view.level);
+    int64_t frame_x = std::llround(view.centerReal / step) - static_cast<int64_t>(width / 2);
+    int64_t frame_y = std::llround(view.centerImag / step) - static_cast<int64_t>(height / 2);
+    return MandelbrotIntensity(static_cast<double>(frame_x + static_cast<int64_t>(x)) * step, static_cast<double>(frame_y + static_cast<int64_t>(y)) * step, view.maxIterations);
+}
+
+TEST(ProgressiveTest, PassesRefineToTheExactRender)
+{
+    ProgressiveOptions options;
+    options.tile = 32;
+    ProgressiveRenderer renderer(options);
+    ProgressiveView view{-0.7, 0.1, 2, 100};
+
+    Tensor<float, 2> intensity({45, 70});
+    std::vector<size_t> strides;
+    auto stats = renderer.Render(view, intensity, [&](size_t stride, Tensor<float, 2> const& preview)
+    {
+        // the first preview repeats each computed pixel over its block
+        if (strides.empty())
+        {
+            for (size_t y = 0; y < 45; ++y)
+            {
+                for (size_t x = 0; x < 70; ++x)
+                {
+                    ASSERT_EQ(preview(y, x), LatticeIntensity(options, view, 45, 70, y - y % stride, x - x % stride));
+                }
+            }
+        }
+        strides.push_back(stride);
+    });
+
+    EXPECT_EQ(strides, (std::vector<size_t>{8, 4, 2, 1}));
+    EXPECT_EQ(stats.passes, 4u);
+    EXPECT_EQ(stats.tile_hits, 0u);
+    EXPECT_EQ(stats.pixels_computed, 45u * 70u);
+    EXPECT_LE(stats.first_preview_seconds, stats.seconds);
+    for (size_t y = 0; y < 45; ++y)
+    {
+        for (size_t x = 0; x < 70; ++x)
+        {
+            ASSERT_EQ(intensity(y, x), LatticeIntensity(options, view, 45, 70, y, x));
+        }
+    }
+}
+
+TEST(ProgressiveTest, PanReusesCachedTiles)
+{
+    ProgressiveOptions options;
+    options.tile     = 16;
+    options.capacity = 4;
+    ProgressiveRenderer renderer(options);
+    ProgressiveView view{-0.5, 0.0, 1, 80};
+    double step = std::ldexp(options.step, -view.level);
+
+    Tensor<float, 2> intensity({40, 60});
+    renderer.Render(view, intensity);
+
+    // 17 pixels right: the overlap comes from the cache, only the new columns are iterated
+    view.centerReal += 17 * step;
+    auto stats = renderer.Render(view, intensity);
+    EXPECT_GT(stats.HitRate(), 0.5);
+    EXPECT_EQ(stats.pixels_reused, 40u * 43u);
+    EXPECT_EQ(stats.pixels_computed, 40u * 17u);
+
+    Tensor<float, 2> fresh({40, 60});
+    ProgressiveRenderer(options).Render(view, fresh);
+    EXPECT_TRUE(std::equal(intensity.begin(), intensity.end(), fresh.begin()));
+
+    // the frame keeps its tiles even above capacity, older tiles go first
+    size_t frame_tiles = stats.tile_hits + stats.tile_misses;
+    EXPECT_EQ(renderer.Cache().Size(), frame_tiles);
+    view.level = 3;
+    EXPECT_EQ(renderer.Render(view, intensity).tile_hits, 0u);
+    EXPECT_LE(renderer.Cache().Size(), std::max<size_t>(options.capacity, frame_tiles));
+}
+
+TEST(ProgressiveTest, RaisedBudgetResumesOrbits)
+{
+    ProgressiveOptions options;
+    options.tile = 32;
+    ProgressiveRenderer renderer(options);
+    ProgressiveView view{-0.75, 0.1, 4, 50};
+
+    Tensor<float, 2> low({36, 48});
+    renderer.Render(view, low);
+
+    view.maxIterations = 400;
+    Tensor<float, 2> high({36, 48});
+    auto raised = renderer.Render(view, high);
+    EXPECT_GT(raised.pixels_resumed, 0u);
+    EXPECT_EQ(raised.pixels_computed, 0u);
+    EXPECT_EQ(raised.pixels_reused + raised.pixels_resumed, 36u * 48u);
+
+    Tensor<float, 2> fresh({36, 48});
+    ProgressiveRenderer(options).Render(view, fresh);
+    EXPECT_TRUE(std::equal(high.begin(), high.end(), fresh.begin()));
+
+    // orbits run past a lower budget still give that budget's image
+    view.maxIterations = 50;
+    auto lowered = renderer.Render(view, fresh);
+    EXPECT_EQ(lowered.pixels_reused, 36u * 48u);
+    EXPECT_TRUE(std::equal(fresh.begin(), fresh.end(), low.begin()));
+}
+
+// ----- Distributed render tests -----
+#if defined(MATRIX_DISTRIBUTED_RENDER)
+// A worker that takes its job and then crashes, or hangs without ever answering.
+static auto SpawnFaultyWorker(bool hang) -> RenderWorker
+{
+    int ends[2];
+    EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, ends), 0);
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        close(ends[0]);
+        char byte;
+        while (read(ends[1], &byte, 1) == 1 && byte != '\n')
+        {
+        }
+        while (hang)
+        {
+            pause();
+        }
+        _exit(3);
+    }
+    close(ends[1]);
+    return {ends[0], pid};
+}
+
+// A worker that spends seconds on each tile without drawing it.
+static auto SpawnSlowWorker(double seconds) -> RenderWorker
+{
+    int ends[2];
+    EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, ends), 0);
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        close(ends[0]);
+        MessageChannel channel(ends[1]);
+        while (auto message = channel.Wait())
+        {
+            std::istringstream fields(*message);
+            std::string kind;
+            size_t id = 0;
+            fields >> kind >> id;
+            if (kind == "QUIT")
+            {
+                break;
+            }
+            if (kind == "TILE")
+            {
+                std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+                channel.Send("DONE " + std::to_string(id));
+            }
+        }
+        _exit(0);
+    }
+    close(ends[1]);
+    return {ends[0], pid};
+}
+
+TEST(DistributedTest, WorkersMatchInProcessRender)
+{
+    DistributedOptions options;
+    options.workers = 3;
+    options.tile    = 16;
+
+    auto render = RenderDistributed("distributed_test.rgb", 50, 70, Colormap::Magma, {}, options);
+    EXPECT_TRUE(render.image.IsMapped());
+    EXPECT_EQ(render.image, GenerateMandelbrotImage(50, 70, Colormap::Magma));
+    EXPECT_EQ(render.stats.tiles, 4u * 5u);
+    EXPECT_EQ(render.stats.lost_workers, 0u);
+    std::remove("distributed_test.rgb");
+}
+
+TEST(DistributedTest, LostWorkersTilesAreReassigned)
+{
+    // one worker crashes after its job message and one hangs past the tile timeout
+    auto workers = SpawnRenderWorkers(2);
+    workers.push_back(SpawnFaultyWorker(false));
+    workers.push_back(SpawnFaultyWorker(true));
+
+    DistributedOptions options;
+    options.tile         = 8;
+    options.tile_timeout = 0.5;
+
+    MandelbrotView view;
+    view.maxIterations = 50;
+    auto render = RenderDistributed("distributed_test.rgb", 40, 40, Colormap::Inferno, view, workers, options);
+    EXPECT_EQ(render.stats.tiles, 25u);
+    EXPECT_EQ(render.stats.lost_workers, 2u);
+    EXPECT_GE(render.stats.reassigned, 3u); // both of the hung worker's tiles, and at least one sent to the crashed one
+
+    Tensor<uint8_t, 3> expected({40, 40, 3});
+    for (size_t y = 0; y < 40; ++y)
+    {
+        for (size_t x = 0; x < 40; ++x)
+        {
+            StoreColor(expected, y, x, IntensityToColor(MandelbrotAt(view, 40, 40, y, x), Colormap::Inferno));
+        }
+    }
+    EXPECT_EQ(render.image, expected);
+
+    // with nobody left to render, the coordinator gives up instead of waiting
+    EXPECT_THROW(RenderDistributed("distributed_test.rgb", 40, 40, Colormap::Inferno, view, {SpawnFaultyWorker(false)}, options), std::runtime_error);
+    std::remove("distributed_test.rgb");
+}
+
+TEST(DistributedTest, QueuedTilesAreNotTimedWhileTheyWait)
+{
+    // each tile takes 0.2s and the second waits behind the first, so timing it from when it was
+    // sent would overrun a 0.3s timeout on a healthy worker
+    DistributedOptions options;
+    options.tile         = 10;
+    options.depth        = 2;
+    options.tile_timeout = 0.3;
+
+    auto render = RenderDistributed("distributed_test.rgb", 20, 20, Colormap::Inferno, {}, {SpawnSlowWorker(0.2)}, options);
+    EXPECT_EQ(render.stats.tiles, 4u);
+    EXPECT_EQ(render.stats.lost_workers, 0u);
+    EXPECT_EQ(render.stats.reassigned, 0u);
+    std::remove("distributed_test.rgb");
+}
+#endif